@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+#include <eosio/eosio.hpp>
+
+// Forward cursor over one table scope that talks to the db intrinsics
+// directly. Unlike multi_index it keeps no object cache: only the current
+// row is held, in a buffer reused for every read and write, so a full scan
+// costs the same memory for ten rows as for ten thousand.
+//
+// Rows written through a cursor bypass multi_index, so only use it on tables
+// without secondary indices for updates, and don't keep a multi_index
+// iterator to the same rows open in the same action.
+namespace rawdb {
+
+    using namespace eosio::internal_use_do_not_use;
+
+    template<eosio::name::raw TableName, typename T>
+    class cursor {
+    public:
+        cursor(eosio::name code, uint64_t scope, uint64_t lower_bound = 0)
+        :_code(code), _scope(scope) {
+            _itr = db_lowerbound_i64(code.value, scope, static_cast<uint64_t>(TableName), lower_bound);
+            load();
+        }
+
+        bool valid() const { return _itr >= 0; }
+
+        // working copy of the current row, write it back with update()
+        T& row() {
+            eosio::check(valid(), "cursor past the end");
+            return _row;
+        }
+
+        // same_payer keeps the row's current payer
+        void update(eosio::name payer) {
+            eosio::check(valid(), "cursor past the end");
+            eosio::check(_code == eosio::current_receiver(), "cannot modify objects in table of another contract");
+            _buffer.resize(eosio::pack_size(_row));
+            eosio::datastream<char*> ds(_buffer.data(), _buffer.size());
+            ds << _row;
+            db_update_i64(_itr, payer.value, _buffer.data(), _buffer.size());
+        }
+
+        void next() {
+            eosio::check(valid(), "cursor past the end");
+            uint64_t pk;
+            _itr = db_next_i64(_itr, &pk);
+            load();
+        }
+
+    private:
+        void load() {
+            if (!valid()) {
+                return;
+            }
+            auto size = db_get_i64(_itr, nullptr, 0);
+            eosio::check(size >= 0, "error reading row");
+            _buffer.resize(size);
+            db_get_i64(_itr, _buffer.data(), size);
+            eosio::datastream<const char*> ds(_buffer.data(), _buffer.size());
+            ds >> _row;
+        }
+
+        eosio::name _code;
+        uint64_t _scope;
+        int32_t _itr;
+        T _row;
+        std::vector<char> _buffer;
+    };
+
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <eosio/eosio.hpp>
+
+// Fixed-point reward emission shared by the pool contracts. Everything is
+// integer math: the amounts released up to a point in time are computed
+// from the pool's epoch, so consecutive harvests telescope and nothing is
+// lost to per-harvest rounding.
+namespace emission {
+
+    // a * b / c with a 128-bit intermediate, rounded down
+    inline uint64_t mul_div(uint64_t a, uint64_t b, uint64_t c) {
+        eosio::check(c > 0, "divide by zero");
+        uint128_t result = (uint128_t)a * b / c;
+        eosio::check(result <= UINT64_MAX, "mul-div overflow");
+        return (uint64_t)result;
+    }
+
+    // share of `amount` owed to `part` out of `whole`, rounded down
+    inline uint64_t pro_rata(uint64_t amount, uint64_t part, uint64_t whole) {
+        return mul_div(amount, part, whole);
+    }
+
+    // v1 schedule: the duration is split in four periods, the first one
+    // releases half of the reward and the rate halves at every period
+    // boundary until the third halving, after which it stays flat.
+    static constexpr uint32_t PERIODS = 4;
+    static constexpr uint32_t MAX_HALVINGS = 3;
+
+    // per-second weight of period k, in units of 2^-MAX_HALVINGS of the initial rate
+    constexpr uint64_t period_weight(uint32_t k) {
+        return (uint64_t)1 << (MAX_HALVINGS - (k < MAX_HALVINGS ? k : MAX_HALVINGS));
+    }
+
+    constexpr std::array<uint64_t, MAX_HALVINGS + 1> build_weight_prefix() {
+        std::array<uint64_t, MAX_HALVINGS + 1> prefix{};
+        for (uint32_t k = 1; k <= MAX_HALVINGS; k++) {
+            prefix[k] = prefix[k - 1] + period_weight(k - 1);
+        }
+        return prefix;
+    }
+
+    // weight accumulated per second of period length by all periods before period k
+    static constexpr auto WEIGHT_PREFIX = build_weight_prefix();
+    static_assert(WEIGHT_PREFIX[MAX_HALVINGS] == 14, "halving table out of sync");
+
+    // reward released by a halving pool `elapsed` seconds after its epoch
+    inline uint64_t halving_emitted(uint64_t total_reward, uint32_t duration, uint32_t elapsed) {
+        uint32_t period = duration / PERIODS;
+        eosio::check(period > 0, "Duration too short");
+        if (elapsed > duration) {
+            elapsed = duration;
+        }
+        uint32_t k = elapsed / period;
+        if (k > MAX_HALVINGS) {
+            k = MAX_HALVINGS;
+        }
+        uint64_t weight = WEIGHT_PREFIX[k] * period + (uint64_t)(elapsed - k * period) * period_weight(k);
+        // a full first period has weight 2^MAX_HALVINGS * period and releases half the reward
+        return (uint64_t)((uint128_t)total_reward * weight / (((uint128_t)2 * period) << MAX_HALVINGS));
+    }
+
+    // reward released by a linear pool `elapsed` seconds after its epoch
+    inline uint64_t linear_emitted(uint64_t total_reward, uint32_t duration, uint32_t elapsed) {
+        eosio::check(duration > 0, "Duration too short");
+        if (elapsed > duration) {
+            elapsed = duration;
+        }
+        return mul_div(total_reward, elapsed, duration);
+    }
+
+    // the schedules as types, for code templated on the emission
+    struct halving_schedule {
+        static uint64_t emitted(uint64_t total_reward, uint32_t duration, uint32_t elapsed) {
+            return halving_emitted(total_reward, duration, elapsed);
+        }
+    };
+
+    struct linear_schedule {
+        static uint64_t emitted(uint64_t total_reward, uint32_t duration, uint32_t elapsed) {
+            return linear_emitted(total_reward, duration, elapsed);
+        }
+    };
+
+    // v2 accumulators: reward per staked unit, scaled by SHARE_SCALE
+    static constexpr uint64_t SHARE_SCALE = 1000000000000;
+
+    // accumulator increase that spreads `amount` over `total_staked`
+    inline uint128_t per_share(uint64_t amount, uint64_t total_staked) {
+        eosio::check(total_staked > 0, "divide by zero");
+        return (uint128_t)amount * SHARE_SCALE / total_staked;
+    }
+
+    // what `staked` has earned since the accumulator was at zero, rounded down.
+    // A tiny stake drives the accumulator far past 2^64, so it's split at
+    // SHARE_SCALE and the whole part multiplied on its own
+    inline uint128_t accrued(uint64_t staked, uint128_t per_share) {
+        uint128_t whole = per_share / SHARE_SCALE;
+        uint128_t part = (uint128_t)staked * (per_share % SHARE_SCALE) / SHARE_SCALE;
+        eosio::check(whole == 0 || staked <= (~(uint128_t)0 - part) / whole, "accrued overflow");
+        return whole * staked + part;
+    }
+
+    // what a settle adds to unclaimed, the accrual on top of the debt
+    inline uint64_t owed(uint128_t accrued, uint128_t debt) {
+        eosio::check(accrued >= debt, "Debt above accrued");
+        eosio::check(accrued - debt <= UINT64_MAX, "Reward overflow");
+        return (uint64_t)(accrued - debt);
+    }
+
+    // part of the emission not yet released, zero if the pool is ahead of the schedule
+    inline uint64_t pending(uint64_t emitted, uint64_t released) {
+        return emitted > released ? emitted - released : 0;
+    }
+
+}
@@ -0,0 +1,706 @@
+#pragma once
+
+#include <array>
+#include <utils.hpp>
+#include <emission.hpp>
+#include <cursor.hpp>
+#include <rawaction.hpp>
+
+// The part of the pools contracts that doesn't depend on how miners are
+// accounted. A contract derives from pool_engine<Contract, Emission, Rewards>
+// and forwards its actions here:
+//
+//  - Emission is the schedule type, emission::halving_schedule or linear_schedule
+//  - Rewards is how miners are paid: `amounts` holds what one action pays
+//    out, `empty(amounts)` and `for_each(amounts, f(contract, quantity))`
+//    read it, `add(amounts, contract, quantity)` adds to it, `crl()` is the
+//    token issued as the emission is released and `is_reward_sender(from)`
+//    tells payouts coming in from stakes
+//  - the contract itself is the settlement strategy, it owns the miner rows
+//    and decides how a harvest reaches them
+//
+// All of it is resolved at compile time, a contract only carries the code of
+// what it was built with. Besides its tables (pool, pools_mi, pools_cursor,
+// registry, registry_si, contracts_mi, poolstats_mi, positions_mi, posindex,
+// posindex_si) and a no-op
+// `log(vector<engine::pool_event>)` action the contract provides:
+//
+//    uint64_t harvest_pool(pools_mi&, pools_mi::const_iterator, uint32_t now_time, uint64_t& rows)
+//       advances the pool to now_time, counts the rows touched, returns the CRL to issue
+//    bool take_unclaimed(const pool&, name owner, rewards& amounts)
+//       moves the owner's unclaimed rewards to amounts, false if the owner isn't mining the pool
+//    uint64_t remove_miner(const pool&, name owner, rewards& amounts)
+//       drops the owner's row, moves what it still held to amounts, returns the stake
+//    bool add_stake(const pool&, name owner, asset quantity)
+//       adds to the owner's stake, true for a new miner
+//    void reward_totals(const pool&, vector<extended_asset>& released, vector<uint128_t>& per_share)
+//       what the pool's reward tokens released so far and their accumulators, if any
+//    name next_miner(const pool&, name from)
+//       the first owner at or after `from` in the pool, empty when there is none
+//    bool finish_round(const pool&, uint32_t limit, uint32_t& rows)
+//       completes what a harvest of the deployed contract left half done, `limit`
+//       rows at most, counted in rows. False while some is left
+//    void close_pool(const pool&)
+//       gives back what the pool holds that no miner will ever be paid, before cleanup drops it
+//
+// and may hide emitted(pool, elapsed) to pick the schedule per pool. It sets
+// `static constexpr bool harvest_walks_miners` to true when harvest_pool
+// visits every miner row, cleanup then releases the final tail miner by
+// miner instead of in one harvest.
+
+// kinds of pool_event
+#define EVENT_CREATE    0
+#define EVENT_STAKE     1
+#define EVENT_WITHDRAW  2
+#define EVENT_CLAIM     3
+#define EVENT_HARVEST   4
+#define EVENT_CLOSE     5
+#define EVENT_COMPOUND  6   // claimed CRL staked in place, no transfer behind it
+
+namespace engine {
+
+    struct reward_token {
+        name contract;
+        symbol sym;
+    };
+
+    // one state transition, what an indexer needs to follow the pools from
+    // the action stream. The events of an action go out in a single log.
+    struct pool_event {
+        uint8_t kind;                       // EVENT_*
+        uint64_t pool_id;
+        name owner;                         // the miner, the stake token contract of a created pool
+        asset quantity;                     // stake moved or compounded, CRL a harvest released, reward of a created pool
+        asset total_staked;                 // the pool's stake afterwards
+        vector<extended_asset> amounts;     // paid to the miner, or released so far by a harvested pool
+        vector<uint128_t> per_share;        // accumulators after a harvest, empty when miners are walked
+    };
+
+    template<typename Contract, typename Emission, typename Rewards>
+    class pool_engine : public contract {
+    public:
+        using contract::contract;
+
+        // what an action pays out to a miner
+        typedef typename Rewards::amounts rewards;
+
+        void handle_transfer(name from, name to, asset quantity, std::string_view memo, name code) {
+            if (from == _self || to != _self) {
+                return;
+            }
+            if (Rewards::is_reward_sender(from)) {
+                return;
+            }
+            require_auth(from);
+            auto sym = quantity.symbol;
+            typename Contract::pools_mi pools_tbl(_self, _self.value);
+            auto itr = pools_tbl.end();
+            auto pool_id = utils::parse_pool_memo(memo);
+            if (pool_id > 0) {
+                itr = pools_tbl.find(pool_id);
+                check(itr != pools_tbl.end(), "Pool not found");
+            } else {
+                itr = find_token_pool(pools_tbl, code, sym);
+                check(itr != pools_tbl.end(), "Pool not found");
+            }
+            check(itr->contract == code && itr->sym == sym, "Error token"); // memo-addressed pools must match the transferred token
+            check(quantity >= itr->min_staked, "The amount of staked is too small");
+            auto now_time = current_time_point().sec_since_epoch();
+            check(now_time <= itr->epoch_time + itr->duration, "Mining is over");
+
+            deposit(pools_tbl, itr, from, quantity, EVENT_STAKE);
+            flush_events();
+        }
+
+    protected:
+        Contract& self() { return static_cast<Contract&>(*this); }
+
+        // lists a new pool, `init` sets the contract's own fields of the row
+        template<typename Init>
+        void create_pool(name contract, symbol sym, asset reward, uint32_t epoch_time, uint32_t duration, asset min_staked, Init&& init) {
+            require_auth("coralmanager"_n);
+
+            typename Contract::pools_mi pools_tbl(_self, _self.value);
+            check(find_token_pool(pools_tbl, contract, sym) == pools_tbl.end(), "Token exists");
+
+            check(reward.symbol == Rewards::crl().sym, "Reward symbol error");
+            check(min_staked.symbol == sym, "Min-staked symbol error");
+
+            typename Contract::registry_si registry_tbl(_self, _self.value);
+            auto reg = get_registry(registry_tbl);
+            reg.committed_reward += reward;
+            check(reg.committed_reward.amount <= 300000000000000, "Reach the max circulation");
+            reg.active_pools++;
+            registry_tbl.set(reg, _self);
+            update_contract_counts(contract, 1, 0);
+
+            auto pool_id = pools_tbl.available_primary_key();
+            if (pool_id == 0) {
+                pool_id = 1;
+            }
+            auto p_itr = pools_tbl.emplace(_self, [&]( auto& a ) {
+                a.id = pool_id;
+                a.contract = contract;
+                a.sym = sym;
+                a.total_staked = asset(0, sym);
+                a.total_reward = reward;
+                a.released_reward = asset(0, reward.symbol);
+                a.epoch_time = epoch_time;
+                a.duration = duration;
+                a.min_staked = min_staked;
+                a.last_harvest_time = epoch_time;
+                init(a);
+            });
+            log_harvest(EVENT_CREATE, *p_itr, contract, reward);
+            flush_events();
+        }
+
+        // the pool of a stake token. Pools listed before the tokenkey index existed
+        // are found once indexall listed them again
+        template<typename Pools>
+        typename Pools::const_iterator find_token_pool(Pools& pools_tbl, name contract, symbol sym) {
+            auto key_idx = pools_tbl.template get_index<"tokenkey"_n>();
+            auto k_itr = key_idx.find(utils::get_token_key(contract, sym));
+            if (k_itr == key_idx.end()) {
+                return pools_tbl.end();
+            }
+            return pools_tbl.iterator_to(*k_itr);
+        }
+
+        template<typename Pools>
+        bool token_listed(Pools& pools_tbl, typename Pools::const_iterator itr) {
+            auto key_idx = pools_tbl.template get_index<"tokenkey"_n>();
+            auto k_itr = key_idx.find(itr->get_key());
+            return k_itr != key_idx.end() && k_itr->id == itr->id;
+        }
+
+        // writes the row again so the tokenkey index picks it up
+        template<typename Pools>
+        typename Pools::const_iterator list_token(Pools& pools_tbl, typename Pools::const_iterator itr) {
+            auto p = *itr;
+            pools_tbl.erase(itr);
+            return pools_tbl.emplace(_self, [&]( auto& a) {
+                a = p;
+            });
+        }
+
+        // no pools claims every pool the owner has a stake in
+        void claim_pools(name owner, const vector<uint64_t>& pool_ids) {
+            require_auth(owner);
+            auto ids = pool_ids.empty() ? owner_pools(owner) : pool_ids;
+            check(!ids.empty(), "No pools");
+
+            typename Contract::pools_mi pools_tbl(_self, _self.value);
+            rewards amounts{};
+            for (auto pool_id : ids) {
+                auto p_itr = pools_tbl.find(pool_id);
+                check(p_itr != pools_tbl.end(), "Pool not exists");
+                rewards pool_amounts{};
+                check(self().take_unclaimed(*p_itr, owner, pool_amounts), "No this miner");
+                Rewards::for_each(pool_amounts, [&](name contract, asset quantity) {
+                    Rewards::add(amounts, contract, quantity);
+                });
+                log_event(pool_event{EVENT_CLAIM, pool_id, owner, asset(0, p_itr->sym), p_itr->total_staked,
+                    to_assets(pool_amounts), {}});
+            }
+            check(!Rewards::empty(amounts), "No unclaimed");
+
+            // one transfer per reward token however many pools were settled
+            pay_out(owner, amounts);
+            flush_events();
+        }
+
+        // stakes the owner's unclaimed CRL of `pool_ids` in `pool_id`, a pool
+        // staking CRL itself, without it ever leaving the contract. Other
+        // reward tokens are paid out as a claim would. No pools takes them
+        // from every pool the owner has a stake in.
+        void compound_pools(name owner, uint64_t pool_id, const vector<uint64_t>& pool_ids) {
+            require_auth(owner);
+            auto ids = pool_ids.empty() ? owner_pools(owner) : pool_ids;
+            check(!ids.empty(), "No pools");
+
+            typename Contract::pools_mi pools_tbl(_self, _self.value);
+            auto itr = pools_tbl.find(pool_id);
+            check(itr != pools_tbl.end(), "Pool not exists");
+            auto crl = Rewards::crl();
+            check(itr->contract == crl.contract && itr->sym == crl.sym, "Pool doesn't stake CRL");
+            check(current_time_point().sec_since_epoch() <= itr->epoch_time + itr->duration, "Mining is over");
+
+            rewards amounts{};
+            uint64_t compounded = 0;
+            for (auto id : ids) {
+                auto p_itr = pools_tbl.find(id);
+                check(p_itr != pools_tbl.end(), "Pool not exists");
+                rewards pool_amounts{};
+                check(self().take_unclaimed(*p_itr, owner, pool_amounts), "No this miner");
+                Rewards::for_each(pool_amounts, [&](name contract, asset quantity) {
+                    if (contract == crl.contract && quantity.symbol == crl.sym) {
+                        compounded += quantity.amount;
+                    } else {
+                        Rewards::add(amounts, contract, quantity);
+                    }
+                });
+                log_event(pool_event{EVENT_CLAIM, id, owner, asset(0, p_itr->sym), p_itr->total_staked,
+                    to_assets(pool_amounts), {}});
+            }
+            check(compounded > 0, "No unclaimed");
+
+            // the CRL was issued to us at harvest, it only changes hands in the books
+            auto quantity = asset(compounded, crl.sym);
+            if (deposit(pools_tbl, itr, owner, quantity, EVENT_COMPOUND)) {
+                check(quantity >= itr->min_staked, "The amount of staked is too small");
+            }
+            pay_out(owner, amounts);
+            flush_events();
+        }
+
+        void withdraw_pool(name owner, uint64_t pool_id) {
+            require_auth(owner);
+
+            typename Contract::pools_mi pools_tbl(_self, _self.value);
+            auto p_itr = pools_tbl.find(pool_id);
+            check(p_itr != pools_tbl.end(), "Pool not exists");
+
+            release_miner(pools_tbl, p_itr, owner, "Minner withdraw");
+            flush_events();
+        }
+
+        // winds down a pool that is over: releases what the schedule still
+        // owes up to its end, pays out and drops up to `limit` miners and,
+        // once none is left, drops the pool. Called again until it's gone.
+        // When a harvest walks every miner, each released miner takes its
+        // share of the tail instead so a call never touches more than `limit`.
+        void cleanup_pool(uint64_t pool_id, uint32_t limit) {
+            require_auth("coralmanager"_n);
+            check(limit > 0, "Invalid limit");
+            seed_registry();
+
+            typename Contract::pools_mi pools_tbl(_self, _self.value);
+            auto itr = pools_tbl.find(pool_id);
+            check(itr != pools_tbl.end(), "Pool not exists");
+            auto end_time = itr->epoch_time + itr->duration;
+            check(current_time_point().sec_since_epoch() > end_time, "Mining is not over");
+
+            uint32_t tail_until = 0;
+            if (itr->last_harvest_time < end_time && itr->total_staked.amount > 0) {
+                if constexpr (Contract::harvest_walks_miners) {
+                    tail_until = end_time;
+                } else {
+                    uint64_t rows = 0;
+                    issue_released(harvest_recorded(pools_tbl, itr, end_time, rows));
+                }
+            }
+
+            bool empty = false;
+            for (uint32_t i = 0; i < limit && !empty; i++) {
+                auto owner = self().next_miner(*itr, name());
+                empty = owner == name();
+                if (!empty) {
+                    release_miner(pools_tbl, itr, owner, "Pool closed", tail_until);
+                }
+            }
+            if (!empty && self().next_miner(*itr, name()) != name()) {
+                flush_events();
+                return;
+            }
+
+            // what was committed and will never be released frees up the circulation
+            typename Contract::registry_si registry_tbl(_self, _self.value);
+            auto reg = get_registry(registry_tbl);
+            reg.committed_reward -= itr->total_reward - itr->released_reward;
+            reg.active_pools = reg.active_pools > 0 ? reg.active_pools - 1 : 0;
+            registry_tbl.set(reg, _self);
+            update_contract_counts(itr->contract, -1, 0);
+
+            typename Contract::poolstats_mi stats_tbl(_self, _self.value);
+            auto s_itr = stats_tbl.find(pool_id);
+            if (s_itr != stats_tbl.end()) {
+                stats_tbl.erase(s_itr);
+            }
+            self().close_pool(*itr);
+            log_harvest(EVENT_CLOSE, *itr, itr->contract, itr->total_reward - itr->released_reward);
+            pools_tbl.erase(itr);
+            flush_events();
+        }
+
+        // adds the miners that staked before positions were kept and lists the
+        // pools in the tokenkey index, `limit` rows a call, resuming where the
+        // last call stopped
+        void index_positions(uint32_t limit) {
+            require_auth("coralmanager"_n);
+            check(limit > 0, "Invalid limit");
+
+            typename Contract::posindex_si posindex_tbl(_self, _self.value);
+            auto state = posindex_tbl.get_or_default(typename Contract::posindex{0, name(), 0});
+            typename Contract::pools_mi pools_tbl(_self, _self.value);
+            auto p_itr = pools_tbl.lower_bound(state.pool_id);
+            check(p_itr != pools_tbl.end(), "Nothing to index");
+
+            uint32_t rows = 0;
+            while (p_itr != pools_tbl.end() && rows < limit) {
+                state.pool_id = p_itr->id;
+                // pools of the deployed contract aren't in the tokenkey index either
+                if (state.owner == name() && !token_listed(pools_tbl, p_itr)) {
+                    p_itr = list_token(pools_tbl, p_itr);
+                    rows++;
+                }
+                auto owner = self().next_miner(*p_itr, state.owner);
+                for (; owner != name() && rows < limit; owner = self().next_miner(*p_itr, name(owner.value + 1))) {
+                    if (add_position(owner, p_itr->id)) {
+                        update_contract_counts(p_itr->contract, 0, 1);
+                    }
+                    rows++;
+                    state.rows++;
+                }
+                if (owner != name()) {
+                    state.owner = owner;
+                    break;
+                }
+                state.owner = name();
+                state.pool_id = p_itr->id + 1;
+                p_itr++;
+            }
+            posindex_tbl.set(state, _self);
+        }
+
+        void harvest_one(uint64_t pool_id) {
+            require_auth("coralmanager"_n);
+            // read before the harvest changes the pool, see get_registry
+            typename Contract::registry_si registry_tbl(_self, _self.value);
+            auto reg = get_registry(registry_tbl);
+
+            typename Contract::pools_mi pools_tbl(_self, _self.value);
+            auto itr = pools_tbl.find(pool_id);
+            check(itr != pools_tbl.end(), "Pool not exists");
+
+            auto now_time = current_time_point().sec_since_epoch();
+            check(now_time >= itr->epoch_time, "Mining hasn't started yet");
+            check(now_time <= itr->epoch_time + itr->duration, "Mining is over");
+
+            auto time_elapsed = now_time - itr->last_harvest_time;
+            if (time_elapsed == 0) {
+                return;
+            }
+            check(itr->total_staked.amount > 0, "No miners");
+
+            uint64_t rows = 0;
+            issue_released(registry_tbl, reg, harvest_recorded(pools_tbl, itr, now_time, rows));
+            flush_events();
+        }
+
+        void harvest_pools(const vector<uint64_t>& pool_ids, uint32_t max_rows) {
+            require_auth("coralmanager"_n);
+            check(!pool_ids.empty(), "No pools");
+            check(max_rows > 0, "Invalid max rows");
+            typename Contract::registry_si registry_tbl(_self, _self.value);
+            auto reg = get_registry(registry_tbl);
+
+            typename Contract::pools_mi pools_tbl(_self, _self.value);
+            auto now_time = current_time_point().sec_since_epoch();
+            uint64_t rows = 0;
+            uint64_t issued = 0;
+            for (size_t i = 0; i < pool_ids.size(); i++) {
+                // pools are harvested whole, the ones left once the budget is spent wait for the next call
+                if (rows >= max_rows) {
+                    for (; i < pool_ids.size(); i++) {
+                        if (pools_tbl.find(pool_ids[i]) != pools_tbl.end()) {
+                            update_stats(pool_ids[i], [](auto& s) { s.deferred++; });
+                        }
+                    }
+                    break;
+                }
+                auto itr = pools_tbl.find(pool_ids[i]);
+                check(itr != pools_tbl.end(), "Pool not exists");
+                // stakes wait on an unfinished round, it goes ahead of the harvest on the same budget
+                uint32_t round_rows = 0;
+                bool finished = self().finish_round(*itr, max_rows - rows, round_rows);
+                rows += round_rows;
+                if (!finished) {
+                    update_stats(itr->id, [](auto& s) { s.deferred++; });
+                    continue;
+                }
+                // a pool that can't be harvested right now is skipped instead of failing the batch
+                if (!harvestable(*itr, now_time)) {
+                    continue;
+                }
+                issued += harvest_recorded(pools_tbl, itr, now_time, rows);
+            }
+            issue_released(registry_tbl, reg, issued);
+            flush_events();
+        }
+
+        // adds to the owner's stake in the pool, true for a new miner
+        template<typename Pools>
+        bool deposit(Pools& pools_tbl, typename Pools::const_iterator p_itr, name owner, asset quantity, uint8_t kind) {
+            pools_tbl.modify(p_itr, same_payer, [&]( auto& s) {
+                s.total_staked += quantity;
+            });
+            bool added = self().add_stake(*p_itr, owner, quantity);
+            // miners from before the positions were kept get theirs on their next deposit
+            if (add_position(owner, p_itr->id)) {
+                update_contract_counts(p_itr->contract, 0, 1);
+            }
+            update_stats(p_itr->id, [&](auto& s) {
+                s.deposits++;
+                s.deposit_volume += quantity.amount;
+            });
+            log_event(pool_event{kind, p_itr->id, owner, quantity, p_itr->total_staked, {}, {}});
+            return added;
+        }
+
+        // drops the owner's row, returns the stake and pays out what it held.
+        // With tail_until set the owner also takes its share of what the
+        // schedule owes up to then, the last miner whatever is left of it
+        template<typename Pools>
+        void release_miner(Pools& pools_tbl, typename Pools::const_iterator p_itr, name owner, std::string_view memo,
+                           uint32_t tail_until = 0) {
+            rewards amounts{};
+            auto quantity = asset(self().remove_miner(*p_itr, owner, amounts), p_itr->sym);
+            uint64_t tail = 0;
+            if (tail_until > 0) {
+                tail = emission::pro_rata(pending_emission(*p_itr, tail_until), quantity.amount, p_itr->total_staked.amount);
+                auto crl = Rewards::crl();
+                Rewards::add(amounts, crl.contract, asset(tail, crl.sym));
+            }
+            pools_tbl.modify(p_itr, same_payer, [&]( auto& s) {
+                s.total_staked -= quantity;
+                s.released_reward.amount += tail;
+            });
+            if (remove_position(owner, p_itr->id)) {
+                update_contract_counts(p_itr->contract, 0, -1);
+            }
+            update_stats(p_itr->id, [&](auto& s) {
+                s.withdrawals++;
+                s.withdraw_volume += quantity.amount;
+                s.crl_total += tail;
+            });
+            issue_released(tail);
+
+            rawaction::transfer(p_itr->contract, _self, owner, quantity, memo);
+            pay_out(owner, amounts);
+            log_event(pool_event{EVENT_WITHDRAW, p_itr->id, owner, quantity, p_itr->total_staked, to_assets(amounts), {}});
+        }
+
+        // harvests the pool and records the round in its stats
+        template<typename Pools>
+        uint64_t harvest_recorded(Pools& pools_tbl, typename Pools::const_iterator itr, uint32_t now_time, uint64_t& rows) {
+            auto pool_id = itr->id;
+            auto interval = now_time - itr->last_harvest_time;
+            auto rows_before = rows;
+            auto released = self().harvest_pool(pools_tbl, itr, now_time, rows);
+            update_stats(pool_id, [&](auto& s) {
+                s.harvests++;
+                s.harvest_interval = interval;
+                s.rows_last = rows - rows_before;
+                s.rows_total += s.rows_last;
+                s.crl_last = released;
+                s.crl_total += released;
+            });
+            log_harvest(EVENT_HARVEST, *itr, name(), asset(released, Rewards::crl().sym));
+            return released;
+        }
+
+        // a pool event carrying the pool's reward totals
+        template<typename Pool>
+        void log_harvest(uint8_t kind, const Pool& p, name owner, asset quantity) {
+            pool_event e{kind, p.id, owner, quantity, p.total_staked, {}, {}};
+            self().reward_totals(p, e.amounts, e.per_share);
+            log_event(e);
+        }
+
+        void log_event(const pool_event& e) {
+            _events.push_back(e);
+        }
+
+        // sends what the action logged as one inline log action, through
+        // eosio::action since harvestall can log more than a fixed buffer holds
+        void flush_events() {
+            if (_events.empty()) {
+                return;
+            }
+            action(permission_level{_self, "active"_n}, _self, "log"_n, make_tuple(_events)).send();
+            _events.clear();
+        }
+
+        static vector<extended_asset> to_assets(const rewards& amounts) {
+            vector<extended_asset> result;
+            Rewards::for_each(amounts, [&](name contract, asset quantity) {
+                result.push_back(extended_asset(quantity, contract));
+            });
+            return result;
+        }
+
+        // the pools the owner has a stake in, from the positions kept in the owner's scope
+        vector<uint64_t> owner_pools(name owner) {
+            vector<uint64_t> result;
+            typename Contract::positions_mi positions_tbl(_self, owner.value);
+            for (auto& pos : positions_tbl) {
+                result.push_back(pos.pool_id);
+            }
+            return result;
+        }
+
+        // false if the owner already had it
+        bool add_position(name owner, uint64_t pool_id) {
+            typename Contract::positions_mi positions_tbl(_self, owner.value);
+            if (positions_tbl.find(pool_id) != positions_tbl.end()) {
+                return false;
+            }
+            positions_tbl.emplace(_self, [&]( auto& a) {
+                a.pool_id = pool_id;
+            });
+            return true;
+        }
+
+        // false if the owner had none, a miner from before the positions were kept
+        bool remove_position(name owner, uint64_t pool_id) {
+            typename Contract::positions_mi positions_tbl(_self, owner.value);
+            auto itr = positions_tbl.find(pool_id);
+            if (itr == positions_tbl.end()) {
+                return false;
+            }
+            positions_tbl.erase(itr);
+            return true;
+        }
+
+        // applies `update` to the pool's stats row, created on first use
+        template<typename Update>
+        void update_stats(uint64_t pool_id, Update&& update) {
+            typename Contract::poolstats_mi stats_tbl(_self, _self.value);
+            auto itr = stats_tbl.find(pool_id);
+            if (itr == stats_tbl.end()) {
+                stats_tbl.emplace(_self, [&]( auto& a) {
+                    a = {};
+                    a.pool_id = pool_id;
+                    update(a);
+                });
+                return;
+            }
+            stats_tbl.modify(itr, same_payer, [&]( auto& s) {
+                update(s);
+            });
+        }
+
+        // one page of pools, `make` builds the contract's view of a row from it,
+        // the pending release and the release over the next day
+        template<typename State, typename Make>
+        vector<State> list_pools(uint64_t from, uint32_t limit, Make&& make) {
+            check(limit > 0 && limit <= 100, "Invalid limit");
+            auto now_time = current_time_point().sec_since_epoch();
+            vector<State> result;
+            for (typename Contract::pools_cursor p_cur(_self, _self.value, from); p_cur.valid() && result.size() < limit; p_cur.next()) {
+                auto& p = p_cur.row();
+                auto pending = asset(harvestable(p, now_time) ? pending_emission(p, now_time) : 0, p.released_reward.symbol);
+                // the schedule over the next day, clamped to the end of the pool
+                uint32_t elapsed = now_time > p.epoch_time ? now_time - p.epoch_time : 0;
+                auto per_day = self().emitted(p, elapsed + 86400) - self().emitted(p, elapsed);
+                result.push_back(make(p, pending, asset(per_day, p.released_reward.symbol)));
+            }
+            return result;
+        }
+
+        void pay_out(name owner, const rewards& amounts) {
+            Rewards::for_each(amounts, [&](name contract, asset quantity) {
+                rawaction::transfer(contract, _self, owner, quantity, "Minner claimed");
+            });
+        }
+
+        // adds to the released total of `reg`, read before the action changed
+        // any pool, and issues the CRL
+        template<typename Registry, typename Reg>
+        void issue_released(Registry& registry_tbl, Reg reg, uint64_t amount) {
+            if (amount == 0) {
+                return;
+            }
+            auto crl = Rewards::crl();
+            auto token_issued = asset(amount, crl.sym);
+
+            reg.released_reward += token_issued;
+            registry_tbl.set(reg, _self);
+
+            rawaction::send(crl.contract, "issue"_n, permission_level{_self, "active"_n}, _self, token_issued, std::string_view("Issue CRL"));
+        }
+
+        // reward the pool's schedule emitted `elapsed` seconds after its epoch,
+        // a contract running pools on other schedules as well hides this one
+        template<typename Pool>
+        uint64_t emitted(const Pool& p, uint32_t elapsed) {
+            return Emission::emitted(p.total_reward.amount, p.duration, elapsed);
+        }
+
+        // reward emitted up to now_time and not released yet
+        template<typename Pool>
+        uint64_t pending_emission(const Pool& p, uint32_t now_time) {
+            // whatever the last harvests could not split evenly is still unreleased and goes out now
+            return emission::pending(self().emitted(p, now_time - p.epoch_time), p.released_reward.amount);
+        }
+
+        // whether harvest would advance the pool at now_time
+        template<typename Pool>
+        bool harvestable(const Pool& p, uint32_t now_time) {
+            if (now_time < p.epoch_time || now_time > p.epoch_time + p.duration) {
+                return false;
+            }
+            return now_time != p.last_harvest_time && p.total_staked.amount > 0;
+        }
+
+        // for actions that release CRL after seed_registry
+        void issue_released(uint64_t amount) {
+            if (amount == 0) {
+                return;
+            }
+            typename Contract::registry_si registry_tbl(_self, _self.value);
+            issue_released(registry_tbl, registry_tbl.get(), amount);
+        }
+
+        // running aggregates over all pools. The first use after an upgrade
+        // picks up the pools that are already listed, so the action reads it
+        // before it changes any pool row or the change would count twice
+        template<typename Registry>
+        auto get_registry(Registry& registry_tbl) {
+            if (registry_tbl.exists()) {
+                return registry_tbl.get();
+            }
+            auto zero_crl = asset(0, Rewards::crl().sym);
+            typename Contract::registry reg{zero_crl, zero_crl, 0};
+            for (typename Contract::pools_cursor p_cur(_self, _self.value); p_cur.valid(); p_cur.next()) {
+                auto& p = p_cur.row();
+                reg.committed_reward += p.total_reward;
+                reg.released_reward += p.released_reward;
+                reg.active_pools++;
+                update_contract_counts(p.contract, 1, 0);
+            }
+            return reg;
+        }
+
+        // stores the registry if this is its first use, for actions that
+        // only update it once pool rows have changed
+        void seed_registry() {
+            typename Contract::registry_si registry_tbl(_self, _self.value);
+            if (!registry_tbl.exists()) {
+                registry_tbl.set(get_registry(registry_tbl), _self);
+            }
+        }
+
+        void update_contract_counts(name contract, int64_t pools, int64_t miners) {
+            typename Contract::contracts_mi contracts_tbl(_self, _self.value);
+            auto itr = contracts_tbl.find(contract.value);
+            if (itr == contracts_tbl.end()) {
+                contracts_tbl.emplace(_self, [&]( auto& a) {
+                    a.contract = contract;
+                    a.pools = pools > 0 ? pools : 0;
+                    a.miners = miners > 0 ? miners : 0;
+                });
+                return;
+            }
+            // miners that staked before the counts existed were never added, don't wrap below zero
+            contracts_tbl.modify(itr, same_payer, [&]( auto& s) {
+                s.pools = pools < 0 && s.pools < (uint64_t)-pools ? 0 : s.pools + pools;
+                s.miners = miners < 0 && s.miners < (uint64_t)-miners ? 0 : s.miners + miners;
+            });
+        }
+
+        vector<pool_event> _events;
+    };
+
+}
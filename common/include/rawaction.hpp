@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string_view>
+#include <eosio/eosio.hpp>
+#include <eosio/asset.hpp>
+
+// Action data without the heap. Transfer notifications are decoded in place
+// from a stack buffer, with the memo left there as a view, and inline
+// actions are packed straight into one instead of going through a tuple,
+// the vectors of eosio::action and a second copy for send_inline.
+namespace rawaction {
+
+    using namespace eosio;
+
+    // room for a transfer with the 256 byte memo eosio.token allows
+    static constexpr size_t BUFFER_SIZE = 512;
+
+    // a transfer notification, the memo points into the reader's buffer
+    class transfer_reader {
+    public:
+        name from;
+        name to;
+        asset quantity;
+        std::string_view memo;
+
+        // reads from and to first and the rest only for a transfer to `self`
+        // from someone else, false for any other transfer
+        bool read(name self) {
+            auto size = action_data_size();
+            check(size >= 2 * sizeof(uint64_t), "Invalid transfer data");
+            read_action_data(_buffer, 2 * sizeof(uint64_t));
+            datastream<const char*> head(_buffer, 2 * sizeof(uint64_t));
+            head >> from >> to;
+            if (from == self || to != self) {
+                return false;
+            }
+
+            check(size <= BUFFER_SIZE, "Transfer memo too long");
+            read_action_data(_buffer, size);
+            datastream<const char*> ds(_buffer, size);
+            ds.skip(2 * sizeof(uint64_t));
+            unsigned_int memo_size;
+            ds >> quantity >> memo_size;
+            check(memo_size.value == ds.remaining(), "Invalid transfer data");
+            memo = std::string_view(ds.pos(), memo_size.value);
+            return true;
+        }
+
+    private:
+        char _buffer[BUFFER_SIZE];
+    };
+
+    template<typename DataStream, typename T>
+    void write(DataStream& ds, const T& value) {
+        ds << value;
+    }
+
+    // serialized as a string
+    template<typename DataStream>
+    void write(DataStream& ds, std::string_view value) {
+        ds << unsigned_int(value.size());
+        ds.write(value.data(), value.size());
+    }
+
+    // sends `account::action_name(args...)` as an inline action
+    template<typename... Args>
+    void send(name account, name action_name, const permission_level& auth, const Args&... args) {
+        datastream<size_t> sizer;
+        (write(sizer, args), ...);
+        unsigned_int data_size(sizer.tellp());
+
+        char buffer[BUFFER_SIZE];
+        datastream<char*> ds(buffer, sizeof(buffer));
+        ds << account << action_name << unsigned_int(1) << auth << data_size;
+        check(data_size.value <= ds.remaining(), "Inline action too large");
+        (write(ds, args), ...);
+        internal_use_do_not_use::send_inline(buffer, ds.tellp());
+    }
+
+    inline void transfer(name token, name from, name to, const asset& quantity, std::string_view memo) {
+        send(token, "transfer"_n, permission_level{from, "active"_n}, from, to, quantity, memo);
+    }
+
+}
@@ -0,0 +1,497 @@
+#include "audit.hpp"
+
+#include <emission.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace audit {
+
+   namespace {
+
+      // Splits one dump line into its comma separated fields.
+      struct fields {
+         const char* pos;
+         const char* end;
+
+         std::string_view next() {
+            if (pos > end) throw std::runtime_error("missing field");
+            auto comma = static_cast<const char*>(std::memchr(pos, ',', end - pos));
+            auto stop = comma ? comma : end;
+            std::string_view field(pos, stop - pos);
+            pos = stop + 1;
+            return field;
+         }
+
+         uint64_t u64() {
+            auto f = next();
+            uint64_t v = 0;
+            auto [p, ec] = std::from_chars(f.data(), f.data() + f.size(), v);
+            if (ec != std::errc() || p != f.data() + f.size() || f.empty()) {
+               throw std::runtime_error("bad number '" + std::string(f) + "'");
+            }
+            return v;
+         }
+
+         // asset amounts, which the chain keeps below 2^62
+         uint64_t amount() {
+            auto v = u64();
+            if (v >= (uint64_t(1) << 62)) throw std::runtime_error("amount out of range");
+            return v;
+         }
+
+         uint128 u128() {
+            auto f = next();
+            if (f.empty() || f.size() > 39) throw std::runtime_error("bad number '" + std::string(f) + "'");
+            uint128 v = 0;
+            for (char c : f) {
+               if (c < '0' || c > '9') throw std::runtime_error("bad number '" + std::string(f) + "'");
+               v = v * 10 + uint128(c - '0');
+            }
+            return v;
+         }
+
+         uint64_t account() { return eosio::name(next()).value; }
+
+         bool more() const { return pos <= end; }
+
+         void done() const {
+            if (pos <= end) throw std::runtime_error("too many fields");
+         }
+      };
+
+      bool skip_line(std::string_view line) {
+         return line.empty() || line[0] == '#' || line == "\r";
+      }
+
+      std::string_view trim_cr(std::string_view line) {
+         if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+         return line;
+      }
+
+      std::string to_string(uint128 v) {
+         if (v == 0) return "0";
+         std::string s;
+         while (v > 0) {
+            s += char('0' + int(v % 10));
+            v /= 10;
+         }
+         std::reverse(s.begin(), s.end());
+         return s;
+      }
+
+      std::string pool_label(uint64_t contract, uint64_t id) {
+         return eosio::name(contract).to_string() + "/" + std::to_string(id);
+      }
+
+      // the pool's reward tokens by their position, CRL first
+      std::string token_label(std::size_t k) {
+         return k == 0 ? "crl" : "reward " + std::to_string(k);
+      }
+
+      struct pool_key {
+         uint64_t contract;
+         uint64_t id;
+         bool operator==(const pool_key& o) const { return contract == o.contract && id == o.id; }
+      };
+
+      struct pool_key_hash {
+         std::size_t operator()(const pool_key& k) const { return std::hash<uint64_t>()(k.contract * 0x9e3779b97f4a7c15ull ^ k.id); }
+      };
+
+      typedef std::unordered_map<pool_key, uint32_t, pool_key_hash> pool_index;
+
+      // One block of miner rows, one column per field and reward token. Rows
+      // of a pool with fewer tokens than the widest pool hold 0 in the rest.
+      struct miner_block {
+         std::vector<uint32_t> pool;
+         std::vector<uint64_t> owner;
+         std::vector<uint64_t> staked;
+         std::vector<std::vector<uint64_t>> claimed;
+         std::vector<std::vector<uint64_t>> unclaimed;
+         std::vector<std::vector<uint128>> debt;
+         // filled by the kernels
+         std::vector<std::vector<uint64_t>> pending;
+
+         std::size_t size() const { return pool.size(); }
+
+         void clear(std::size_t tokens) {
+            for (auto* c : {&owner, &staked}) c->clear();
+            pool.clear();
+            claimed.resize(tokens);
+            unclaimed.resize(tokens);
+            debt.resize(tokens);
+            pending.resize(tokens);
+            for (std::size_t k = 0; k < tokens; k++) {
+               claimed[k].clear();
+               unclaimed[k].clear();
+               debt[k].clear();
+            }
+         }
+      };
+
+      // Sum of a column without 128-bit adds in the loop: the low and high
+      // halves are added separately, which keeps the loop vectorizable and
+      // can't overflow below 2^32 rows.
+      uint128 column_sum(const uint64_t* v, std::size_t n) {
+         uint64_t lo = 0, hi = 0;
+         for (std::size_t i = 0; i < n; i++) {
+            lo += v[i] & 0xffffffffu;
+            hi += v[i] >> 32;
+         }
+         return (uint128(hi) << 32) + lo;
+      }
+
+      std::vector<pool_totals> empty_totals(const std::vector<pool>& pools) {
+         std::vector<pool_totals> totals(pools.size());
+         for (std::size_t i = 0; i < pools.size(); i++) totals[i].rewards.resize(pools[i].rewards.size());
+         return totals;
+      }
+
+      // Per worker state, merged once the dump is through.
+      struct worker_state {
+         std::vector<pool_totals> totals;
+         std::vector<discrepancy> discrepancies;
+         uint64_t skipped = 0;
+         uint64_t rows = 0;
+         miner_block block;
+      };
+
+      class auditor {
+       public:
+         auditor(const std::vector<pool>& pools, const options& opts) : _pools(pools), _opts(opts) {
+            for (uint32_t i = 0; i < pools.size(); i++) {
+               if (!_index.emplace(pool_key{pools[i].contract, pools[i].id}, i).second) {
+                  throw std::runtime_error("pool " + pool_label(pools[i].contract, pools[i].id) + " dumped twice");
+               }
+               _tokens = std::max(_tokens, pools[i].rewards.size());
+            }
+         }
+
+         void parse(std::string_view chunk, worker_state& w, std::vector<discrepancy>& orphans) const {
+            auto& b = w.block;
+            b.clear(_tokens);
+            while (!chunk.empty()) {
+               auto nl = chunk.find('\n');
+               auto line = trim_cr(chunk.substr(0, nl));
+               chunk.remove_prefix(nl == std::string_view::npos ? chunk.size() : nl + 1);
+               if (skip_line(line)) continue;
+               try {
+                  fields f{line.data(), line.data() + line.size()};
+                  auto contract = f.account();
+                  auto pool_id = f.u64();
+                  auto owner = f.account();
+                  auto itr = _index.find(pool_key{contract, pool_id});
+                  if (itr == _index.end()) {
+                     orphans.push_back({contract, pool_id, owner, "miner of a pool missing from the pools dump"});
+                     continue;
+                  }
+                  b.pool.push_back(itr->second);
+                  b.owner.push_back(owner);
+                  b.staked.push_back(f.amount());
+                  auto tokens = _pools[itr->second].rewards.size();
+                  for (std::size_t k = 0; k < _tokens; k++) {
+                     bool listed = k < tokens;
+                     b.claimed[k].push_back(listed ? f.amount() : 0);
+                     b.unclaimed[k].push_back(listed ? f.amount() : 0);
+                     b.debt[k].push_back(listed ? f.u128() : 0);
+                  }
+                  f.done();
+               } catch (const std::exception& e) {
+                  throw std::runtime_error("miners dump: " + std::string(e.what()) + " in '" + std::string(line) + "'");
+               }
+            }
+         }
+
+         // Settles every row against its pool's accumulators and adds the
+         // block to the worker's totals, one run of rows of the same pool at
+         // a time (dumps come out grouped by scope).
+         void audit_block(worker_state& w) const {
+            auto& b = w.block;
+            auto n = b.size();
+            for (auto& c : b.pending) c.assign(n, 0);
+            w.rows += n;
+
+            std::size_t begin = 0;
+            while (begin < n) {
+               auto pi = b.pool[begin];
+               auto end = begin + 1;
+               while (end < n && b.pool[end] == pi) end++;
+               auto& p = _pools[pi];
+               auto len = end - begin;
+
+               if (p.version == 2) {
+                  settle(p, b, begin, end, w);
+               }
+
+               auto& t = w.totals[pi];
+               t.miners += len;
+               t.staked += column_sum(&b.staked[begin], len);
+               for (std::size_t k = 0; k < p.rewards.size(); k++) {
+                  auto& r = t.rewards[k];
+                  r.claimed += column_sum(&b.claimed[k][begin], len);
+                  r.claimable += column_sum(&b.unclaimed[k][begin], len) + column_sum(&b.pending[k][begin], len);
+               }
+               begin = end;
+            }
+         }
+
+         void flag(worker_state& w, const pool& p, uint64_t owner, std::string what) const {
+            if (w.discrepancies.size() < _opts.max_miner_discrepancies) {
+               w.discrepancies.push_back({p.contract, p.id, owner, std::move(what)});
+            } else {
+               w.skipped++;
+            }
+         }
+
+         // v2 rows: what a settle now would add to unclaimed
+         void settle(const pool& p, miner_block& b, std::size_t begin, std::size_t end, worker_state& w) const {
+            for (std::size_t k = 0; k < p.rewards.size(); k++) {
+               auto per_share = p.rewards[k].per_share;
+               auto& debt = b.debt[k];
+               for (auto i = begin; i < end; i++) {
+                  auto accrued = emission::accrued(b.staked[i], per_share);
+                  if (debt[i] > accrued) {
+                     flag(w, p, b.owner[i], token_label(k) + " debt " + to_string(debt[i]) + " above accrued " +
+                                               to_string(accrued));
+                  } else {
+                     b.pending[k][i] = uint64_t(accrued - debt[i]);
+                  }
+               }
+            }
+         }
+
+       private:
+         const std::vector<pool>& _pools;
+         const options& _opts;
+         pool_index _index;
+         std::size_t _tokens = 0;   // of the widest pool
+      };
+
+      // Hands out the dump in chunks cut at line ends, to whichever worker
+      // asks next; parsing and the kernels run outside the lock.
+      class chunk_reader {
+       public:
+         chunk_reader(std::istream& in, std::size_t chunk_bytes) : _in(in), _chunk_bytes(chunk_bytes) {}
+
+         bool next(std::string& chunk) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_in || _stopped) return false;
+            chunk = std::move(_carry);
+            auto old = chunk.size();
+            chunk.resize(old + _chunk_bytes);
+            _in.read(&chunk[old], std::streamsize(_chunk_bytes));
+            chunk.resize(old + std::size_t(_in.gcount()));
+            auto nl = chunk.rfind('\n');
+            _carry.clear();
+            if (_in && nl != std::string::npos) {
+               _carry.assign(chunk, nl + 1, std::string::npos);
+               chunk.resize(nl + 1);
+            }
+            return !chunk.empty();
+         }
+
+         void stop() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopped = true;
+         }
+
+       private:
+         std::mutex _mutex;
+         std::istream& _in;
+         std::size_t _chunk_bytes;
+         std::string _carry;
+         bool _stopped = false;
+      };
+
+      void check_pool(const pool& p, const pool_totals& t, std::vector<discrepancy>& out) {
+         auto report = [&](std::string what) { out.push_back({p.contract, p.id, 0, std::move(what)}); };
+
+         if (t.staked != p.total_staked) {
+            report("total_staked " + std::to_string(p.total_staked) + " but miners hold " + to_string(t.staked));
+         }
+         if (p.released_reward > p.total_reward) {
+            report("released " + std::to_string(p.released_reward) + " above total reward " +
+                   std::to_string(p.total_reward));
+         }
+         if (p.duration > 0) {
+            uint32_t elapsed = p.last_harvest_time > p.epoch_time ? p.last_harvest_time - p.epoch_time : 0;
+            auto emitted = p.schedule == schedule::halving
+                              ? emission::halving_emitted(p.total_reward, p.duration, elapsed)
+                              : emission::linear_emitted(p.total_reward, p.duration, elapsed);
+            if (p.released_reward > emitted) {
+               report("released " + std::to_string(p.released_reward) + " ahead of the schedule, " +
+                      std::to_string(emitted) + " emitted at the last harvest");
+            }
+         }
+
+         // v2 settles round every miner down against debts that were rounded
+         // down too, so each miner may come out one unit ahead
+         uint128 dust = p.version == 2 ? t.miners : 0;
+         for (std::size_t k = 0; k < p.rewards.size(); k++) {
+            auto owed = t.rewards[k].claimed + t.rewards[k].claimable;
+            if (owed > p.rewards[k].released + dust) {
+               report("miners are owed " + to_string(owed) + " " + token_label(k) + " but only " +
+                      std::to_string(p.rewards[k].released) + " was released");
+            }
+         }
+      }
+
+   } // namespace
+
+   std::vector<pool> read_pools(std::istream& in) {
+      std::vector<pool> pools;
+      std::string text;
+      std::size_t number = 0;
+      while (std::getline(in, text)) {
+         number++;
+         auto line = trim_cr(text);
+         if (skip_line(line)) continue;
+         try {
+            fields f{line.data(), line.data() + line.size()};
+            pool p;
+            p.contract = f.account();
+            p.version = uint32_t(f.u64());
+            if (p.version != 1 && p.version != 2) throw std::runtime_error("unknown version");
+            auto emission = f.next();
+            if (emission == "halving") {
+               p.schedule = schedule::halving;
+            } else if (emission == "linear") {
+               if (p.version == 1) throw std::runtime_error("v1 pools halve");
+               p.schedule = schedule::linear;
+            } else {
+               throw std::runtime_error("unknown schedule '" + std::string(emission) + "'");
+            }
+            p.id = f.u64();
+            p.total_staked = f.amount();
+            p.total_reward = f.amount();
+            p.released_reward = f.amount();
+            p.epoch_time = uint32_t(f.u64());
+            p.duration = uint32_t(f.u64());
+            p.last_harvest_time = uint32_t(f.u64());
+            reward crl;
+            crl.released = p.released_reward;
+            crl.per_share = f.u128();
+            p.rewards.push_back(crl);
+            while (f.more()) {
+               if (p.version == 1) throw std::runtime_error("v1 pools carry CRL only");
+               if (p.rewards.size() == max_rewards) throw std::runtime_error("too many reward tokens");
+               reward r;
+               r.released = f.amount();
+               r.per_share = f.u128();
+               p.rewards.push_back(r);
+            }
+            f.done();
+            pools.push_back(p);
+         } catch (const std::exception& e) {
+            throw std::runtime_error("pools dump line " + std::to_string(number) + ": " + e.what());
+         }
+      }
+      return pools;
+   }
+
+   result run(std::vector<pool> pools, std::istream& miners, const options& opts) {
+      result r;
+      r.pools = std::move(pools);
+      auditor a(r.pools, opts);
+
+      unsigned threads = std::max(1u, opts.threads);
+      // roughly block_rows rows per chunk at ~100 bytes a row
+      chunk_reader reader(miners, std::max<std::size_t>(opts.block_rows * 100, 4096));
+      std::vector<worker_state> states(threads);
+      std::vector<std::vector<discrepancy>> orphans(threads);
+      std::exception_ptr error;
+      std::mutex error_mutex;
+
+      std::vector<std::thread> workers;
+      for (unsigned t = 0; t < threads; t++) {
+         workers.emplace_back([&, t] {
+            auto& w = states[t];
+            w.totals = empty_totals(r.pools);
+            std::string chunk;
+            try {
+               while (reader.next(chunk)) {
+                  a.parse(chunk, w, orphans[t]);
+                  a.audit_block(w);
+               }
+            } catch (...) {
+               std::lock_guard<std::mutex> lock(error_mutex);
+               if (!error) error = std::current_exception();
+               reader.stop();
+            }
+         });
+      }
+      for (auto& t : workers) t.join();
+      if (error) std::rethrow_exception(error);
+
+      r.totals = empty_totals(r.pools);
+      for (auto& w : states) {
+         for (std::size_t i = 0; i < r.totals.size(); i++) {
+            auto& t = r.totals[i];
+            t.miners += w.totals[i].miners;
+            t.staked += w.totals[i].staked;
+            for (std::size_t k = 0; k < t.rewards.size(); k++) {
+               t.rewards[k].claimed += w.totals[i].rewards[k].claimed;
+               t.rewards[k].claimable += w.totals[i].rewards[k].claimable;
+            }
+         }
+         r.miner_rows += w.rows;
+      }
+
+      for (std::size_t i = 0; i < r.pools.size(); i++) {
+         check_pool(r.pools[i], r.totals[i], r.discrepancies);
+      }
+      for (auto& o : orphans) {
+         r.discrepancies.insert(r.discrepancies.end(), o.begin(), o.end());
+      }
+      std::size_t kept = 0;
+      for (auto& w : states) {
+         for (auto& d : w.discrepancies) {
+            if (kept++ < opts.max_miner_discrepancies) {
+               r.discrepancies.push_back(std::move(d));
+            } else {
+               r.skipped_miner_discrepancies++;
+            }
+         }
+         r.skipped_miner_discrepancies += w.skipped;
+      }
+      return r;
+   }
+
+   void print_report(std::ostream& out, const result& r) {
+      out << "audited " << r.pools.size() << " pools, " << r.miner_rows << " miners\n";
+      for (std::size_t i = 0; i < r.pools.size(); i++) {
+         auto& p = r.pools[i];
+         auto& t = r.totals[i];
+         out << pool_label(p.contract, p.id) << " v" << p.version
+             << (p.schedule == schedule::halving ? " halving" : " linear") << ": " << t.miners << " miners, staked "
+             << to_string(t.staked) << ", released " << p.released_reward << ", claimed "
+             << to_string(t.rewards[0].claimed) << ", claimable " << to_string(t.rewards[0].claimable);
+         for (std::size_t k = 1; k < p.rewards.size(); k++) {
+            out << ", " << token_label(k) << " released " << p.rewards[k].released << " claimed "
+                << to_string(t.rewards[k].claimed) << " claimable " << to_string(t.rewards[k].claimable);
+         }
+         out << "\n";
+      }
+      if (r.discrepancies.empty()) {
+         out << "no discrepancies\n";
+         return;
+      }
+      out << r.discrepancies.size() + r.skipped_miner_discrepancies << " discrepancies\n";
+      for (auto& d : r.discrepancies) {
+         out << "  " << pool_label(d.contract, d.pool_id);
+         if (d.owner != 0) out << " " << eosio::name(d.owner).to_string();
+         out << ": " << d.what << "\n";
+      }
+      if (r.skipped_miner_discrepancies > 0) {
+         out << "  ... " << r.skipped_miner_discrepancies << " more\n";
+      }
+   }
+
+} // namespace audit
@@ -0,0 +1,104 @@
+// Off-chain reward audit of the pools contracts.
+//
+// The auditor reads CSV dumps of the pools and miner tables and checks every
+// pool against the emission schedule and its miners with the same math the
+// contracts use (common/include/emission.hpp). Amounts are raw integer units.
+//
+//    pools:  contract,version,schedule,id,total_staked,total_reward,
+//            released_reward,epoch_time,duration,last_harvest_time,
+//            crl_per_share[,released,per_share]...
+//    miners: contract,pool_id,owner,staked,claimed_crl,unclaimed_crl,crl_debt
+//            [,claimed,unclaimed,debt]...
+//
+// A v2 pool lists the reward tokens it carries besides CRL in the pool's
+// order, and its miners one triple per token in the same order, zeros for a
+// token the miner hasn't settled yet. v1 pools carry CRL only, with the
+// per-share and debt columns at 0. The schedule is how the pool's CRL is
+// emitted, `halving` or `linear`: v1 pools halve, v2 pools are linear unless
+// they were carried over from v1 (source REWARD_HALVING of their CRL).
+//
+// Lines starting with `#` are skipped, so a header line can be commented out.
+//
+// Miner rows are processed in blocks laid out as structure-of-arrays columns,
+// with parsing and the kernels spread over a thread pool, so dumps of tens of
+// millions of rows stream through without being held in memory.
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace audit {
+
+   typedef unsigned __int128 uint128;
+
+   /// Reward tokens a pool can carry, CRL included (MAX_REWARDS of poolv2).
+   const std::size_t max_rewards = 8;
+
+   /// How a pool emits its CRL.
+   enum class schedule { halving, linear };
+
+   /// One reward token of a pool, CRL first.
+   struct reward {
+      uint64_t released = 0;
+      uint128 per_share = 0;
+   };
+
+   struct pool {
+      uint64_t contract = 0;
+      uint32_t version = 1;
+      audit::schedule schedule = schedule::halving;
+      uint64_t id = 0;
+      uint64_t total_staked = 0;
+      uint64_t total_reward = 0;
+      uint64_t released_reward = 0;
+      uint32_t epoch_time = 0;
+      uint32_t duration = 0;
+      uint32_t last_harvest_time = 0;
+      std::vector<reward> rewards;  // rewards[0].released is released_reward
+   };
+
+   /// What the miners of a pool add up to for one reward token.
+   struct reward_totals {
+      uint128 claimed = 0;
+      uint128 claimable = 0;      // unclaimed plus not yet settled
+   };
+
+   /// What the miners of one pool add up to.
+   struct pool_totals {
+      uint64_t miners = 0;
+      uint128 staked = 0;
+      std::vector<reward_totals> rewards; // parallel to pool::rewards
+   };
+
+   struct discrepancy {
+      uint64_t contract;
+      uint64_t pool_id;
+      uint64_t owner;             // 0 for pool-level findings
+      std::string what;
+   };
+
+   struct result {
+      std::vector<pool> pools;
+      std::vector<pool_totals> totals; // parallel to pools
+      std::vector<discrepancy> discrepancies;
+      uint64_t miner_rows = 0;
+      uint64_t skipped_miner_discrepancies = 0;
+   };
+
+   struct options {
+      unsigned threads = 1;
+      std::size_t block_rows = 1 << 16;
+      std::size_t max_miner_discrepancies = 1000;
+   };
+
+   std::vector<pool> read_pools(std::istream& in);
+
+   /// Streams the miners dump against `pools` and checks everything.
+   result run(std::vector<pool> pools, std::istream& miners, const options& opts);
+
+   void print_report(std::ostream& out, const result& r);
+
+} // namespace audit
@@ -0,0 +1,87 @@
+// host_audit: checks dumps of the pools and miners tables (see audit.hpp)
+// against the emission schedule and reports discrepancies.
+//
+//    host_audit [--jobs N] [--max-findings N] POOLS MINERS
+//
+// MINERS may be `-` to stream the dump from stdin. Exits with 1 when there
+// are discrepancies, 2 on errors.
+#include "audit.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+
+   struct options {
+      unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+      std::size_t max_findings = 1000;
+      std::string pools;
+      std::string miners;
+   };
+
+   options parse_options(int argc, char** argv) {
+      options opts;
+      for (int i = 1; i < argc; i++) {
+         std::string arg = argv[i];
+         auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error(arg + " needs a value");
+            return argv[++i];
+         };
+         if (arg == "--jobs") {
+            opts.jobs = unsigned(std::max(1, std::stoi(value())));
+         } else if (arg == "--max-findings") {
+            opts.max_findings = std::stoul(value());
+         } else if (!arg.empty() && (arg[0] != '-' || arg == "-") && opts.pools.empty()) {
+            opts.pools = arg;
+         } else if (!arg.empty() && (arg[0] != '-' || arg == "-") && opts.miners.empty()) {
+            opts.miners = arg;
+         } else {
+            throw std::runtime_error("unknown argument " + arg);
+         }
+      }
+      if (opts.pools.empty() || opts.miners.empty()) {
+         throw std::runtime_error("usage: host_audit [--jobs N] [--max-findings N] POOLS MINERS");
+      }
+      return opts;
+   }
+
+} // namespace
+
+int main(int argc, char** argv) {
+   try {
+      auto opts = parse_options(argc, argv);
+      std::ifstream pools_in(opts.pools);
+      if (!pools_in) throw std::runtime_error("cannot read " + opts.pools);
+      auto pools = audit::read_pools(pools_in);
+
+      std::ifstream miners_file;
+      std::istream* miners_in = &std::cin;
+      if (opts.miners != "-") {
+         miners_file.open(opts.miners, std::ios::binary);
+         if (!miners_file) throw std::runtime_error("cannot read " + opts.miners);
+         miners_in = &miners_file;
+      }
+
+      audit::options audit_opts;
+      audit_opts.threads = opts.jobs;
+      audit_opts.max_miner_discrepancies = opts.max_findings;
+
+      auto start = std::chrono::steady_clock::now();
+      auto result = audit::run(std::move(pools), *miners_in, audit_opts);
+      auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      audit::print_report(std::cout, result);
+      std::fprintf(stderr, "%llu miner rows in %.2f s on %u threads\n", (unsigned long long)result.miner_rows, seconds,
+                   opts.jobs);
+      return result.discrepancies.empty() ? 0 : 1;
+   } catch (const std::exception& e) {
+      std::fprintf(stderr, "host_audit: %s\n", e.what());
+      return 2;
+   }
+}
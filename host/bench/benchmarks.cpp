@@ -0,0 +1,251 @@
+// Scaling benchmarks of the pool and token actions over the native build.
+//
+// Every benchmark reports wall time per action plus what the action did to
+// the database (rows read and written, bytes) and the heap it needed above
+// the chain state, averaged over iterations. Run with
+// --benchmark_out=results.json --benchmark_out_format=json (or the bench_json
+// target) to get results that can be compared between commits.
+//
+// Worlds are expensive to populate at a million miners, so benchmarks are
+// registered grouped by world and each world is built once per group.
+#include "heap.hpp"
+
+#include <host/coral.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace host;
+using eosio::asset;
+using eosio::symbol;
+
+namespace {
+
+   const uint32_t duration = 86400 * 365;
+   // split between the pools, the contract caps the reward committed over all of them
+   const int64_t total_reward = 250000000000000;
+   const int64_t stake_amount = 10000;
+
+   symbol pool_symbol(uint32_t pool) {
+      std::string code = "P";
+      do {
+         code += char('A' + pool % 26);
+         pool /= 26;
+      } while (pool > 0);
+      return symbol(code, 4);
+   }
+
+   // `pools` pools with the same `miners` miners staked in each of them
+   struct world {
+      chain c;
+      coral::version v;
+      uint32_t pools;
+      uint32_t miners;
+      uint32_t next_account;
+
+      world(coral::version v, uint32_t pools, uint32_t miners) : v(v), pools(pools), miners(miners) {
+         coral::deploy(c, v);
+         for (uint32_t i = 0; i < miners; i++) {
+            c.create_account(coral::miner_name(i));
+         }
+         next_account = miners;
+
+         for (uint32_t p = 0; p < pools; p++) {
+            auto sym = pool_symbol(p);
+            coral::create_stake_symbol(c, sym);
+            coral::create_pool(c, v, asset(total_reward / pools, coral::crl_symbol), c.time(), duration, sym);
+            // every miner gets enough for a large number of later stakes
+            auto total = asset(int64_t(miners) * stake_amount * 1000, sym);
+            c.push(coral::stake_token, name("issue"), coral::stake_token, coral::stake_token, total, std::string());
+            std::vector<coral::transfer_entry> batch;
+            for (uint32_t i = 0; i < miners; i++) {
+               batch.push_back({coral::miner_name(i), asset(stake_amount * 1000, sym), ""});
+               if (batch.size() == 500 || i + 1 == miners) {
+                  c.push(coral::stake_token, name("transfers"), coral::stake_token, coral::stake_token, batch);
+                  batch.clear();
+               }
+            }
+            auto memo = "pool:" + std::to_string(p + 1);
+            for (uint32_t i = 0; i < miners; i++) {
+               coral::stake(c, coral::miner_name(i), asset(stake_amount * (1 + i % 7), sym), memo);
+            }
+         }
+         c.produce_blocks(3600);
+         harvest(1);
+      }
+
+      transaction_trace harvest(uint64_t pool_id) {
+         if (v == coral::version::v1) {
+            return c.push(coral::pools, name("harvest"), coral::manager, pool_id, uint32_t(0));
+         }
+         return c.push(coral::pools, name("harvest"), coral::manager, pool_id);
+      }
+   };
+
+   std::unique_ptr<world> current_world;
+
+   world& get_world(coral::version v, uint32_t pools, uint32_t miners) {
+      auto& w = current_world;
+      if (!w || w->v != v || w->pools != pools || w->miners != miners) {
+         w.reset();
+         w = std::make_unique<world>(v, pools, miners);
+      }
+      return *w;
+   }
+
+   // Accumulates the cost of the measured actions and reports it per iteration.
+   struct meter {
+      benchmark::State& state;
+      counters total;
+      std::size_t peak_heap = 0;
+
+      explicit meter(benchmark::State& s) : state(s) {}
+
+      template <typename F>
+      void run(name action, F&& f) {
+         heap::reset_peak();
+         state.ResumeTiming();
+         auto trace = f();
+         state.PauseTiming();
+         peak_heap = std::max(peak_heap, heap::peak_since_reset());
+         total += trace.cost_of(coral::pools, action);
+         total += trace.cost_of(coral::stake_token, action);
+      }
+
+      ~meter() {
+         auto avg = [](uint64_t v) { return benchmark::Counter(double(v), benchmark::Counter::kAvgIterations); };
+         state.counters["db_reads"] = avg(total.db_reads);
+         state.counters["db_writes"] = avg(total.db_writes);
+         state.counters["rows_touched"] = avg(total.db_reads + total.db_writes);
+         state.counters["bytes"] = avg(total.bytes_read + total.bytes_written);
+         state.counters["inline_actions"] = avg(total.inline_actions);
+         state.counters["peak_heap_bytes"] = double(peak_heap);
+      }
+   };
+
+   // Runs `op` every iteration with the timer paused around everything else.
+   template <typename F>
+   void measure(benchmark::State& state, F&& op) {
+      meter m(state);
+      for (auto _ : state) {
+         state.PauseTiming();
+         op(m);
+         state.ResumeTiming();
+      }
+   }
+
+   void bm_harvest(benchmark::State& state, coral::version v, uint32_t pools, uint32_t miners) {
+      auto& w = get_world(v, pools, miners);
+      measure(state, [&](meter& m) {
+         w.c.produce_blocks(60);
+         m.run(name("harvest"), [&] { return w.harvest(1); });
+      });
+   }
+
+   void bm_harvestall(benchmark::State& state, coral::version v, uint32_t pools, uint32_t miners) {
+      auto& w = get_world(v, pools, miners);
+      std::vector<uint64_t> ids;
+      for (uint32_t p = 1; p <= pools; p++) ids.push_back(p);
+      measure(state, [&](meter& m) {
+         w.c.produce_blocks(60);
+         m.run(name("harvestall"), [&] {
+            return w.c.push(coral::pools, name("harvestall"), coral::manager, ids, uint32_t(0xffffffff));
+         });
+      });
+   }
+
+   void bm_stake(benchmark::State& state, coral::version v, uint32_t pools, uint32_t miners) {
+      auto& w = get_world(v, pools, miners);
+      uint32_t i = 0;
+      measure(state, [&](meter& m) {
+         auto miner = coral::miner_name(i++ % miners);
+         m.run(name("transfer"), [&] { return coral::stake(w.c, miner, asset(1, pool_symbol(0)), "pool:1"); });
+      });
+   }
+
+   void bm_stake_new(benchmark::State& state, coral::version v, uint32_t pools, uint32_t miners) {
+      auto& w = get_world(v, pools, miners);
+      measure(state, [&](meter& m) {
+         auto miner = coral::miner_name(w.next_account++);
+         coral::fund(w.c, miner, asset(stake_amount, pool_symbol(0)));
+         m.run(name("transfer"), [&] { return coral::stake(w.c, miner, asset(stake_amount, pool_symbol(0)), "pool:1"); });
+      });
+   }
+
+   void bm_claim(benchmark::State& state, coral::version v, uint32_t pools, uint32_t miners) {
+      auto& w = get_world(v, pools, miners);
+      uint32_t i = 0;
+      measure(state, [&](meter& m) {
+         // every miner has something to claim once after each harvest
+         if (i % miners == 0) {
+            w.c.produce_blocks(60);
+            w.harvest(1);
+         }
+         auto miner = coral::miner_name(i++ % miners);
+         m.run(name("claim"), [&] { return w.c.push(coral::pools, name("claim"), miner, miner, uint64_t(1)); });
+      });
+   }
+
+   void bm_withdraw(benchmark::State& state, coral::version v, uint32_t pools, uint32_t miners) {
+      auto& w = get_world(v, pools, miners);
+      uint32_t i = 0;
+      measure(state, [&](meter& m) {
+         auto miner = coral::miner_name(i++ % miners);
+         m.run(name("withdraw"), [&] { return w.c.push(coral::pools, name("withdraw"), miner, miner, uint64_t(1)); });
+         coral::stake(w.c, miner, asset(stake_amount, pool_symbol(0)), "pool:1");
+      });
+   }
+
+   void bm_transfer(benchmark::State& state, coral::version v, uint32_t pools, uint32_t miners) {
+      auto& w = get_world(v, pools, miners);
+      uint32_t i = 0;
+      measure(state, [&](meter& m) {
+         auto from = coral::miner_name(i % miners);
+         auto to = coral::miner_name((i + 1) % miners);
+         i++;
+         m.run(name("transfer"), [&] {
+            return w.c.push(coral::stake_token, name("transfer"), from, from, to, asset(1, pool_symbol(0)),
+                            std::string());
+         });
+      });
+   }
+
+   typedef void (*bench_fn)(benchmark::State&, coral::version, uint32_t, uint32_t);
+
+   void add(const std::string& label, bench_fn fn, coral::version v, uint32_t pools, uint32_t miners) {
+      auto full = std::string(v == coral::version::v1 ? "v1/" : "v2/") + label + "/pools:" + std::to_string(pools) +
+                  "/miners:" + std::to_string(miners);
+      benchmark::RegisterBenchmark(full.c_str(), fn, v, pools, miners)->Unit(benchmark::kMicrosecond);
+   }
+
+} // namespace
+
+int main(int argc, char** argv) {
+   benchmark::Initialize(&argc, argv);
+   if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+   for (auto v : {coral::version::v1, coral::version::v2}) {
+      for (uint32_t miners : {100u, 1000u, 10000u, 100000u, 1000000u}) {
+         add("harvest", bm_harvest, v, 1, miners);
+         add("stake", bm_stake, v, 1, miners);
+         add("stake_new", bm_stake_new, v, 1, miners);
+         add("claim", bm_claim, v, 1, miners);
+         add("withdraw", bm_withdraw, v, 1, miners);
+         if (v == coral::version::v1) {
+            add("token_transfer", bm_transfer, v, 1, miners);
+         }
+      }
+      for (uint32_t pools : {1u, 10u, 100u, 500u}) {
+         add("harvestall", bm_harvestall, v, pools, 10);
+      }
+   }
+
+   benchmark::RunSpecifiedBenchmarks();
+   benchmark::Shutdown();
+   return 0;
+}
@@ -0,0 +1,45 @@
+#include "heap.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+
+namespace {
+   std::atomic<std::size_t> current{0};
+   std::atomic<std::size_t> peak{0};
+   std::atomic<std::size_t> base{0};
+
+   void* track(void* p) {
+      if (!p) throw std::bad_alloc();
+      auto now = current += malloc_usable_size(p);
+      auto high = peak.load();
+      while (now > high && !peak.compare_exchange_weak(high, now)) {}
+      return p;
+   }
+
+   void untrack(void* p) {
+      if (p) current -= malloc_usable_size(p);
+      std::free(p);
+   }
+} // namespace
+
+void* operator new(std::size_t n) { return track(std::malloc(n)); }
+void* operator new[](std::size_t n) { return track(std::malloc(n)); }
+void operator delete(void* p) noexcept { untrack(p); }
+void operator delete[](void* p) noexcept { untrack(p); }
+void operator delete(void* p, std::size_t) noexcept { untrack(p); }
+void operator delete[](void* p, std::size_t) noexcept { untrack(p); }
+
+namespace heap {
+
+   std::size_t in_use() { return current; }
+
+   void reset_peak() {
+      base = current.load();
+      peak = base.load();
+   }
+
+   std::size_t peak_since_reset() { return peak - base; }
+
+} // namespace heap
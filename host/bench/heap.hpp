@@ -0,0 +1,17 @@
+// Heap high-water mark of the benchmark process, the closest native stand-in
+// for how far an action grows the contract's linear memory.
+#pragma once
+
+#include <cstddef>
+
+namespace heap {
+
+   std::size_t in_use();
+
+   /// Starts a new high-water mark at the current usage.
+   void reset_peak();
+
+   /// Bytes allocated above the usage at the last reset_peak().
+   std::size_t peak_since_reset();
+
+} // namespace heap
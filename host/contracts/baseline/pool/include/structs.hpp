@@ -0,0 +1,13 @@
+#include <eosio/eosio.hpp>
+#include <eosio/system.hpp>
+#include <eosio/asset.hpp>
+
+using namespace eosio;
+using namespace std;
+
+struct transfer_args {
+    name from;
+    name to;
+    asset quantity;
+    string memo;
+};
\ No newline at end of file
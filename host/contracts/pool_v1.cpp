@@ -0,0 +1,13 @@
+// Native build of pool/src/crlpool.cpp.
+//
+// Every contract defines `crlpool`, `utils` and `apply` at global scope, so
+// they are renamed here to link side by side. The library headers come first
+// so the renames only reach the contract's own code.
+#include <eosio/eosio.hpp>
+#include <eosio/singleton.hpp>
+
+#define crlpool pool_v1
+#define utils pool_v1_utils
+#define apply pool_v1_apply
+
+#include "../../pool/src/crlpool.cpp"
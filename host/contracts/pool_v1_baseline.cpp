@@ -0,0 +1,11 @@
+// Native build of the v1 contract as deployed, kept under baseline/ so tests
+// can upgrade the state it leaves behind, see pool_v1.cpp.
+#include <eosio/eosio.hpp>
+#include <eosio/singleton.hpp>
+
+#define crlpool pool_v1_baseline
+#define utils pool_v1_baseline_utils
+#define apply pool_v1_baseline_apply
+#define transfer_args pool_v1_baseline_transfer_args
+
+#include "baseline/pool/src/crlpool.cpp"
@@ -0,0 +1,9 @@
+// Native build of poolv2/src/crlpool.cpp, see pool_v1.cpp.
+#include <eosio/eosio.hpp>
+#include <eosio/singleton.hpp>
+
+#define crlpool pool_v2
+#define utils pool_v2_utils
+#define apply pool_v2_apply
+
+#include "../../poolv2/src/crlpool.cpp"
@@ -0,0 +1,11 @@
+// Native build of the poolv2 contract as deployed, see pool_v1_baseline.cpp.
+#include <eosio/eosio.hpp>
+#include <eosio/singleton.hpp>
+
+#define crlpool pool_v2_baseline
+#define utils pool_v2_baseline_utils
+#define apply pool_v2_baseline_apply
+#define transfer_args pool_v2_baseline_transfer_args
+#define box_reward pool_v2_baseline_box_reward
+
+#include "baseline/poolv2/src/crlpool.cpp"
@@ -0,0 +1,13 @@
+// Native build of token/src/token.cpp. The cdt generates the dispatcher of
+// this contract from its action attributes, here it is spelled out.
+#include "../../token/src/token.cpp"
+
+extern "C" {
+   void token_apply(uint64_t receiver, uint64_t code, uint64_t action) {
+      if (code == receiver) {
+         switch (action) {
+            EOSIO_DISPATCH_HELPER(token, (create)(issue)(retire)(transfer)(transfers)(open)(close))
+         }
+      }
+   }
+}
@@ -0,0 +1,135 @@
+/**
+ *  @file
+ *  Native stand-in for the cdt action API: authorization checks,
+ *  notifications, action data access and inline action dispatch. Every call
+ *  lands in the host chain's current apply context.
+ */
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/name.hpp>
+
+#include <boost/preprocessor/seq/for_each.hpp>
+#include <boost/preprocessor/stringize.hpp>
+
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace eosio {
+
+   namespace internal_use_do_not_use {
+      extern "C" {
+      uint32_t read_action_data(void* msg, uint32_t len);
+      uint32_t action_data_size();
+      void require_recipient(uint64_t name);
+      void require_auth(uint64_t name);
+      bool has_auth(uint64_t name);
+      bool is_account(uint64_t name);
+      void send_inline(char* serialized_action, std::size_t size);
+      uint64_t current_receiver();
+      void set_action_return_value(void* return_value, std::size_t size);
+      }
+   } // namespace internal_use_do_not_use
+
+   inline uint32_t read_action_data(void* msg, uint32_t len) {
+      return internal_use_do_not_use::read_action_data(msg, len);
+   }
+
+   inline uint32_t action_data_size() { return internal_use_do_not_use::action_data_size(); }
+
+   inline void require_recipient(name notify_account) {
+      internal_use_do_not_use::require_recipient(notify_account.value);
+   }
+
+   template <typename... accounts>
+   void require_recipient(name notify_account, accounts... remaining_accounts) {
+      require_recipient(notify_account);
+      require_recipient(remaining_accounts...);
+   }
+
+   inline void require_auth(name n) { internal_use_do_not_use::require_auth(n.value); }
+
+   inline bool has_auth(name n) { return internal_use_do_not_use::has_auth(n.value); }
+
+   inline bool is_account(name n) { return internal_use_do_not_use::is_account(n.value); }
+
+   inline name current_receiver() { return name{internal_use_do_not_use::current_receiver()}; }
+
+   template <typename T>
+   T unpack_action_data() {
+      std::size_t size = action_data_size();
+      std::vector<char> buffer(size);
+      read_action_data(buffer.data(), (uint32_t)size);
+      return unpack<T>(buffer.data(), size);
+   }
+
+   struct permission_level {
+      permission_level(name a, name p) : actor(a), permission(p) {}
+      permission_level() {}
+
+      name actor;
+      name permission;
+
+      friend constexpr bool operator==(const permission_level& a, const permission_level& b) {
+         return a.actor == b.actor && a.permission == b.permission;
+      }
+
+      EOSLIB_SERIALIZE(permission_level, (actor)(permission))
+   };
+
+   struct action {
+      eosio::name account;
+      eosio::name name;
+      std::vector<permission_level> authorization;
+      std::vector<char> data;
+
+      action() = default;
+
+      template <typename T>
+      action(const permission_level& auth, eosio::name a, eosio::name n, T&& value)
+          : account(a), name(n), authorization(1, auth), data(pack(std::forward<T>(value))) {}
+
+      template <typename T>
+      action(std::vector<permission_level> auths, eosio::name a, eosio::name n, T&& value)
+          : account(a), name(n), authorization(std::move(auths)), data(pack(std::forward<T>(value))) {}
+
+      EOSLIB_SERIALIZE(action, (account)(name)(authorization)(data))
+
+      void send() const {
+         auto serialize = pack(*this);
+         internal_use_do_not_use::send_inline(serialize.data(), serialize.size());
+      }
+
+      template <typename T>
+      T data_as() {
+         return unpack<T>(data);
+      }
+   };
+
+   namespace detail {
+      template <typename T>
+      struct member_traits;
+
+      template <typename C, typename R, typename... Args>
+      struct member_traits<R (C::*)(Args...)> {
+         using class_type = C;
+         using return_type = R;
+         using args_tuple = std::tuple<std::decay_t<Args>...>;
+      };
+
+      template <typename Contract, typename Method>
+      void send_inline_action(const Contract& self, struct name act, std::vector<permission_level> auths,
+                              typename member_traits<Method>::args_tuple args) {
+         action(std::move(auths), self.get_self(), act, args).send();
+      }
+   } // namespace detail
+
+} // namespace eosio
+
+#define SEND_INLINE_ACTION(CONTRACT_CLASS, NAME, ...)                                                   \
+   ::eosio::detail::send_inline_action<std::decay_t<decltype(CONTRACT_CLASS)>,                           \
+                                       decltype(&std::decay_t<decltype(CONTRACT_CLASS)>::NAME)>(         \
+       CONTRACT_CLASS, ::eosio::name(#NAME), __VA_ARGS__)
@@ -0,0 +1,143 @@
+/**
+ *  @file
+ *  Native stand-in for `eosio::asset`, with the same range and symbol checks
+ *  as the cdt implementation.
+ */
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/symbol.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+
+namespace eosio {
+
+   struct asset {
+      int64_t amount = 0;
+      eosio::symbol symbol;
+
+      static constexpr int64_t max_amount = (1LL << 62) - 1;
+
+      asset() {}
+      asset(int64_t a, eosio::symbol s) : amount(a), symbol{s} {
+         check(is_amount_within_range(), "magnitude of asset amount must be less than 2^62");
+         check(symbol.is_valid(), "invalid symbol name");
+      }
+
+      bool is_amount_within_range() const { return -max_amount <= amount && amount <= max_amount; }
+      bool is_valid() const { return is_amount_within_range() && symbol.is_valid(); }
+
+      void set_amount(int64_t a) {
+         amount = a;
+         check(is_amount_within_range(), "magnitude of asset amount must be less than 2^62");
+      }
+
+      asset operator-() const {
+         asset r = *this;
+         r.amount = -r.amount;
+         return r;
+      }
+
+      asset& operator-=(const asset& a) {
+         check(a.symbol == symbol, "attempt to subtract asset with different symbol");
+         amount -= a.amount;
+         check(-max_amount <= amount, "subtraction underflow");
+         check(amount <= max_amount, "subtraction overflow");
+         return *this;
+      }
+
+      asset& operator+=(const asset& a) {
+         check(a.symbol == symbol, "attempt to add asset with different symbol");
+         amount += a.amount;
+         check(-max_amount <= amount, "addition underflow");
+         check(amount <= max_amount, "addition overflow");
+         return *this;
+      }
+
+      friend asset operator+(const asset& a, const asset& b) {
+         asset result = a;
+         result += b;
+         return result;
+      }
+
+      friend asset operator-(const asset& a, const asset& b) {
+         asset result = a;
+         result -= b;
+         return result;
+      }
+
+      asset& operator*=(int64_t a) {
+         __int128 tmp = (__int128)amount * (__int128)a;
+         check(tmp <= max_amount, "multiplication overflow");
+         check(tmp >= -max_amount, "multiplication underflow");
+         amount = (int64_t)tmp;
+         return *this;
+      }
+
+      friend asset operator*(const asset& a, int64_t b) {
+         asset result = a;
+         result *= b;
+         return result;
+      }
+
+      asset& operator/=(int64_t a) {
+         check(a != 0, "divide by zero");
+         check(!(amount == std::numeric_limits<int64_t>::min() && a == -1), "signed division overflow");
+         amount /= a;
+         return *this;
+      }
+
+      friend asset operator/(const asset& a, int64_t b) {
+         asset result = a;
+         result /= b;
+         return result;
+      }
+
+      friend bool operator==(const asset& a, const asset& b) {
+         check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+         return a.amount == b.amount;
+      }
+      friend bool operator!=(const asset& a, const asset& b) { return !(a == b); }
+      friend bool operator<(const asset& a, const asset& b) {
+         check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+         return a.amount < b.amount;
+      }
+      friend bool operator<=(const asset& a, const asset& b) {
+         check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+         return a.amount <= b.amount;
+      }
+      friend bool operator>(const asset& a, const asset& b) {
+         check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+         return a.amount > b.amount;
+      }
+      friend bool operator>=(const asset& a, const asset& b) {
+         check(a.symbol == b.symbol, "comparison of assets with different symbols is not allowed");
+         return a.amount >= b.amount;
+      }
+
+      std::string to_string() const {
+         bool negative = amount < 0;
+         uint64_t abs_amount = negative ? -(uint64_t)amount : (uint64_t)amount;
+         uint8_t precision = symbol.precision();
+         std::string digits = std::to_string(abs_amount);
+         if (precision > 0) {
+            if (digits.size() <= precision) {
+               digits.insert(0, precision + 1 - digits.size(), '0');
+            }
+            digits.insert(digits.size() - precision, ".");
+         }
+         return (negative ? "-" : "") + digits + " " + symbol.code().to_string();
+      }
+   };
+
+   struct extended_asset {
+      asset quantity;
+      name contract;
+
+      extended_asset() = default;
+      extended_asset(asset a, name c) : quantity(a), contract(c) {}
+   };
+
+} // namespace eosio
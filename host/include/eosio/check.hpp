@@ -0,0 +1,39 @@
+/**
+ *  @file
+ *  Native stand-in for the cdt assertion helpers. A failed `check` throws
+ *  `eosio::eosio_assert_exception` so the host chain can unwind the action.
+ */
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace eosio {
+
+   struct eosio_assert_exception : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   [[noreturn]] inline void eosio_assert_fail(std::string_view msg) {
+      throw eosio_assert_exception(std::string(msg));
+   }
+
+   inline void check(bool pred, const char* msg) {
+      if (!pred) eosio_assert_fail(msg);
+   }
+
+   inline void check(bool pred, const std::string& msg) {
+      if (!pred) eosio_assert_fail(msg);
+   }
+
+   inline void check(bool pred, std::string_view msg) {
+      if (!pred) eosio_assert_fail(msg);
+   }
+
+   inline void check(bool pred, uint64_t code) {
+      if (!pred) eosio_assert_fail("assertion failure with error code: " + std::to_string(code));
+   }
+
+} // namespace eosio
@@ -0,0 +1,33 @@
+/**
+ *  @file
+ *  Native stand-in for `eosio::contract` and the cdt attribute macros.
+ */
+#pragma once
+
+#include <eosio/datastream.hpp>
+#include <eosio/name.hpp>
+
+#define CONTRACT class [[eosio::contract]]
+#define ACTION [[eosio::action]] void
+#define TABLE struct [[eosio::table]]
+
+namespace eosio {
+
+   class contract {
+   public:
+      contract(name self, name first_receiver, datastream<const char*> ds)
+          : _self(self), _first_receiver(first_receiver), _ds(ds) {}
+
+      inline name get_self() const { return _self; }
+      inline name get_code() const { return _first_receiver; }
+      inline name get_first_receiver() const { return _first_receiver; }
+      inline datastream<const char*>& get_datastream() { return _ds; }
+      inline const datastream<const char*>& get_datastream() const { return _ds; }
+
+   protected:
+      name _self;
+      name _first_receiver;
+      datastream<const char*> _ds = datastream<const char*>(nullptr, 0);
+   };
+
+} // namespace eosio
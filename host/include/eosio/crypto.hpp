@@ -0,0 +1,61 @@
+/**
+ *  @file
+ *  Native stand-in for `eosio::checksum256` and the cdt `sha256` helper.
+ */
+#pragma once
+
+#include <eosio/datastream.hpp>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace eosio {
+
+   namespace internal_use_do_not_use {
+      extern "C" {
+      void sha256(const char* data, uint32_t length, void* hash);
+      }
+   } // namespace internal_use_do_not_use
+
+   /// Bytes of a fixed size, compared and serialized as they are.
+   template <std::size_t Size>
+   class fixed_bytes {
+   public:
+      fixed_bytes() : _data{} {}
+      fixed_bytes(const std::array<uint8_t, Size>& bytes) : _data(bytes) {}
+
+      std::array<uint8_t, Size> extract_as_byte_array() const { return _data; }
+      const uint8_t* data() const { return _data.data(); }
+      uint8_t* data() { return _data.data(); }
+      static constexpr std::size_t size() { return Size; }
+
+      friend bool operator==(const fixed_bytes& a, const fixed_bytes& b) { return a._data == b._data; }
+      friend bool operator!=(const fixed_bytes& a, const fixed_bytes& b) { return a._data != b._data; }
+      friend bool operator<(const fixed_bytes& a, const fixed_bytes& b) { return a._data < b._data; }
+
+   private:
+      std::array<uint8_t, Size> _data;
+   };
+
+   using checksum256 = fixed_bytes<32>;
+
+   template <typename DataStream, std::size_t Size>
+   DataStream& operator<<(DataStream& ds, const fixed_bytes<Size>& v) {
+      ds.write((const char*)v.data(), Size);
+      return ds;
+   }
+
+   template <typename DataStream, std::size_t Size>
+   DataStream& operator>>(DataStream& ds, fixed_bytes<Size>& v) {
+      ds.read((char*)v.data(), Size);
+      return ds;
+   }
+
+   inline checksum256 sha256(const char* data, uint32_t length) {
+      checksum256 hash;
+      internal_use_do_not_use::sha256(data, length, hash.data());
+      return hash;
+   }
+
+} // namespace eosio
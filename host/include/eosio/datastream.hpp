@@ -0,0 +1,491 @@
+/**
+ *  @file
+ *  Native stand-in for the cdt `datastream` and its binary serializers.
+ *
+ *  The wire format matches the chain ABI: fixed-width little-endian
+ *  integers, varuint32 length prefixes and field-by-field structs. Plain
+ *  aggregates (every `TABLE` and action argument struct in the contracts)
+ *  are walked with structured bindings, which is what the cdt gets from
+ *  its reflection plugin; anything else uses `EOSLIB_SERIALIZE`.
+ */
+#pragma once
+
+#include <eosio/asset.hpp>
+#include <eosio/check.hpp>
+#include <eosio/name.hpp>
+#include <eosio/symbol.hpp>
+
+#include <boost/preprocessor/seq/for_each.hpp>
+
+#include <array>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+typedef unsigned __int128 uint128_t;
+typedef __int128 int128_t;
+
+namespace eosio {
+
+   template <typename T>
+   class datastream {
+   public:
+      datastream(T start, std::size_t s) : _start(start), _pos(start), _end(start + s) {}
+
+      inline void skip(std::size_t s) { _pos += s; }
+
+      inline bool read(char* d, std::size_t s) {
+         check(std::size_t(_end - _pos) >= s, "datastream attempted to read past the end");
+         std::memcpy(d, _pos, s);
+         _pos += s;
+         return true;
+      }
+
+      inline bool read(void* d, std::size_t s) { return read(static_cast<char*>(d), s); }
+
+      inline bool write(const char* d, std::size_t s) {
+         check(_end - _pos >= (int32_t)s, "datastream attempted to write past the end");
+         std::memcpy((void*)_pos, d, s);
+         _pos += s;
+         return true;
+      }
+
+      inline bool write(const void* d, std::size_t s) { return write(static_cast<const char*>(d), s); }
+
+      inline bool write(char c) { return write(&c, 1); }
+
+      inline bool get(char& c) { return read(&c, 1); }
+
+      T pos() const { return _pos; }
+      inline bool valid() const { return _pos <= _end && _pos >= _start; }
+      inline bool seekp(std::size_t p) {
+         _pos = _start + p;
+         return _pos <= _end;
+      }
+      inline std::size_t tellp() const { return std::size_t(_pos - _start); }
+      inline std::size_t remaining() const { return _end - _pos; }
+
+   private:
+      T _start;
+      T _pos;
+      T _end;
+   };
+
+   template <>
+   class datastream<std::size_t> {
+   public:
+      datastream(std::size_t init_size = 0) : _size(init_size) {}
+      inline bool skip(std::size_t s) {
+         _size += s;
+         return true;
+      }
+      inline bool write(const char*, std::size_t s) {
+         _size += s;
+         return true;
+      }
+      inline bool write(const void*, std::size_t s) {
+         _size += s;
+         return true;
+      }
+      inline bool write(char) {
+         _size++;
+         return true;
+      }
+      inline bool valid() const { return true; }
+      inline bool seekp(std::size_t p) {
+         _size = p;
+         return true;
+      }
+      inline std::size_t tellp() const { return _size; }
+      inline std::size_t remaining() const { return 0; }
+
+   private:
+      std::size_t _size;
+   };
+
+   namespace _datastream_detail {
+      template <typename T>
+      struct is_datastream : std::false_type {};
+      template <typename T>
+      struct is_datastream<datastream<T>> : std::true_type {};
+
+      // Aggregate arity detection, the same trick reflection libraries use.
+      struct any_field {
+         template <typename T>
+         constexpr operator T() const noexcept;
+      };
+
+      template <typename T, typename Seq, typename = void>
+      struct brace_constructible : std::false_type {};
+
+      template <typename T, std::size_t... I>
+      struct brace_constructible<T, std::index_sequence<I...>,
+                                 std::void_t<decltype(T{(I, any_field{})...})>> : std::true_type {};
+
+      template <typename T, std::size_t N>
+      constexpr std::size_t field_count() {
+         if constexpr (N == 0) {
+            return 0;
+         } else if constexpr (brace_constructible<T, std::make_index_sequence<N>>::value) {
+            return N;
+         } else {
+            return field_count<T, N - 1>();
+         }
+      }
+
+#define EOSIO_HOST_TIE(N, ...)                                                                     \
+   if constexpr (count == N) {                                                                     \
+      auto& [__VA_ARGS__] = v;                                                                     \
+      f(__VA_ARGS__);                                                                              \
+   }
+
+      template <typename T, typename F>
+      void for_each_field(T& v, F&& f) {
+         constexpr std::size_t count = field_count<std::remove_const_t<T>, 24>();
+         static_assert(count > 0, "cannot serialize a struct without fields");
+         EOSIO_HOST_TIE(1, a1)
+         EOSIO_HOST_TIE(2, a1, a2)
+         EOSIO_HOST_TIE(3, a1, a2, a3)
+         EOSIO_HOST_TIE(4, a1, a2, a3, a4)
+         EOSIO_HOST_TIE(5, a1, a2, a3, a4, a5)
+         EOSIO_HOST_TIE(6, a1, a2, a3, a4, a5, a6)
+         EOSIO_HOST_TIE(7, a1, a2, a3, a4, a5, a6, a7)
+         EOSIO_HOST_TIE(8, a1, a2, a3, a4, a5, a6, a7, a8)
+         EOSIO_HOST_TIE(9, a1, a2, a3, a4, a5, a6, a7, a8, a9)
+         EOSIO_HOST_TIE(10, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10)
+         EOSIO_HOST_TIE(11, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11)
+         EOSIO_HOST_TIE(12, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12)
+         EOSIO_HOST_TIE(13, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13)
+         EOSIO_HOST_TIE(14, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14)
+         EOSIO_HOST_TIE(15, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15)
+         EOSIO_HOST_TIE(16, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16)
+         EOSIO_HOST_TIE(17, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17)
+         EOSIO_HOST_TIE(18, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18)
+         EOSIO_HOST_TIE(19, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18,
+                        a19)
+         EOSIO_HOST_TIE(20, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18,
+                        a19, a20)
+         EOSIO_HOST_TIE(21, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18,
+                        a19, a20, a21)
+         EOSIO_HOST_TIE(22, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18,
+                        a19, a20, a21, a22)
+         EOSIO_HOST_TIE(23, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18,
+                        a19, a20, a21, a22, a23)
+         EOSIO_HOST_TIE(24, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16, a17, a18,
+                        a19, a20, a21, a22, a23, a24)
+      }
+
+#undef EOSIO_HOST_TIE
+
+      template <typename T>
+      constexpr bool is_reflected_aggregate_v = std::is_class_v<T> && std::is_aggregate_v<T>;
+   } // namespace _datastream_detail
+
+   struct unsigned_int {
+      unsigned_int(uint32_t v = 0) : value(v) {}
+      operator uint32_t() const { return value; }
+      uint32_t value;
+   };
+
+   template <typename DataStream>
+   DataStream& operator<<(DataStream& ds, const unsigned_int& v) {
+      uint64_t val = v.value;
+      do {
+         uint8_t b = uint8_t(val) & 0x7f;
+         val >>= 7;
+         b |= ((val > 0) << 7);
+         ds.write((char)b);
+      } while (val);
+      return ds;
+   }
+
+   template <typename DataStream>
+   DataStream& operator>>(DataStream& ds, unsigned_int& vi) {
+      uint64_t v = 0;
+      char b = 0;
+      uint8_t by = 0;
+      do {
+         ds.get(b);
+         v |= uint32_t(uint8_t(b) & 0x7f) << by;
+         by += 7;
+      } while (uint8_t(b) & 0x80 && by < 32);
+      vi.value = static_cast<uint32_t>(v);
+      return ds;
+   }
+
+   // Scalars
+
+   template <typename DataStream, typename T,
+             std::enable_if_t<std::is_arithmetic_v<T> || std::is_same_v<T, uint128_t> || std::is_same_v<T, int128_t> ||
+                              std::is_enum_v<T>>* = nullptr>
+   DataStream& operator<<(DataStream& ds, const T& v) {
+      ds.write((const char*)&v, sizeof(T));
+      return ds;
+   }
+
+   template <typename DataStream, typename T,
+             std::enable_if_t<std::is_arithmetic_v<T> || std::is_same_v<T, uint128_t> || std::is_same_v<T, int128_t> ||
+                              std::is_enum_v<T>>* = nullptr>
+   DataStream& operator>>(DataStream& ds, T& v) {
+      ds.read((char*)&v, sizeof(T));
+      return ds;
+   }
+
+   template <typename DataStream>
+   DataStream& operator<<(DataStream& ds, const bool& v) {
+      return ds << uint8_t(v ? 1 : 0);
+   }
+
+   template <typename DataStream>
+   DataStream& operator>>(DataStream& ds, bool& v) {
+      uint8_t t = 0;
+      ds >> t;
+      v = t != 0;
+      return ds;
+   }
+
+   template <typename DataStream>
+   DataStream& operator<<(DataStream& ds, const name& v) {
+      return ds << v.value;
+   }
+
+   template <typename DataStream>
+   DataStream& operator>>(DataStream& ds, name& v) {
+      return ds >> v.value;
+   }
+
+   template <typename DataStream>
+   DataStream& operator<<(DataStream& ds, const symbol_code& v) {
+      return ds << v.raw();
+   }
+
+   template <typename DataStream>
+   DataStream& operator>>(DataStream& ds, symbol_code& v) {
+      uint64_t raw = 0;
+      ds >> raw;
+      v = symbol_code(raw);
+      return ds;
+   }
+
+   template <typename DataStream>
+   DataStream& operator<<(DataStream& ds, const symbol& v) {
+      return ds << v.raw();
+   }
+
+   template <typename DataStream>
+   DataStream& operator>>(DataStream& ds, symbol& v) {
+      uint64_t raw = 0;
+      ds >> raw;
+      v = symbol(raw);
+      return ds;
+   }
+
+   template <typename DataStream>
+   DataStream& operator<<(DataStream& ds, const extended_symbol& v) {
+      return ds << v.sym << v.contract;
+   }
+
+   template <typename DataStream>
+   DataStream& operator>>(DataStream& ds, extended_symbol& v) {
+      return ds >> v.sym >> v.contract;
+   }
+
+   template <typename DataStream>
+   DataStream& operator<<(DataStream& ds, const asset& v) {
+      return ds << v.amount << v.symbol;
+   }
+
+   template <typename DataStream>
+   DataStream& operator>>(DataStream& ds, asset& v) {
+      return ds >> v.amount >> v.symbol;
+   }
+
+   template <typename DataStream>
+   DataStream& operator<<(DataStream& ds, const extended_asset& v) {
+      return ds << v.quantity << v.contract;
+   }
+
+   template <typename DataStream>
+   DataStream& operator>>(DataStream& ds, extended_asset& v) {
+      return ds >> v.quantity >> v.contract;
+   }
+
+   // Containers
+
+   template <typename DataStream>
+   DataStream& operator<<(DataStream& ds, const std::string& v) {
+      ds << unsigned_int((uint32_t)v.size());
+      if (v.size()) ds.write(v.data(), v.size());
+      return ds;
+   }
+
+   template <typename DataStream>
+   DataStream& operator>>(DataStream& ds, std::string& v) {
+      unsigned_int s;
+      ds >> s;
+      v.resize(s.value);
+      if (s.value) ds.read(v.data(), s.value);
+      return ds;
+   }
+
+   template <typename DataStream, typename T>
+   DataStream& operator<<(DataStream& ds, const std::vector<T>& v) {
+      ds << unsigned_int((uint32_t)v.size());
+      for (const auto& i : v) ds << i;
+      return ds;
+   }
+
+   template <typename DataStream, typename T>
+   DataStream& operator>>(DataStream& ds, std::vector<T>& v) {
+      unsigned_int s;
+      ds >> s;
+      v.resize(s.value);
+      for (auto& i : v) ds >> i;
+      return ds;
+   }
+
+   template <typename DataStream, typename T, std::size_t N>
+   DataStream& operator<<(DataStream& ds, const std::array<T, N>& v) {
+      for (const auto& i : v) ds << i;
+      return ds;
+   }
+
+   template <typename DataStream, typename T, std::size_t N>
+   DataStream& operator>>(DataStream& ds, std::array<T, N>& v) {
+      for (auto& i : v) ds >> i;
+      return ds;
+   }
+
+   template <typename DataStream, typename T>
+   DataStream& operator<<(DataStream& ds, const std::optional<T>& v) {
+      ds << bool(v.has_value());
+      if (v) ds << *v;
+      return ds;
+   }
+
+   template <typename DataStream, typename T>
+   DataStream& operator>>(DataStream& ds, std::optional<T>& v) {
+      bool has = false;
+      ds >> has;
+      if (has) {
+         T t{};
+         ds >> t;
+         v = std::move(t);
+      } else {
+         v.reset();
+      }
+      return ds;
+   }
+
+   template <typename DataStream, typename K, typename V>
+   DataStream& operator<<(DataStream& ds, const std::pair<K, V>& v) {
+      return ds << v.first << v.second;
+   }
+
+   template <typename DataStream, typename K, typename V>
+   DataStream& operator>>(DataStream& ds, std::pair<K, V>& v) {
+      return ds >> v.first >> v.second;
+   }
+
+   template <typename DataStream, typename K, typename V>
+   DataStream& operator<<(DataStream& ds, const std::map<K, V>& v) {
+      ds << unsigned_int((uint32_t)v.size());
+      for (const auto& i : v) ds << i.first << i.second;
+      return ds;
+   }
+
+   template <typename DataStream, typename K, typename V>
+   DataStream& operator>>(DataStream& ds, std::map<K, V>& v) {
+      unsigned_int s;
+      ds >> s;
+      v.clear();
+      for (uint32_t i = 0; i < s.value; ++i) {
+         K k{};
+         V val{};
+         ds >> k >> val;
+         v.emplace(std::move(k), std::move(val));
+      }
+      return ds;
+   }
+
+   template <typename DataStream, typename... Args>
+   DataStream& operator<<(DataStream& ds, const std::tuple<Args...>& v) {
+      std::apply([&](const auto&... a) { ((ds << a), ...); }, v);
+      return ds;
+   }
+
+   template <typename DataStream, typename... Args>
+   DataStream& operator>>(DataStream& ds, std::tuple<Args...>& v) {
+      std::apply([&](auto&... a) { ((ds >> a), ...); }, v);
+      return ds;
+   }
+
+   // Plain aggregates, walked field by field.
+
+   template <typename DataStream, typename T,
+             std::enable_if_t<_datastream_detail::is_datastream<DataStream>::value &&
+                              _datastream_detail::is_reflected_aggregate_v<T>>* = nullptr>
+   DataStream& operator<<(DataStream& ds, const T& v) {
+      _datastream_detail::for_each_field(v, [&](const auto&... f) { ((ds << f), ...); });
+      return ds;
+   }
+
+   template <typename DataStream, typename T,
+             std::enable_if_t<_datastream_detail::is_datastream<DataStream>::value &&
+                              _datastream_detail::is_reflected_aggregate_v<T>>* = nullptr>
+   DataStream& operator>>(DataStream& ds, T& v) {
+      _datastream_detail::for_each_field(v, [&](auto&... f) { ((ds >> f), ...); });
+      return ds;
+   }
+
+   // Helpers
+
+   template <typename T>
+   std::size_t pack_size(const T& value) {
+      datastream<std::size_t> ps;
+      ps << value;
+      return ps.tellp();
+   }
+
+   template <typename T>
+   std::vector<char> pack(const T& value) {
+      std::vector<char> result;
+      result.resize(pack_size(value));
+      datastream<char*> ds(result.data(), result.size());
+      ds << value;
+      return result;
+   }
+
+   template <typename T>
+   T unpack(const char* buffer, std::size_t len) {
+      T result{};
+      datastream<const char*> ds(buffer, len);
+      ds >> result;
+      return result;
+   }
+
+   template <typename T>
+   T unpack(const std::vector<char>& bytes) {
+      return unpack<T>(bytes.data(), bytes.size());
+   }
+
+} // namespace eosio
+
+#define EOSIO_HOST_SERIALIZE_OUT(r, OBJ, elem) << OBJ.elem
+#define EOSIO_HOST_SERIALIZE_IN(r, OBJ, elem) >> OBJ.elem
+
+#define EOSLIB_SERIALIZE(TYPE, MEMBERS)                                                             \
+   template <typename DataStream>                                                                  \
+   friend DataStream& operator<<(DataStream& ds, const TYPE& t) {                                  \
+      return ds BOOST_PP_SEQ_FOR_EACH(EOSIO_HOST_SERIALIZE_OUT, t, MEMBERS);                        \
+   }                                                                                               \
+   template <typename DataStream>                                                                  \
+   friend DataStream& operator>>(DataStream& ds, TYPE& t) {                                        \
+      return ds BOOST_PP_SEQ_FOR_EACH(EOSIO_HOST_SERIALIZE_IN, t, MEMBERS);                         \
+   }
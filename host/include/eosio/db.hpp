@@ -0,0 +1,52 @@
+/**
+ *  @file
+ *  Declarations of the database intrinsics implemented by the host chain.
+ *
+ *  The names, signatures and iterator conventions are the ones the cdt
+ *  imports from nodeos, so contract code that talks to the `db_*` API
+ *  directly compiles unchanged against the native build.
+ */
+#pragma once
+
+#include <eosio/datastream.hpp>
+
+#include <cstdint>
+
+namespace eosio {
+   namespace internal_use_do_not_use {
+      extern "C" {
+      int32_t db_store_i64(uint64_t scope, uint64_t table, uint64_t payer, uint64_t id, const void* data, uint32_t len);
+      void db_update_i64(int32_t iterator, uint64_t payer, const void* data, uint32_t len);
+      void db_remove_i64(int32_t iterator);
+      int32_t db_get_i64(int32_t iterator, const void* data, uint32_t len);
+      int32_t db_next_i64(int32_t iterator, uint64_t* primary);
+      int32_t db_previous_i64(int32_t iterator, uint64_t* primary);
+      int32_t db_find_i64(uint64_t code, uint64_t scope, uint64_t table, uint64_t id);
+      int32_t db_lowerbound_i64(uint64_t code, uint64_t scope, uint64_t table, uint64_t id);
+      int32_t db_upperbound_i64(uint64_t code, uint64_t scope, uint64_t table, uint64_t id);
+      int32_t db_end_i64(uint64_t code, uint64_t scope, uint64_t table);
+
+      int32_t db_idx64_store(uint64_t scope, uint64_t table, uint64_t payer, uint64_t id, const uint64_t* secondary);
+      void db_idx64_update(int32_t iterator, uint64_t payer, const uint64_t* secondary);
+      void db_idx64_remove(int32_t iterator);
+      int32_t db_idx64_next(int32_t iterator, uint64_t* primary);
+      int32_t db_idx64_previous(int32_t iterator, uint64_t* primary);
+      int32_t db_idx64_find_primary(uint64_t code, uint64_t scope, uint64_t table, uint64_t* secondary, uint64_t primary);
+      int32_t db_idx64_find_secondary(uint64_t code, uint64_t scope, uint64_t table, const uint64_t* secondary, uint64_t* primary);
+      int32_t db_idx64_lowerbound(uint64_t code, uint64_t scope, uint64_t table, uint64_t* secondary, uint64_t* primary);
+      int32_t db_idx64_upperbound(uint64_t code, uint64_t scope, uint64_t table, uint64_t* secondary, uint64_t* primary);
+      int32_t db_idx64_end(uint64_t code, uint64_t scope, uint64_t table);
+
+      int32_t db_idx128_store(uint64_t scope, uint64_t table, uint64_t payer, uint64_t id, const uint128_t* secondary);
+      void db_idx128_update(int32_t iterator, uint64_t payer, const uint128_t* secondary);
+      void db_idx128_remove(int32_t iterator);
+      int32_t db_idx128_next(int32_t iterator, uint64_t* primary);
+      int32_t db_idx128_previous(int32_t iterator, uint64_t* primary);
+      int32_t db_idx128_find_primary(uint64_t code, uint64_t scope, uint64_t table, uint128_t* secondary, uint64_t primary);
+      int32_t db_idx128_find_secondary(uint64_t code, uint64_t scope, uint64_t table, const uint128_t* secondary, uint64_t* primary);
+      int32_t db_idx128_lowerbound(uint64_t code, uint64_t scope, uint64_t table, uint128_t* secondary, uint64_t* primary);
+      int32_t db_idx128_upperbound(uint64_t code, uint64_t scope, uint64_t table, uint128_t* secondary, uint64_t* primary);
+      int32_t db_idx128_end(uint64_t code, uint64_t scope, uint64_t table);
+      }
+   } // namespace internal_use_do_not_use
+} // namespace eosio
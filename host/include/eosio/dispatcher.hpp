@@ -0,0 +1,60 @@
+/**
+ *  @file
+ *  Native stand-in for the cdt action dispatcher.
+ */
+#pragma once
+
+#include <eosio/action.hpp>
+#include <eosio/contract.hpp>
+#include <eosio/datastream.hpp>
+
+#include <boost/preprocessor/seq/for_each.hpp>
+#include <boost/preprocessor/stringize.hpp>
+
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace eosio {
+
+   template <typename T, typename R, typename... Args>
+   bool execute_action(name self, name code, R (T::*func)(Args...)) {
+      std::size_t size = action_data_size();
+      std::vector<char> buffer(size);
+      read_action_data(buffer.data(), (uint32_t)size);
+      datastream<const char*> ds(buffer.data(), buffer.size());
+
+      std::tuple<std::decay_t<Args>...> args;
+      ds >> args;
+
+      T inst(self, code, ds);
+
+      auto f2 = [&](auto... a) { return ((&inst)->*func)(a...); };
+
+      if constexpr (std::is_void_v<R>) {
+         std::apply(f2, args);
+      } else {
+         auto result = std::apply(f2, args);
+         auto packed = pack(result);
+         internal_use_do_not_use::set_action_return_value(packed.data(), packed.size());
+      }
+      return true;
+   }
+
+} // namespace eosio
+
+#define EOSIO_DISPATCH_INTERNAL(r, OP, elem)                                                            \
+   case eosio::name(BOOST_PP_STRINGIZE(elem)).value:                                                    \
+      eosio::execute_action(eosio::name(receiver), eosio::name(code), &OP::elem);                       \
+      break;
+
+#define EOSIO_DISPATCH_HELPER(TYPE, MEMBERS) BOOST_PP_SEQ_FOR_EACH(EOSIO_DISPATCH_INTERNAL, TYPE, MEMBERS)
+
+#define EOSIO_DISPATCH(TYPE, MEMBERS)                                                                   \
+   extern "C" {                                                                                         \
+   void apply(uint64_t receiver, uint64_t code, uint64_t action) {                                      \
+      if (code == receiver) {                                                                           \
+         switch (action) { EOSIO_DISPATCH_HELPER(TYPE, MEMBERS) }                                       \
+      }                                                                                                 \
+   }                                                                                                    \
+   }
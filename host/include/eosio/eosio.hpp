@@ -0,0 +1,16 @@
+/**
+ *  @file
+ *  Umbrella header of the native cdt stand-in used by the host build.
+ */
+#pragma once
+
+#include <eosio/action.hpp>
+#include <eosio/asset.hpp>
+#include <eosio/check.hpp>
+#include <eosio/contract.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/dispatcher.hpp>
+#include <eosio/multi_index.hpp>
+#include <eosio/name.hpp>
+#include <eosio/symbol.hpp>
+#include <eosio/system.hpp>
@@ -0,0 +1,723 @@
+/**
+ *  @file
+ *  Native `eosio::multi_index` layered on the host `db_*` intrinsics.
+ *
+ *  Follows the cdt implementation closely: rows are loaded on demand into a
+ *  per-instance object cache, secondary indices live in their own index
+ *  tables (the low nibble of the table name carries the index number) and
+ *  every lookup goes through the same intrinsic calls a deployed contract
+ *  makes, so the host chain's counters see the real access pattern.
+ */
+#pragma once
+
+#include <eosio/check.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/db.hpp>
+#include <eosio/name.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace eosio {
+
+   constexpr static inline name same_payer{};
+
+   template <typename Class, typename Type, Type (Class::*PtrToMemberFunction)() const>
+   struct const_mem_fun {
+      typedef typename std::remove_reference<Type>::type result_type;
+
+      Type operator()(const Class& x) const { return (x.*PtrToMemberFunction)(); }
+   };
+
+   template <name::raw IndexName, typename Extractor>
+   struct indexed_by {
+      enum constants { index_name = static_cast<uint64_t>(IndexName) };
+      typedef Extractor secondary_extractor_type;
+   };
+
+   namespace _multi_index_detail {
+      namespace db = ::eosio::internal_use_do_not_use;
+
+      template <typename T>
+      struct secondary_index_db_functions;
+
+#define WRAP_SECONDARY_SIMPLE_TYPE(IDX, TYPE)                                                              \
+   template <>                                                                                              \
+   struct secondary_index_db_functions<TYPE> {                                                              \
+      static int32_t db_idx_next(int32_t iterator, uint64_t* primary) { return db::db_##IDX##_next(iterator, primary); } \
+      static int32_t db_idx_previous(int32_t iterator, uint64_t* primary) {                                 \
+         return db::db_##IDX##_previous(iterator, primary);                                                 \
+      }                                                                                                     \
+      static void db_idx_remove(int32_t iterator) { db::db_##IDX##_remove(iterator); }                      \
+      static int32_t db_idx_end(uint64_t code, uint64_t scope, uint64_t table) {                            \
+         return db::db_##IDX##_end(code, scope, table);                                                     \
+      }                                                                                                     \
+      static int32_t db_idx_store(uint64_t scope, uint64_t table, uint64_t payer, uint64_t id,              \
+                                  const TYPE& secondary) {                                                  \
+         return db::db_##IDX##_store(scope, table, payer, id, &secondary);                                  \
+      }                                                                                                     \
+      static void db_idx_update(int32_t iterator, uint64_t payer, const TYPE& secondary) {                  \
+         db::db_##IDX##_update(iterator, payer, &secondary);                                                \
+      }                                                                                                     \
+      static int32_t db_idx_find_primary(uint64_t code, uint64_t scope, uint64_t table, uint64_t primary,   \
+                                         TYPE& secondary) {                                                 \
+         return db::db_##IDX##_find_primary(code, scope, table, &secondary, primary);                       \
+      }                                                                                                     \
+      static int32_t db_idx_find_secondary(uint64_t code, uint64_t scope, uint64_t table,                   \
+                                           const TYPE& secondary, uint64_t& primary) {                      \
+         return db::db_##IDX##_find_secondary(code, scope, table, &secondary, &primary);                    \
+      }                                                                                                     \
+      static int32_t db_idx_lowerbound(uint64_t code, uint64_t scope, uint64_t table, TYPE& secondary,      \
+                                       uint64_t& primary) {                                                 \
+         return db::db_##IDX##_lowerbound(code, scope, table, &secondary, &primary);                        \
+      }                                                                                                     \
+      static int32_t db_idx_upperbound(uint64_t code, uint64_t scope, uint64_t table, TYPE& secondary,      \
+                                       uint64_t& primary) {                                                 \
+         return db::db_##IDX##_upperbound(code, scope, table, &secondary, &primary);                        \
+      }                                                                                                     \
+   };
+
+      WRAP_SECONDARY_SIMPLE_TYPE(idx64, uint64_t)
+      WRAP_SECONDARY_SIMPLE_TYPE(idx128, uint128_t)
+
+#undef WRAP_SECONDARY_SIMPLE_TYPE
+
+      template <uint64_t I, typename... Indices>
+      struct nth_index;
+
+      template <typename First, typename... Rest>
+      struct nth_index<0, First, Rest...> {
+         typedef First type;
+      };
+
+      template <uint64_t I, typename First, typename... Rest>
+      struct nth_index<I, First, Rest...> {
+         typedef typename nth_index<I - 1, Rest...>::type type;
+      };
+   } // namespace _multi_index_detail
+
+   template <name::raw TableName, typename T, typename... Indices>
+   class multi_index {
+   private:
+      static_assert(sizeof...(Indices) <= 16, "multi_index only supports a maximum of 16 secondary indices");
+
+      constexpr static bool validate_table_name(name::raw n) {
+         return (static_cast<uint64_t>(n) & 0x000000000000000FULL) == 0;
+      }
+      static_assert(validate_table_name(TableName),
+                    "multi_index does not support table names with a length greater than 12");
+
+      enum next_primary_key_tags : uint64_t {
+         no_available_primary_key = static_cast<uint64_t>(-2),
+         unset_next_primary_key = static_cast<uint64_t>(-1)
+      };
+
+      name _code;
+      uint64_t _scope;
+      mutable uint64_t _next_primary_key;
+
+      struct item : public T {
+         template <typename Constructor>
+         item(const multi_index* idx, Constructor&& c) : __idx(idx) {
+            c(*this);
+         }
+
+         const multi_index* __idx;
+         int32_t __primary_itr;
+         int32_t __iters[sizeof...(Indices) + (sizeof...(Indices) == 0)];
+      };
+
+      struct item_ptr {
+         item_ptr(std::unique_ptr<item>&& i, uint64_t pk, int32_t pitr)
+             : _item(std::move(i)), _primary_key(pk), _primary_itr(pitr) {}
+
+         std::unique_ptr<item> _item;
+         uint64_t _primary_key;
+         int32_t _primary_itr;
+      };
+
+      mutable std::vector<item_ptr> _items_vector;
+
+      static constexpr uint64_t index_table_name(uint64_t number) {
+         return (static_cast<uint64_t>(TableName) & 0xFFFFFFFFFFFFFFF0ULL) | (number & 0x000000000000000FULL);
+      }
+
+      template <uint64_t I>
+      using index_at = typename _multi_index_detail::nth_index<I, Indices...>::type;
+
+      template <uint64_t I>
+      using secondary_key_t = typename index_at<I>::secondary_extractor_type::result_type;
+
+      template <uint64_t I>
+      static secondary_key_t<I> extract_secondary(const T& obj) {
+         return typename index_at<I>::secondary_extractor_type()(obj);
+      }
+
+      template <typename F, std::size_t... Is>
+      static void for_each_index(F&& f, std::index_sequence<Is...>) {
+         (f(std::integral_constant<uint64_t, Is>{}), ...);
+      }
+
+      template <typename F>
+      static void for_each_index(F&& f) {
+         for_each_index(std::forward<F>(f), std::make_index_sequence<sizeof...(Indices)>{});
+      }
+
+      const item& load_object_by_primary_iterator(int32_t itr) const {
+         using namespace _multi_index_detail;
+
+         auto itr2 = std::find_if(_items_vector.rbegin(), _items_vector.rend(),
+                                  [&](const item_ptr& ptr) { return ptr._primary_itr == itr; });
+         if (itr2 != _items_vector.rend()) return *itr2->_item;
+
+         auto size = db::db_get_i64(itr, nullptr, 0);
+         check(size >= 0, "error reading iterator");
+
+         std::vector<char> buffer(size);
+         db::db_get_i64(itr, buffer.data(), size);
+         datastream<const char*> ds(buffer.data(), buffer.size());
+
+         auto itm = std::make_unique<item>(this, [&](auto& i) {
+            T& val = static_cast<T&>(i);
+            ds >> val;
+
+            i.__primary_itr = itr;
+            for (auto& it : i.__iters) it = -1;
+         });
+
+         const item* ptr = itm.get();
+         auto pk = itm->primary_key();
+         auto pitr = itm->__primary_itr;
+
+         _items_vector.emplace_back(std::move(itm), pk, pitr);
+
+         return *ptr;
+      }
+
+   public:
+      template <uint64_t IndexName, typename Extractor, uint64_t Number>
+      struct index {
+      public:
+         typedef Extractor secondary_extractor_type;
+         typedef typename std::decay<decltype(Extractor()(std::declval<const T&>()))>::type secondary_key_type;
+         typedef _multi_index_detail::secondary_index_db_functions<secondary_key_type> db_functions;
+
+         constexpr static uint64_t name() { return index_table_name(Number); }
+         constexpr static uint64_t number() { return Number; }
+
+         struct const_iterator {
+         public:
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = const T;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const T*;
+            using reference = const T&;
+
+            friend bool operator==(const const_iterator& a, const const_iterator& b) { return a._item == b._item; }
+            friend bool operator!=(const const_iterator& a, const const_iterator& b) { return a._item != b._item; }
+
+            const T& operator*() const { return *static_cast<const T*>(_item); }
+            const T* operator->() const { return static_cast<const T*>(_item); }
+
+            const_iterator operator++(int) {
+               const_iterator result(*this);
+               ++(*this);
+               return result;
+            }
+
+            const_iterator& operator++() {
+               check(_item != nullptr, "cannot increment end iterator");
+
+               if (_item->__iters[Number] == -1) {
+                  secondary_key_type temp_secondary_key;
+                  auto idxitr = db_functions::db_idx_find_primary(_idx->get_code().value, _idx->get_scope(), _idx->name(),
+                                                                  _item->primary_key(), temp_secondary_key);
+                  auto& mi = const_cast<item&>(*_item);
+                  mi.__iters[Number] = idxitr;
+               }
+
+               uint64_t next_pk = 0;
+               auto next_itr = db_functions::db_idx_next(_item->__iters[Number], &next_pk);
+               if (next_itr < 0) {
+                  _item = nullptr;
+                  return *this;
+               }
+
+               const T& obj = *_idx->_multidx->find(next_pk);
+               auto& mi = const_cast<item&>(static_cast<const item&>(obj));
+               mi.__iters[Number] = next_itr;
+               _item = &mi;
+
+               return *this;
+            }
+
+            const_iterator& operator--() {
+               uint64_t prev_pk = 0;
+               int32_t prev_itr = -1;
+
+               if (!_item) {
+                  auto ei = db_functions::db_idx_end(_idx->get_code().value, _idx->get_scope(), _idx->name());
+                  check(ei != -1, "cannot decrement end iterator when the index is empty");
+                  prev_itr = db_functions::db_idx_previous(ei, &prev_pk);
+                  check(prev_itr >= 0, "cannot decrement end iterator when the index is empty");
+               } else {
+                  if (_item->__iters[Number] == -1) {
+                     secondary_key_type temp_secondary_key;
+                     auto idxitr = db_functions::db_idx_find_primary(_idx->get_code().value, _idx->get_scope(),
+                                                                     _idx->name(), _item->primary_key(),
+                                                                     temp_secondary_key);
+                     auto& mi = const_cast<item&>(*_item);
+                     mi.__iters[Number] = idxitr;
+                  }
+                  prev_itr = db_functions::db_idx_previous(_item->__iters[Number], &prev_pk);
+                  check(prev_itr >= 0, "cannot decrement iterator at beginning of index");
+               }
+
+               const T& obj = *_idx->_multidx->find(prev_pk);
+               auto& mi = const_cast<item&>(static_cast<const item&>(obj));
+               mi.__iters[Number] = prev_itr;
+               _item = &mi;
+
+               return *this;
+            }
+
+            const_iterator() : _item(nullptr) {}
+
+         private:
+            friend struct index;
+            const_iterator(const index* idx, const item* i = nullptr) : _idx(idx), _item(i) {}
+
+            const index* _idx = nullptr;
+            const item* _item;
+         };
+
+         const_iterator cbegin() const { return lower_bound(std::numeric_limits<secondary_key_type>::lowest()); }
+         const_iterator begin() const { return cbegin(); }
+         const_iterator cend() const { return const_iterator(this); }
+         const_iterator end() const { return cend(); }
+
+         const_iterator find(secondary_key_type&& secondary) const {
+            auto lb = lower_bound(secondary);
+            auto e = cend();
+            if (lb == e) return e;
+            if (secondary != secondary_extractor_type()(*lb)) return e;
+            return lb;
+         }
+
+         const_iterator find(const secondary_key_type& secondary) const {
+            auto lb = lower_bound(secondary);
+            auto e = cend();
+            if (lb == e) return e;
+            if (secondary != secondary_extractor_type()(*lb)) return e;
+            return lb;
+         }
+
+         const_iterator require_find(secondary_key_type&& secondary,
+                                     const char* error_msg = "unable to find secondary key") const {
+            auto lb = lower_bound(secondary);
+            check(lb != cend(), error_msg);
+            check(secondary == secondary_extractor_type()(*lb), error_msg);
+            return lb;
+         }
+
+         const T& get(secondary_key_type&& secondary, const char* error_msg = "unable to find secondary key") const {
+            auto result = find(std::move(secondary));
+            check(result != cend(), error_msg);
+            return *result;
+         }
+
+         const_iterator lower_bound(secondary_key_type&& secondary) const {
+            return lower_bound(static_cast<const secondary_key_type&>(secondary));
+         }
+
+         const_iterator lower_bound(const secondary_key_type& secondary) const {
+            uint64_t primary = 0;
+            secondary_key_type secondary_copy(secondary);
+            auto itr = db_functions::db_idx_lowerbound(get_code().value, get_scope(), name(), secondary_copy, primary);
+            if (itr < 0) return cend();
+
+            const T& obj = *_multidx->find(primary);
+            auto& mi = const_cast<item&>(static_cast<const item&>(obj));
+            mi.__iters[Number] = itr;
+
+            return {this, &mi};
+         }
+
+         const_iterator upper_bound(secondary_key_type&& secondary) const {
+            return upper_bound(static_cast<const secondary_key_type&>(secondary));
+         }
+
+         const_iterator upper_bound(const secondary_key_type& secondary) const {
+            uint64_t primary = 0;
+            secondary_key_type secondary_copy(secondary);
+            auto itr = db_functions::db_idx_upperbound(get_code().value, get_scope(), name(), secondary_copy, primary);
+            if (itr < 0) return cend();
+
+            const T& obj = *_multidx->find(primary);
+            auto& mi = const_cast<item&>(static_cast<const item&>(obj));
+            mi.__iters[Number] = itr;
+
+            return {this, &mi};
+         }
+
+         const_iterator iterator_to(const T& obj) {
+            const auto& objitem = static_cast<const item&>(obj);
+            check(objitem.__idx == _multidx, "object passed to iterator_to is not in multi_index");
+
+            if (objitem.__iters[Number] == -1) {
+               secondary_key_type temp_secondary_key;
+               auto idxitr = db_functions::db_idx_find_primary(get_code().value, get_scope(), name(),
+                                                               objitem.primary_key(), temp_secondary_key);
+               auto& mi = const_cast<item&>(objitem);
+               mi.__iters[Number] = idxitr;
+            }
+
+            return {this, &objitem};
+         }
+
+         template <typename Lambda>
+         void modify(const_iterator itr, eosio::name payer, Lambda&& updater) {
+            check(itr != cend(), "cannot pass end iterator to modify");
+            _multidx->modify(*itr, payer, std::forward<Lambda&&>(updater));
+         }
+
+         template <typename Lambda>
+         void modify(const T& obj, eosio::name payer, Lambda&& updater) {
+            _multidx->modify(obj, payer, std::forward<Lambda&&>(updater));
+         }
+
+         const_iterator erase(const_iterator itr) {
+            check(itr != cend(), "cannot pass end iterator to erase");
+            const auto& obj = *itr;
+            ++itr;
+            _multidx->erase(obj);
+            return itr;
+         }
+
+         eosio::name get_code() const { return _multidx->get_code(); }
+         uint64_t get_scope() const { return _multidx->get_scope(); }
+
+         static auto extract_secondary_key(const T& obj) { return secondary_extractor_type()(obj); }
+
+      private:
+         friend class multi_index;
+
+         index(const multi_index* midx) : _multidx(midx) {}
+
+         const multi_index* _multidx;
+      };
+
+      struct const_iterator {
+      public:
+         using iterator_category = std::bidirectional_iterator_tag;
+         using value_type = const T;
+         using difference_type = std::ptrdiff_t;
+         using pointer = const T*;
+         using reference = const T&;
+
+         friend bool operator==(const const_iterator& a, const const_iterator& b) { return a._item == b._item; }
+         friend bool operator!=(const const_iterator& a, const const_iterator& b) { return a._item != b._item; }
+
+         const T& operator*() const { return *static_cast<const T*>(_item); }
+         const T* operator->() const { return static_cast<const T*>(_item); }
+
+         const_iterator operator++(int) {
+            const_iterator result(*this);
+            ++(*this);
+            return result;
+         }
+
+         const_iterator operator--(int) {
+            const_iterator result(*this);
+            --(*this);
+            return result;
+         }
+
+         const_iterator& operator++() {
+            check(_item != nullptr, "cannot increment end iterator");
+
+            uint64_t next_pk;
+            auto next_itr = internal_use_do_not_use::db_next_i64(_item->__primary_itr, &next_pk);
+            if (next_itr < 0)
+               _item = nullptr;
+            else
+               _item = &_multidx->load_object_by_primary_iterator(next_itr);
+            return *this;
+         }
+
+         const_iterator& operator--() {
+            uint64_t prev_pk;
+            int32_t prev_itr = -1;
+
+            if (!_item) {
+               auto ei = internal_use_do_not_use::db_end_i64(_multidx->get_code().value, _multidx->get_scope(),
+                                                             static_cast<uint64_t>(TableName));
+               check(ei != -1, "cannot decrement end iterator when the table is empty");
+               prev_itr = internal_use_do_not_use::db_previous_i64(ei, &prev_pk);
+               check(prev_itr >= 0, "cannot decrement end iterator when the table is empty");
+            } else {
+               prev_itr = internal_use_do_not_use::db_previous_i64(_item->__primary_itr, &prev_pk);
+               check(prev_itr >= 0, "cannot decrement iterator at beginning of table");
+            }
+
+            _item = &_multidx->load_object_by_primary_iterator(prev_itr);
+            return *this;
+         }
+
+         const_iterator() : _multidx(nullptr), _item(nullptr) {}
+
+      private:
+         const_iterator(const multi_index* mi, const item* i = nullptr) : _multidx(mi), _item(i) {}
+
+         const multi_index* _multidx;
+         const item* _item;
+         friend class multi_index;
+      };
+
+      typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+      multi_index(name code, uint64_t scope) : _code(code), _scope(scope), _next_primary_key(unset_next_primary_key) {}
+
+      multi_index(const multi_index&) = delete;
+      multi_index& operator=(const multi_index&) = delete;
+
+      name get_code() const { return _code; }
+      uint64_t get_scope() const { return _scope; }
+
+      const_iterator cbegin() const { return lower_bound(std::numeric_limits<uint64_t>::lowest()); }
+      const_iterator begin() const { return cbegin(); }
+      const_iterator cend() const { return const_iterator(this); }
+      const_iterator end() const { return cend(); }
+      const_reverse_iterator crbegin() const { return std::make_reverse_iterator(cend()); }
+      const_reverse_iterator rbegin() const { return crbegin(); }
+      const_reverse_iterator crend() const { return std::make_reverse_iterator(cbegin()); }
+      const_reverse_iterator rend() const { return crend(); }
+
+      const_iterator lower_bound(uint64_t primary) const {
+         auto itr = internal_use_do_not_use::db_lowerbound_i64(_code.value, _scope, static_cast<uint64_t>(TableName),
+                                                               primary);
+         if (itr < 0) return end();
+         const auto& obj = load_object_by_primary_iterator(itr);
+         return {this, &obj};
+      }
+
+      const_iterator upper_bound(uint64_t primary) const {
+         auto itr = internal_use_do_not_use::db_upperbound_i64(_code.value, _scope, static_cast<uint64_t>(TableName),
+                                                               primary);
+         if (itr < 0) return end();
+         const auto& obj = load_object_by_primary_iterator(itr);
+         return {this, &obj};
+      }
+
+      uint64_t available_primary_key() const {
+         if (_next_primary_key == unset_next_primary_key) {
+            if (begin() == end()) {
+               _next_primary_key = 0;
+            } else {
+               auto itr = --end();
+               auto pk = itr->primary_key();
+               if (pk >= no_available_primary_key)
+                  _next_primary_key = no_available_primary_key;
+               else
+                  _next_primary_key = pk + 1;
+            }
+         }
+
+         check(_next_primary_key < no_available_primary_key, "next primary key in table is at autoincrement limit");
+         return _next_primary_key;
+      }
+
+      template <name::raw IndexName>
+      auto get_index() const {
+         return get_index_impl<static_cast<uint64_t>(IndexName)>(std::make_index_sequence<sizeof...(Indices)>{});
+      }
+
+      const_iterator iterator_to(const T& obj) const {
+         const auto& objitem = static_cast<const item&>(obj);
+         check(objitem.__idx == this, "object passed to iterator_to is not in multi_index");
+         return {this, &objitem};
+      }
+
+      template <typename Lambda>
+      const_iterator emplace(name payer, Lambda&& constructor) {
+         using namespace _multi_index_detail;
+
+         check(_code.value == internal_use_do_not_use_current_receiver(),
+               "cannot create objects in table of another contract");
+
+         auto i = std::make_unique<item>(this, [&](auto& i) {
+            T& obj = static_cast<T&>(i);
+            constructor(obj);
+
+            auto bytes = pack(obj);
+            auto pk = obj.primary_key();
+
+            i.__primary_itr = db::db_store_i64(_scope, static_cast<uint64_t>(TableName), payer.value, pk, bytes.data(),
+                                               (uint32_t)bytes.size());
+
+            if (pk >= _next_primary_key) _next_primary_key = (pk >= no_available_primary_key) ? no_available_primary_key : (pk + 1);
+
+            for_each_index([&](auto idx) {
+               constexpr uint64_t I = decltype(idx)::value;
+               typedef index<index_at<I>::index_name, typename index_at<I>::secondary_extractor_type, I> index_type;
+               i.__iters[I] = index_type::db_functions::db_idx_store(_scope, index_type::name(), payer.value,
+                                                                     obj.primary_key(), extract_secondary<I>(obj));
+            });
+            if constexpr (sizeof...(Indices) == 0) i.__iters[0] = -1;
+         });
+
+         const item* ptr = i.get();
+         auto pk = i->primary_key();
+         auto pitr = i->__primary_itr;
+         _items_vector.emplace_back(std::move(i), pk, pitr);
+
+         return {this, ptr};
+      }
+
+      template <typename Lambda>
+      void modify(const_iterator itr, name payer, Lambda&& updater) {
+         check(itr != end(), "cannot pass end iterator to modify");
+         modify(*itr, payer, std::forward<Lambda&&>(updater));
+      }
+
+      template <typename Lambda>
+      void modify(const T& obj, name payer, Lambda&& updater) {
+         using namespace _multi_index_detail;
+
+         const auto& objitem = static_cast<const item&>(obj);
+         check(objitem.__idx == this, "object passed to modify is not in multi_index");
+         auto& mutableitem = const_cast<item&>(objitem);
+         check(_code.value == internal_use_do_not_use_current_receiver(),
+               "cannot modify objects in table of another contract");
+
+         auto pk = obj.primary_key();
+
+         std::tuple<typename Indices::secondary_extractor_type::result_type...> secondary_keys;
+         for_each_index([&](auto idx) {
+            constexpr uint64_t I = decltype(idx)::value;
+            std::get<I>(secondary_keys) = extract_secondary<I>(obj);
+         });
+
+         auto& mutableobj = const_cast<T&>(obj);
+         updater(mutableobj);
+
+         check(pk == obj.primary_key(), "updater cannot change primary key when modifying an object");
+
+         auto bytes = pack(obj);
+         db::db_update_i64(objitem.__primary_itr, payer.value, bytes.data(), (uint32_t)bytes.size());
+
+         if (pk >= _next_primary_key) _next_primary_key = (pk >= no_available_primary_key) ? no_available_primary_key : (pk + 1);
+
+         for_each_index([&](auto idx) {
+            constexpr uint64_t I = decltype(idx)::value;
+            typedef index<index_at<I>::index_name, typename index_at<I>::secondary_extractor_type, I> index_type;
+            auto secondary = extract_secondary<I>(obj);
+            if (std::memcmp(&std::get<I>(secondary_keys), &secondary, sizeof(secondary)) != 0 || payer != same_payer) {
+               auto indexitr = mutableitem.__iters[I];
+               if (indexitr < 0) {
+                  typename index_type::secondary_key_type temp_secondary_key;
+                  indexitr = mutableitem.__iters[I] = index_type::db_functions::db_idx_find_primary(
+                      _code.value, _scope, index_type::name(), pk, temp_secondary_key);
+               }
+               index_type::db_functions::db_idx_update(indexitr, payer.value, secondary);
+            }
+         });
+      }
+
+      const T& get(uint64_t primary, const char* error_msg = "unable to find key") const {
+         auto result = find(primary);
+         check(result != cend(), error_msg);
+         return *result;
+      }
+
+      const_iterator find(uint64_t primary) const {
+         auto itr2 = std::find_if(_items_vector.rbegin(), _items_vector.rend(),
+                                  [&](const item_ptr& ptr) { return ptr._item->primary_key() == primary; });
+         if (itr2 != _items_vector.rend()) return iterator_to(*(itr2->_item));
+
+         auto itr = internal_use_do_not_use::db_find_i64(_code.value, _scope, static_cast<uint64_t>(TableName), primary);
+         if (itr < 0) return end();
+
+         const item& i = load_object_by_primary_iterator(itr);
+         return iterator_to(static_cast<const T&>(i));
+      }
+
+      const_iterator require_find(uint64_t primary, const char* error_msg = "unable to find key") const {
+         auto itr = find(primary);
+         check(itr != cend(), error_msg);
+         return itr;
+      }
+
+      const_iterator erase(const_iterator itr) {
+         check(itr != end(), "cannot pass end iterator to erase");
+         const auto& obj = *itr;
+         ++itr;
+         erase(obj);
+         return itr;
+      }
+
+      void erase(const T& obj) {
+         using namespace _multi_index_detail;
+
+         const auto& objitem = static_cast<const item&>(obj);
+         check(objitem.__idx == this, "object passed to erase is not in multi_index");
+         check(_code.value == internal_use_do_not_use_current_receiver(),
+               "cannot erase objects in table of another contract");
+
+         auto pk = objitem.primary_key();
+         auto itr2 = std::find_if(_items_vector.rbegin(), _items_vector.rend(),
+                                  [&](const item_ptr& ptr) { return ptr._item->primary_key() == pk; });
+         check(itr2 != _items_vector.rend(), "attempt to remove object that was not in multi_index");
+
+         db::db_remove_i64(objitem.__primary_itr);
+
+         for_each_index([&](auto idx) {
+            constexpr uint64_t I = decltype(idx)::value;
+            typedef index<index_at<I>::index_name, typename index_at<I>::secondary_extractor_type, I> index_type;
+            auto i = objitem.__iters[I];
+            if (i < 0) {
+               typename index_type::secondary_key_type secondary;
+               i = index_type::db_functions::db_idx_find_primary(_code.value, _scope, index_type::name(), objitem.primary_key(),
+                                                                 secondary);
+            }
+            if (i >= 0) index_type::db_functions::db_idx_remove(i);
+         });
+
+         _items_vector.erase(--(itr2.base()));
+      }
+
+   private:
+      static uint64_t internal_use_do_not_use_current_receiver();
+
+      template <uint64_t IndexName, std::size_t... Is>
+      static constexpr uint64_t find_index_number(std::index_sequence<Is...>) {
+         uint64_t r = 0;
+         ((r = (r == 0 && uint64_t(index_at<Is>::index_name) == IndexName) ? Is + 1 : r), ...);
+         return r;
+      }
+
+      template <uint64_t IndexName, std::size_t... Is>
+      auto get_index_impl(std::index_sequence<Is...> seq) const {
+         constexpr uint64_t found = find_index_number<IndexName>(seq);
+         static_assert(found != 0, "name provided is not the name of any secondary index within multi_index");
+         constexpr uint64_t I = found - 1;
+         return index<IndexName, typename index_at<I>::secondary_extractor_type, I>(this);
+      }
+   };
+
+   namespace internal_use_do_not_use {
+      extern "C" uint64_t current_receiver();
+   }
+
+   template <name::raw TableName, typename T, typename... Indices>
+   uint64_t multi_index<TableName, T, Indices...>::internal_use_do_not_use_current_receiver() {
+      return internal_use_do_not_use::current_receiver();
+   }
+
+} // namespace eosio
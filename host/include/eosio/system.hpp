@@ -0,0 +1,53 @@
+/**
+ *  @file
+ *  Native stand-in for the cdt time helpers, driven by the host chain clock.
+ */
+#pragma once
+
+#include <eosio/check.hpp>
+
+#include <cstdint>
+
+namespace eosio {
+
+   namespace internal_use_do_not_use {
+      extern "C" {
+      uint64_t current_time();
+      }
+   } // namespace internal_use_do_not_use
+
+   class microseconds {
+   public:
+      explicit microseconds(int64_t c = 0) : _count(c) {}
+      int64_t count() const { return _count; }
+      int64_t to_seconds() const { return _count / 1000000; }
+
+      int64_t _count;
+   };
+
+   inline microseconds seconds(int64_t s) { return microseconds(s * 1000000); }
+
+   class time_point {
+   public:
+      explicit time_point(microseconds e = microseconds()) : elapsed(e) {}
+      const microseconds& time_since_epoch() const { return elapsed; }
+      uint32_t sec_since_epoch() const { return uint32_t(elapsed.count() / 1000000); }
+
+      microseconds elapsed;
+   };
+
+   class time_point_sec {
+   public:
+      time_point_sec() : utc_seconds(0) {}
+      explicit time_point_sec(uint32_t seconds) : utc_seconds(seconds) {}
+      time_point_sec(const time_point& t) : utc_seconds(uint32_t(t.time_since_epoch().count() / 1000000ll)) {}
+      uint32_t sec_since_epoch() const { return utc_seconds; }
+
+      uint32_t utc_seconds;
+   };
+
+   inline time_point current_time_point() {
+      return time_point(microseconds(static_cast<int64_t>(internal_use_do_not_use::current_time())));
+   }
+
+} // namespace eosio
@@ -0,0 +1,92 @@
+/**
+ *  @file
+ *  Stand-in for the BOX lp contract poolv2 claims from: it keeps the BOX an
+ *  account collected in its `rewards` table and pays it out on `claim`.
+ *  Tests credit BOX with the `accrue` action the real contract doesn't have.
+ */
+#pragma once
+
+#include <host/coral.hpp>
+
+#include <eosio/eosio.hpp>
+
+#include <string>
+#include <tuple>
+
+namespace host::box_lp {
+
+   using eosio::asset;
+   using eosio::symbol;
+
+   inline const name lp("lptoken.defi");
+   inline const name box_token("token.defi");
+   inline const name fees("coralpoolfee");
+
+   inline const symbol box_symbol("BOX", 6);
+
+   /// A row of the `rewards` table, as poolv2 reads it.
+   struct reward_row {
+      name owner;
+      uint64_t cumulative;
+      uint64_t unclaimed;
+      uint64_t primary_key() const { return owner.value; }
+   };
+
+   typedef eosio::multi_index<eosio::name("rewards"), reward_row> rewards_mi;
+
+   inline void apply(uint64_t receiver, uint64_t code, uint64_t action) {
+      if (code != receiver) {
+         return;
+      }
+      const name self(receiver);
+      const eosio::permission_level active{self, name("active")};
+      rewards_mi rewards_tbl(self, self.value);
+      if (action == name("accrue").value) {
+         auto [owner, amount] = eosio::unpack_action_data<std::tuple<name, uint64_t>>();
+         eosio::action(active, box_token, name("issue"), std::make_tuple(self, asset(amount, box_symbol), std::string("accrue")))
+            .send();
+         auto itr = rewards_tbl.find(owner.value);
+         if (itr == rewards_tbl.end()) {
+            rewards_tbl.emplace(self, [&](auto& r) {
+               r.owner = owner;
+               r.cumulative = amount;
+               r.unclaimed = amount;
+            });
+         } else {
+            rewards_tbl.modify(itr, self, [&](auto& r) {
+               r.cumulative += amount;
+               r.unclaimed += amount;
+            });
+         }
+      } else if (action == name("claim").value) {
+         auto owner = eosio::unpack_action_data<name>();
+         auto itr = rewards_tbl.find(owner.value);
+         if (itr == rewards_tbl.end() || itr->unclaimed == 0) {
+            return;
+         }
+         eosio::action(active, box_token, name("transfer"),
+                       std::make_tuple(self, owner, asset(itr->unclaimed, box_symbol), std::string("claim")))
+            .send();
+         rewards_tbl.modify(itr, self, [&](auto& r) { r.unclaimed = 0; });
+      }
+      // `update` refreshes the lp contract's own books, nothing to do here
+   }
+
+   /// Deploys the lp contract, the BOX token it pays out and the fees account.
+   inline void deploy(chain& c) {
+      c.set_code(lp, apply);
+      c.set_code(box_token, token_apply);
+      c.create_account(fees);
+      c.push(box_token, name("create"), box_token, lp, asset(4000000000000000000, box_symbol));
+   }
+
+   /// Credits `amount` BOX to `owner` for its next claim.
+   inline void accrue(chain& c, name owner, uint64_t amount) { c.push(lp, name("accrue"), lp, owner, amount); }
+
+   /// What `owner` has left to claim.
+   inline uint64_t unclaimed(const chain& c, name owner) {
+      auto row = c.get_row<reward_row>(lp, lp.value, name("rewards"), owner.value);
+      return row ? row->unclaimed : 0;
+   }
+
+} // namespace host::box_lp
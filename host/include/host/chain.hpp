@@ -0,0 +1,137 @@
+/**
+ *  @file
+ *  In-memory chain stand-in that backs the native build of the contracts.
+ *
+ *  A `host::chain` owns the database, the account list, the clock and the
+ *  apply handlers of every deployed contract. Pushing an action runs it with
+ *  nodeos ordering (the action, then its notifications, then the inline
+ *  actions they scheduled) and rolls all of it back if anything fails.
+ *  Every apply is metered with the database and inline-action counters the
+ *  budget tests and benchmarks report.
+ */
+#pragma once
+
+#include <eosio/action.hpp>
+#include <eosio/datastream.hpp>
+#include <eosio/name.hpp>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace host {
+
+   using eosio::name;
+
+   typedef void (*apply_handler)(uint64_t receiver, uint64_t code, uint64_t action);
+
+   struct counters {
+      uint64_t db_reads = 0;
+      uint64_t db_writes = 0;
+      uint64_t bytes_read = 0;
+      uint64_t bytes_written = 0;
+      uint64_t inline_actions = 0;
+      uint64_t notifications = 0;
+
+      counters& operator+=(const counters& o) {
+         db_reads += o.db_reads;
+         db_writes += o.db_writes;
+         bytes_read += o.bytes_read;
+         bytes_written += o.bytes_written;
+         inline_actions += o.inline_actions;
+         notifications += o.notifications;
+         return *this;
+      }
+   };
+
+   struct action_trace {
+      name receiver;
+      name account;
+      name action;
+      counters cost;
+      std::vector<char> return_value;
+      std::vector<char> data;
+   };
+
+   struct transaction_trace {
+      std::vector<action_trace> actions;
+      counters total;
+
+      /// Sum of the applies `receiver` ran for `action` in this transaction.
+      counters cost_of(name receiver, name action) const;
+   };
+
+   struct table_key {
+      uint64_t code;
+      uint64_t scope;
+      uint64_t table;
+
+      friend bool operator<(const table_key& a, const table_key& b) {
+         if (a.code != b.code) return a.code < b.code;
+         if (a.scope != b.scope) return a.scope < b.scope;
+         return a.table < b.table;
+      }
+   };
+
+   class chain {
+   public:
+      chain();
+      ~chain();
+
+      chain(const chain&) = delete;
+      chain& operator=(const chain&) = delete;
+
+      /// The chain the intrinsics of the calling thread talk to.
+      static chain& current();
+
+      void create_account(name account);
+      void set_code(name account, apply_handler handler);
+
+      void set_time(uint32_t sec_since_epoch);
+      void produce_blocks(uint32_t seconds);
+      uint32_t time() const;
+
+      /// Runs one action as its own transaction. Throws (after rolling back)
+      /// if the action or anything it triggered failed.
+      transaction_trace push_action(name account, name action, std::vector<eosio::permission_level> auth,
+                                    std::vector<char> data);
+
+      template <typename... Args>
+      transaction_trace push(name account, name action, name actor, const Args&... args) {
+         return push_action(account, action, {{actor, name("active")}}, eosio::pack(std::make_tuple(args...)));
+      }
+
+      /// Raw row access for assertions and reports; `nullopt` if missing.
+      std::optional<std::vector<char>> get_row_bytes(name code, uint64_t scope, name table, uint64_t primary) const;
+
+      template <typename T>
+      std::optional<T> get_row(name code, uint64_t scope, name table, uint64_t primary) const {
+         auto bytes = get_row_bytes(code, scope, table, primary);
+         if (!bytes) return std::nullopt;
+         return eosio::unpack<T>(*bytes);
+      }
+
+      /// Primary keys of a table in ascending order.
+      std::vector<uint64_t> primary_keys(name code, uint64_t scope, name table) const;
+
+      std::size_t row_count(name code, uint64_t scope, name table) const;
+      std::size_t table_count() const;
+
+      /// RAM billed to `payer`, with the same per-row overheads nodeos adds.
+      int64_t ram_usage(name payer) const;
+      int64_t total_ram_usage() const;
+
+      /// Counters accumulated over every action pushed so far.
+      const counters& totals() const;
+
+      struct impl;
+      impl& internals() { return *my; }
+
+   private:
+      std::unique_ptr<impl> my;
+   };
+
+} // namespace host
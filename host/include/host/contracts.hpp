@@ -0,0 +1,16 @@
+/**
+ *  @file
+ *  Entry points of the natively built contracts, ready for `chain::set_code`.
+ */
+#pragma once
+
+#include <cstdint>
+
+extern "C" {
+   void pool_v1_apply(uint64_t receiver, uint64_t code, uint64_t action);
+   void pool_v2_apply(uint64_t receiver, uint64_t code, uint64_t action);
+   void token_apply(uint64_t receiver, uint64_t code, uint64_t action);
+   // the pool contracts as deployed, see host/contracts/baseline
+   void pool_v1_baseline_apply(uint64_t receiver, uint64_t code, uint64_t action);
+   void pool_v2_baseline_apply(uint64_t receiver, uint64_t code, uint64_t action);
+}
@@ -0,0 +1,102 @@
+/**
+ *  @file
+ *  Deployment helpers shared by the native tests and tools: the pool
+ *  contracts, the CRL token they issue and a token miners stake with,
+ *  wired up with the account names the contracts expect.
+ */
+#pragma once
+
+#include <host/chain.hpp>
+#include <host/contracts.hpp>
+
+#include <eosio/asset.hpp>
+
+#include <string>
+
+namespace host::coral {
+
+   using eosio::asset;
+   using eosio::symbol;
+
+   inline const name manager("coralmanager");
+   inline const name crl_token("coralfitoken");
+   inline const name pools("crlpool");
+   inline const name stake_token("staketoken");
+
+   inline const symbol crl_symbol("CRL", 10);
+   inline const symbol stake_symbol("LP", 4);
+
+   enum class version { v1, v2 };
+
+   /// One recipient of `token::transfers`.
+   struct transfer_entry {
+      name to;
+      asset quantity;
+      std::string memo;
+   };
+
+   inline apply_handler pool_code(version v) { return v == version::v1 ? pool_v1_apply : pool_v2_apply; }
+
+   /// The contract of version `v` as deployed, for tests that upgrade its state.
+   inline apply_handler baseline_code(version v) {
+      return v == version::v1 ? pool_v1_baseline_apply : pool_v2_baseline_apply;
+   }
+
+   /// `miner_name(i)` is a distinct valid account name for every i.
+   inline name miner_name(uint64_t i) {
+      static const char digits[] = "abcdefghijklmnopqrstuvwxyz12345";
+      std::string s = "m";
+      do {
+         s += digits[i % 31];
+         i /= 31;
+      } while (i > 0);
+      return name(s);
+   }
+
+   /// Deploys the pools contract of version `v`, the CRL token issued by it
+   /// and the stake token, and starts the clock at `now`.
+   inline void deploy(chain& c, version v, uint32_t now = 1600000000) {
+      c.set_time(now);
+      c.create_account(manager);
+      c.set_code(pools, pool_code(v));
+      c.set_code(crl_token, token_apply);
+      c.set_code(stake_token, token_apply);
+
+      c.push(crl_token, name("create"), crl_token, pools, asset(3000000000000000000, crl_symbol));
+      c.push(stake_token, name("create"), stake_token, stake_token, asset(4000000000000000000, stake_symbol));
+   }
+
+   /// Creates a stake token symbol besides the default one, for more pools.
+   inline void create_stake_symbol(chain& c, symbol sym) {
+      c.push(stake_token, name("create"), stake_token, stake_token, asset(4000000000000000000, sym));
+   }
+
+   /// Creates a pool on `sym` of the stake token, box mining disabled on v2.
+   inline transaction_trace create_pool(chain& c, version v, asset reward, uint32_t epoch_time, uint32_t duration,
+                                        symbol sym = stake_symbol) {
+      if (v == version::v1) {
+         return c.push(pools, name("create"), manager, stake_token, sym, reward, epoch_time, duration, asset(1, sym));
+      }
+      return c.push(pools, name("create"), manager, stake_token, sym, reward, epoch_time, duration, asset(1, sym),
+                    uint8_t(0), eosio::symbol_code("BOX"));
+   }
+
+   /// Creates `miner` and gives it `quantity` of the stake token.
+   inline void fund(chain& c, name miner, asset quantity) {
+      c.create_account(miner);
+      c.push(stake_token, name("issue"), stake_token, stake_token, quantity, std::string("fund"));
+      c.push(stake_token, name("transfer"), stake_token, stake_token, miner, quantity, std::string("fund"));
+   }
+
+   /// Stakes by transferring to the pools contract, the memo picks the pool.
+   inline transaction_trace stake(chain& c, name miner, asset quantity, const std::string& memo = "") {
+      return c.push(stake_token, name("transfer"), miner, miner, pools, quantity, memo);
+   }
+
+   /// Token balance of `owner`, zero if it has no row.
+   inline int64_t balance(const chain& c, name token, name owner, symbol sym) {
+      auto row = c.get_row<asset>(token, owner.value, name("accounts"), sym.code().raw());
+      return row ? row->amount : 0;
+   }
+
+} // namespace host::coral
@@ -0,0 +1,243 @@
+/**
+ *  @file
+ *  Row layouts of the pools contracts as the native tests read them back
+ *  with `chain::get_row`, and small helpers the tests share. A mirror may
+ *  stop short of the full row, get_row only decodes the prefix it names.
+ */
+#pragma once
+
+#include <host/chain.hpp>
+
+#include <eosio/asset.hpp>
+#include <eosio/check.hpp>
+
+#include <string>
+#include <vector>
+
+namespace host {
+
+   using eosio::asset;
+   using eosio::symbol;
+   using eosio::symbol_code;
+
+   /// What every layout of a pool row starts with.
+   struct pool_head_row {
+      uint64_t id;
+      name contract;
+      symbol sym;
+      asset total_staked;
+   };
+
+   /// A pool of the v1 contract.
+   struct pool_v1_row {
+      uint64_t id;
+      name contract;
+      symbol sym;
+      asset total_staked;
+      asset total_reward;
+      asset released_reward;
+      uint32_t epoch_time;
+      uint32_t duration;
+      asset min_staked;
+      uint32_t last_harvest_time;
+   };
+
+   /// A miner of the v1 contract, also the legacy miner of poolv2 up to `unclaimed`.
+   struct miner_v1_row {
+      name owner;
+      asset staked;
+      asset claimed;
+      asset unclaimed;
+   };
+
+   /// A pool of the deployed poolv2.
+   struct pool_v2_baseline_row {
+      uint64_t id;
+      name contract;
+      symbol sym;
+      asset total_staked;
+      asset total_reward;
+      asset released_reward;
+      uint32_t epoch_time;
+      uint32_t duration;
+      asset min_staked;
+      uint32_t last_harvest_time;
+      uint8_t box_enable;
+      symbol_code box_code;
+      asset box_reward;
+   };
+
+   /// A miner of the deployed poolv2.
+   struct miner_v2_baseline_row {
+      name owner;
+      asset staked;
+      asset claimed_crl;
+      asset unclaimed_crl;
+      asset claimed_box;
+      asset unclaimed_box;
+   };
+
+   /// One reward token of a poolv2 pool.
+   struct pool_reward_row {
+      eosio::extended_symbol token;
+      uint8_t source;
+      uint64_t funded;
+      uint64_t released;
+      uint128_t per_share;
+   };
+
+   /// A pool of the current poolv2.
+   struct pool_v2_row {
+      uint64_t id;
+      name contract;
+      symbol sym;
+      asset total_staked;
+      asset total_reward;
+      asset released_reward;
+      uint32_t epoch_time;
+      uint32_t duration;
+      asset min_staked;
+      uint32_t last_harvest_time;
+      uint8_t box_enable;
+      symbol_code box_code;
+      std::vector<pool_reward_row> rewards;
+   };
+
+   /// What a poolv2 staker holds of one reward token.
+   struct reward_balance_row {
+      uint64_t claimed;
+      uint64_t unclaimed;
+      uint128_t debt;
+   };
+
+   /// A staker of the current poolv2.
+   struct staker_row {
+      name owner;
+      uint64_t staked;
+      std::vector<reward_balance_row> balances;
+   };
+
+   struct registry_row {
+      asset committed_reward;
+      asset released_reward;
+      uint64_t active_pools;
+   };
+
+   struct contract_row {
+      name contract;
+      uint64_t pools;
+      uint64_t miners;
+   };
+
+   struct poolstat_row {
+      uint64_t pool_id;
+      uint64_t harvests;
+      uint32_t harvest_interval;
+      uint64_t rows_last;
+      uint64_t rows_total;
+      uint64_t deferred;
+      uint64_t crl_last;
+      uint64_t crl_total;
+      uint64_t deposits;
+      uint64_t deposit_volume;
+      uint64_t withdrawals;
+      uint64_t withdraw_volume;
+      uint64_t box_total;
+   };
+
+   struct posindex_row {
+      uint64_t pool_id;
+      name owner;
+      uint64_t rows;
+   };
+
+   /// An entry of v1 getpending.
+   struct pending_v1_row {
+      uint64_t pool_id;
+      asset staked;
+      asset crl;
+   };
+
+   /// An entry of poolv2 getpending.
+   struct pending_v2_row {
+      uint64_t pool_id;
+      asset staked;
+      std::vector<eosio::extended_asset> rewards;
+   };
+
+   /// An entry of v1 getpools.
+   struct pool_state_v1_row {
+      uint64_t pool_id;
+      name contract;
+      symbol sym;
+      asset total_staked;
+      asset total_reward;
+      asset released_reward;
+      asset pending_reward;
+      asset reward_per_day;
+      uint32_t epoch_time;
+      uint32_t duration;
+   };
+
+   /// An entry of poolv2 getpools.
+   struct pool_state_v2_row {
+      uint64_t pool_id;
+      name contract;
+      symbol sym;
+      asset total_staked;
+      asset total_reward;
+      asset released_reward;
+      asset pending_reward;
+      asset reward_per_day;
+      std::vector<eosio::extended_asset> rewards;
+      uint32_t epoch_time;
+      uint32_t duration;
+   };
+
+   /// What `receiver` returned from `action` in the trace.
+   template <typename T>
+   T return_of(const transaction_trace& trace, name receiver, name action) {
+      for (const auto& a : trace.actions) {
+         if (a.receiver == receiver && a.action == action) {
+            return eosio::unpack<T>(a.return_value);
+         }
+      }
+      eosio::check(false, "No such action");
+      return T{};
+   }
+
+   /// One engine::pool_event of a `log` action.
+   struct pool_event_row {
+      uint8_t kind;
+      uint64_t pool_id;
+      name owner;
+      asset quantity;
+      asset total_staked;
+      std::vector<eosio::extended_asset> amounts;
+      std::vector<uint128_t> per_share;
+   };
+
+   /// The events of every `log` the pools contract ran in the trace, in order.
+   inline std::vector<pool_event_row> events_of(const transaction_trace& trace, name pools) {
+      std::vector<pool_event_row> events;
+      for (const auto& a : trace.actions) {
+         if (a.receiver == pools && a.account == pools && a.action == name("log")) {
+            auto logged = eosio::unpack<std::vector<pool_event_row>>(a.data);
+            events.insert(events.end(), logged.begin(), logged.end());
+         }
+      }
+      return events;
+   }
+
+   /// The message of the check `push` fails, empty if it succeeds.
+   template <typename F>
+   std::string error_of(F&& push) {
+      try {
+         push();
+      } catch (const eosio::eosio_assert_exception& e) {
+         return e.what();
+      }
+      return "";
+   }
+
+} // namespace host
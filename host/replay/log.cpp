@@ -0,0 +1,111 @@
+#include "log.hpp"
+
+#include <sstream>
+#include <stdexcept>
+
+namespace replay {
+
+   namespace {
+
+      std::vector<uint64_t> parse_ids(const std::string& list) {
+         std::vector<uint64_t> ids;
+         std::istringstream in(list);
+         std::string id;
+         while (std::getline(in, id, ',')) {
+            ids.push_back(std::stoull(id));
+         }
+         if (ids.empty()) throw std::runtime_error("empty pool id list");
+         return ids;
+      }
+
+      std::string next(std::istringstream& fields) {
+         std::string s;
+         if (!(fields >> s)) throw std::runtime_error("missing field");
+         return s;
+      }
+
+      entry parse_line(const std::string& text) {
+         std::istringstream fields(text);
+         entry e;
+         e.time = (uint32_t)std::stoul(next(fields));
+         auto version = next(fields);
+         if (version == "v1") {
+            e.version = target::v1;
+         } else if (version == "v2") {
+            e.version = target::v2;
+         } else {
+            throw std::runtime_error("unknown contract version " + version);
+         }
+         auto action = next(fields);
+         e.action = name(action);
+
+         if (action == "create") {
+            e.token = name(next(fields));
+            auto amount = next(fields);
+            e.reward = parse_asset(amount, next(fields));
+            e.epoch_time = (uint32_t)std::stoul(next(fields));
+            e.duration = (uint32_t)std::stoul(next(fields));
+            amount = next(fields);
+            e.min_staked = parse_asset(amount, next(fields));
+            std::string box;
+            if (fields >> box) {
+               e.box_enable = (uint8_t)std::stoul(box);
+               e.box_code = next(fields);
+            }
+         } else if (action == "transfer") {
+            e.account = name(next(fields));
+            e.token = name(next(fields));
+            auto amount = next(fields);
+            e.quantity = parse_asset(amount, next(fields));
+            std::getline(fields >> std::ws, e.memo);
+         } else if (action == "harvest") {
+            e.pool_ids = {std::stoull(next(fields))};
+         } else if (action == "harvestall") {
+            e.pool_ids = parse_ids(next(fields));
+            e.max_rows = (uint32_t)std::stoul(next(fields));
+         } else if (action == "claim" || action == "withdraw") {
+            e.account = name(next(fields));
+            e.pool_ids = {std::stoull(next(fields))};
+         } else if (action == "claimall") {
+            e.account = name(next(fields));
+            e.pool_ids = parse_ids(next(fields));
+         } else {
+            throw std::runtime_error("unknown action " + action);
+         }
+         return e;
+      }
+
+   } // namespace
+
+   asset parse_asset(const std::string& amount, const std::string& code) {
+      auto dot = amount.find('.');
+      uint8_t precision = dot == std::string::npos ? 0 : uint8_t(amount.size() - dot - 1);
+      auto digits = amount;
+      if (dot != std::string::npos) digits.erase(dot, 1);
+      return asset(std::stoll(digits), eosio::symbol(code, precision));
+   }
+
+   std::vector<entry> read_log(std::istream& in) {
+      std::vector<entry> entries;
+      std::string line;
+      std::size_t number = 0;
+      uint32_t last_time = 0;
+      while (std::getline(in, line)) {
+         number++;
+         auto hash = line.find('#');
+         if (hash != std::string::npos) line.erase(hash);
+         if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+         try {
+            auto e = parse_line(line);
+            if (e.time < last_time) throw std::runtime_error("time goes backwards");
+            last_time = e.time;
+            e.line = number;
+            entries.push_back(std::move(e));
+         } catch (const std::exception& ex) {
+            throw std::runtime_error("line " + std::to_string(number) + ": " + ex.what());
+         }
+      }
+      return entries;
+   }
+
+} // namespace replay
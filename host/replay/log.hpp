@@ -0,0 +1,64 @@
+// Action log format of host_replay.
+//
+// One action per line, fields separated by blanks, `#` starts a comment:
+//
+//    <time> <v1|v2> create     <token> <reward> <epoch> <duration> <min_staked> [<box_enable> <box_code>]
+//    <time> <v1|v2> transfer   <from> <token> <quantity> [<memo>]
+//    <time> <v1|v2> harvest    <pool_id>
+//    <time> <v1|v2> harvestall <pool_id,...> <max_rows>
+//    <time> <v1|v2> claim      <owner> <pool_id>
+//    <time> <v1|v2> claimall   <owner> <pool_id,...>
+//    <time> <v1|v2> withdraw   <owner> <pool_id>
+//
+// Times are seconds since the epoch and must not go backwards. Quantities
+// are written like the chain prints them ("100.0000 LP"). Pool ids are the
+// ones the contract handed out, i.e. the order of the create lines of that
+// version; a transfer goes to the pools contract and stakes like on chain,
+// by memo or by token.
+#pragma once
+
+#include <eosio/asset.hpp>
+#include <eosio/name.hpp>
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace replay {
+
+   using eosio::asset;
+   using eosio::name;
+
+   enum class target { v1, v2 };
+
+   struct entry {
+      std::size_t line = 0;
+      uint32_t time = 0;
+      target version = target::v1;
+      name action;
+
+      name account;                  // transfer from, claim/withdraw owner
+      name token;                    // create, transfer
+      asset quantity;                // transfer
+      std::string memo;              // transfer
+      std::vector<uint64_t> pool_ids; // harvest, claim, withdraw, the *all actions
+
+      // create
+      asset reward;
+      uint32_t epoch_time = 0;
+      uint32_t duration = 0;
+      asset min_staked;
+      uint8_t box_enable = 0;
+      std::string box_code = "BOX";
+
+      uint32_t max_rows = 0;          // harvestall
+   };
+
+   /// Parses "100.0000 LP" style quantities.
+   asset parse_asset(const std::string& amount, const std::string& code);
+
+   /// Reads a whole log, throws std::runtime_error naming the bad line.
+   std::vector<entry> read_log(std::istream& in);
+
+} // namespace replay
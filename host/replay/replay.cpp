@@ -0,0 +1,437 @@
+// host_replay: replays an action log (see log.hpp) against the native pool,
+// poolv2 and token contracts and reports what the traffic would cost.
+//
+//    host_replay [--jobs N] [--sample SECONDS] [--balances FILE] LOG
+//
+// Pools that never appear in the same action are independent, so every pool
+// replays on its own chain and the chains run in parallel. A version whose
+// log has harvestall or claimall lines replays on a single chain instead.
+// Miners are given the stake tokens they transfer if the log doesn't fund
+// them; the report lists how much had to be minted that way.
+//
+// The report has the cost distribution of every action (rows, bytes, inline
+// actions, wall time), the size of the pools contract's miner tables and RAM
+// over time, and the final balances.
+#include "log.hpp"
+
+#include <host/coral.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+
+using namespace host;
+using replay::entry;
+using replay::target;
+using eosio::asset;
+using eosio::symbol;
+
+namespace {
+
+   struct options {
+      std::string log;
+      unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+      uint32_t sample = 86400;
+      std::string balances;
+   };
+
+   struct partition {
+      target version;
+      std::vector<const entry*> entries;
+      // log pool id -> pool id on the partition's chain, empty if they are the same
+      std::map<uint64_t, uint64_t> pool_ids;
+   };
+
+   struct action_cost {
+      counters cost;
+      double micros;
+      bool failed;
+   };
+
+   struct table_sample {
+      uint64_t miner_rows = 0;
+      uint64_t pools = 0;
+      int64_t ram = 0;
+   };
+
+   typedef std::tuple<uint64_t, uint64_t, uint64_t> balance_key; // account, token, symbol
+
+   struct partition_result {
+      std::map<std::string, std::vector<action_cost>> costs;
+      std::vector<table_sample> timeline;
+      std::map<balance_key, int64_t> balances;
+      std::map<std::pair<uint64_t, uint64_t>, int64_t> minted; // token, symbol
+      std::string error;
+   };
+
+   const char* version_name(target v) { return v == target::v1 ? "v1" : "v2"; }
+
+   // Splits the log into partitions that can replay on separate chains.
+   std::vector<partition> split(const std::vector<entry>& entries) {
+      std::vector<partition> parts;
+      for (auto v : {target::v1, target::v2}) {
+         bool shared = false;
+         bool any = false;
+         for (const auto& e : entries) {
+            if (e.version != v) continue;
+            any = true;
+            shared |= e.action == name("harvestall") || e.action == name("claimall");
+         }
+         if (!any) continue;
+
+         if (shared) {
+            partition p{v, {}, {}};
+            for (const auto& e : entries) {
+               if (e.version == v) p.entries.push_back(&e);
+            }
+            parts.push_back(std::move(p));
+            continue;
+         }
+
+         // one partition per pool, plus one for transfers that match no pool
+         std::map<uint64_t, std::size_t> by_pool;
+         std::map<std::pair<uint64_t, uint64_t>, uint64_t> by_token;
+         std::size_t unmatched = 0;
+         uint64_t next_id = 1;
+         auto part_of = [&](uint64_t pool_id) -> partition& {
+            auto itr = by_pool.find(pool_id);
+            if (itr == by_pool.end()) {
+               if (!unmatched) {
+                  parts.push_back(partition{v, {}, {}});
+                  unmatched = parts.size();
+               }
+               return parts[unmatched - 1];
+            }
+            return parts[itr->second];
+         };
+         for (const auto& e : entries) {
+            if (e.version != v) continue;
+            if (e.action == name("create")) {
+               auto id = next_id++;
+               by_pool[id] = parts.size();
+               by_token.emplace(std::make_pair(e.token.value, e.min_staked.symbol.raw()), id);
+               parts.push_back(partition{v, {&e}, {{id, 1}}});
+            } else if (e.action == name("transfer")) {
+               uint64_t id = 0;
+               if (e.memo.compare(0, 5, "pool:") == 0) {
+                  id = std::strtoull(e.memo.c_str() + 5, nullptr, 10);
+               } else {
+                  auto itr = by_token.find({e.token.value, e.quantity.symbol.raw()});
+                  if (itr != by_token.end()) id = itr->second;
+               }
+               part_of(id).entries.push_back(&e);
+            } else {
+               part_of(e.pool_ids.front()).entries.push_back(&e);
+            }
+         }
+      }
+      return parts;
+   }
+
+   class replayer {
+   public:
+      replayer(const partition& p, const std::vector<uint32_t>& grid, partition_result& out)
+          : part(p), grid(grid), out(out) {}
+
+      void run() {
+         coral::deploy(c, part.version == target::v1 ? coral::version::v1 : coral::version::v2,
+                       part.entries.front()->time);
+         for (const auto* e : part.entries) {
+            while (next_sample < grid.size() && grid[next_sample] < e->time) {
+               take_sample();
+            }
+            c.set_time(e->time);
+            execute(*e);
+         }
+         while (next_sample < grid.size()) {
+            take_sample();
+         }
+         collect_balances();
+      }
+
+   private:
+      const partition& part;
+      const std::vector<uint32_t>& grid;
+      partition_result& out;
+      chain c;
+      std::size_t next_sample = 0;
+      uint64_t pools_created = 0;
+      std::set<uint64_t> accounts;
+      std::set<std::pair<uint64_t, uint64_t>> symbols; // token, symbol
+      std::set<uint64_t> token_accounts{coral::crl_token.value, coral::stake_token.value};
+
+      uint64_t pool_id(uint64_t id) const {
+         if (part.pool_ids.empty()) return id;
+         auto itr = part.pool_ids.find(id);
+         // pools of other partitions don't exist here, like unknown pools on chain
+         return itr == part.pool_ids.end() ? 0 : itr->second;
+      }
+
+      std::vector<uint64_t> pool_ids(const std::vector<uint64_t>& ids) const {
+         std::vector<uint64_t> local;
+         for (auto id : ids) local.push_back(pool_id(id));
+         return local;
+      }
+
+      void ensure_account(name account) {
+         if (accounts.insert(account.value).second) c.create_account(account);
+      }
+
+      void ensure_token(name token, symbol sym) {
+         if (!symbols.insert({token.value, sym.raw()}).second) return;
+         if (token_accounts.insert(token.value).second) c.set_code(token, token_apply);
+         if (!c.get_row_bytes(token, sym.code().raw(), name("stat"), sym.code().raw())) {
+            c.push(token, name("create"), token, token, asset(asset::max_amount, sym));
+         }
+      }
+
+      // gives `account` what it is about to transfer if the log never funded it
+      void ensure_balance(name account, name token, const asset& quantity) {
+         ensure_account(account);
+         ensure_token(token, quantity.symbol);
+         auto have = coral::balance(c, token, account, quantity.symbol);
+         if (have >= quantity.amount) return;
+         auto missing = asset(quantity.amount - have, quantity.symbol);
+         c.push(token, name("issue"), token, token, missing, std::string("replay"));
+         c.push(token, name("transfer"), token, token, account, missing, std::string("replay"));
+         out.minted[{token.value, quantity.symbol.raw()}] += missing.amount;
+      }
+
+      transaction_trace push(const entry& e) {
+         const name pools = coral::pools;
+         auto a = e.action;
+         if (a == name("create")) {
+            ensure_token(e.token, e.min_staked.symbol);
+            pools_created++;
+            if (e.version == target::v1) {
+               return c.push(pools, a, coral::manager, e.token, e.min_staked.symbol, e.reward, e.epoch_time,
+                             e.duration, e.min_staked);
+            }
+            return c.push(pools, a, coral::manager, e.token, e.min_staked.symbol, e.reward, e.epoch_time, e.duration,
+                          e.min_staked, e.box_enable, eosio::symbol_code(e.box_code));
+         }
+         if (a == name("transfer")) {
+            ensure_balance(e.account, e.token, e.quantity);
+            auto memo = e.memo;
+            if (memo.compare(0, 5, "pool:") == 0) {
+               memo = "pool:" + std::to_string(pool_id(std::strtoull(memo.c_str() + 5, nullptr, 10)));
+            }
+            return c.push(e.token, a, e.account, e.account, pools, e.quantity, memo);
+         }
+         if (a == name("harvest")) {
+            if (e.version == target::v1) {
+               return c.push(pools, a, coral::manager, pool_id(e.pool_ids.front()), uint32_t(0));
+            }
+            return c.push(pools, a, coral::manager, pool_id(e.pool_ids.front()));
+         }
+         if (a == name("harvestall")) {
+            return c.push(pools, a, coral::manager, pool_ids(e.pool_ids), e.max_rows);
+         }
+         ensure_account(e.account);
+         if (a == name("claimall")) {
+            return c.push(pools, a, e.account, e.account, pool_ids(e.pool_ids));
+         }
+         return c.push(pools, a, e.account, e.account, pool_id(e.pool_ids.front()));
+      }
+
+      void execute(const entry& e) {
+         action_cost cost{};
+         auto start = std::chrono::steady_clock::now();
+         try {
+            auto trace = push(e);
+            cost.cost = trace.cost_of(coral::pools, e.action);
+         } catch (const std::exception&) {
+            cost.failed = true;
+         }
+         cost.micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+         out.costs[std::string(version_name(e.version)) + " " + e.action.to_string()].push_back(cost);
+      }
+
+      void take_sample() {
+         table_sample s;
+         for (uint64_t id = 1; id <= pools_created; id++) {
+            s.miner_rows += c.row_count(coral::pools, id, name("miners"));
+            s.miner_rows += c.row_count(coral::pools, id, name("stakers"));
+         }
+         s.pools = pools_created;
+         s.ram = c.ram_usage(coral::pools);
+         out.timeline.push_back(s);
+         next_sample++;
+      }
+
+      void collect_balances() {
+         for (auto account : accounts) {
+            auto crl = coral::balance(c, coral::crl_token, name(account), coral::crl_symbol);
+            if (crl) out.balances[{account, coral::crl_token.value, coral::crl_symbol.raw()}] += crl;
+            for (const auto& s : symbols) {
+               auto amount = coral::balance(c, name(s.first), name(account), symbol(s.second));
+               if (amount) out.balances[{account, s.first, s.second}] += amount;
+            }
+         }
+      }
+   };
+
+   struct stats {
+      std::vector<double> values;
+
+      double at(double q) {
+         if (values.empty()) return 0;
+         std::sort(values.begin(), values.end());
+         auto rank = std::size_t(q * double(values.size() - 1) + 0.5);
+         return values[std::min(rank, values.size() - 1)];
+      }
+   };
+
+   std::string format_amount(int64_t amount, symbol sym) { return asset(amount, sym).to_string(); }
+
+   void report(const options& opts, const std::vector<partition_result>& results, const std::vector<uint32_t>& grid,
+               std::size_t actions, std::size_t partitions, unsigned threads, double seconds) {
+      std::printf("replayed %zu actions in %zu partitions on %u threads in %.2f s\n\n", actions, partitions, threads,
+                  seconds);
+
+      std::map<std::pair<uint64_t, uint64_t>, int64_t> minted;
+      for (const auto& r : results) {
+         if (!r.error.empty()) std::printf("partition failed: %s\n", r.error.c_str());
+         for (const auto& m : r.minted) minted[m.first] += m.second;
+      }
+      for (const auto& m : minted) {
+         std::printf("minted for unfunded transfers: %s on %s\n",
+                     format_amount(m.second, symbol(m.first.second)).c_str(), name(m.first.first).to_string().c_str());
+      }
+
+      std::map<std::string, std::vector<action_cost>> costs;
+      for (const auto& r : results) {
+         for (const auto& c : r.costs) costs[c.first].insert(costs[c.first].end(), c.second.begin(), c.second.end());
+      }
+      std::printf("\n%-14s %8s %6s | %21s | %21s | %9s | %25s\n", "action", "count", "failed",
+                  "rows p50/p99/max", "bytes p50/p99/max", "inline", "time us p50/p99/max");
+      for (auto& c : costs) {
+         stats rows, bytes, inlines, time;
+         std::size_t failed = 0;
+         for (const auto& a : c.second) {
+            if (a.failed) {
+               failed++;
+               continue;
+            }
+            rows.values.push_back(double(a.cost.db_reads + a.cost.db_writes));
+            bytes.values.push_back(double(a.cost.bytes_read + a.cost.bytes_written));
+            inlines.values.push_back(double(a.cost.inline_actions));
+            time.values.push_back(a.micros);
+         }
+         std::printf("%-14s %8zu %6zu | %6.0f %6.0f %7.0f | %6.0f %6.0f %7.0f | %9.0f | %7.1f %7.1f %9.1f\n",
+                     c.first.c_str(), c.second.size(), failed, rows.at(.5), rows.at(.99), rows.at(1), bytes.at(.5),
+                     bytes.at(.99), bytes.at(1), inlines.at(1), time.at(.5), time.at(.99), time.at(1));
+      }
+
+      std::printf("\n%-12s %8s %12s %14s\n", "time", "pools", "miner rows", "pools RAM");
+      for (std::size_t i = 0; i < grid.size(); i++) {
+         table_sample total;
+         for (const auto& r : results) {
+            if (i >= r.timeline.size()) continue;
+            total.pools += r.timeline[i].pools;
+            total.miner_rows += r.timeline[i].miner_rows;
+            total.ram += r.timeline[i].ram;
+         }
+         std::printf("%-12u %8llu %12llu %14lld\n", grid[i], (unsigned long long)total.pools,
+                     (unsigned long long)total.miner_rows, (long long)total.ram);
+      }
+
+      std::map<balance_key, int64_t> balances;
+      for (const auto& r : results) {
+         for (const auto& b : r.balances) balances[b.first] += b.second;
+      }
+      FILE* out = stdout;
+      if (!opts.balances.empty()) {
+         out = std::fopen(opts.balances.c_str(), "w");
+         if (!out) throw std::runtime_error("cannot write " + opts.balances);
+         std::printf("\nfinal balances written to %s\n", opts.balances.c_str());
+      } else {
+         std::printf("\nfinal balances\n");
+      }
+      std::fprintf(out, "account,token,balance\n");
+      for (const auto& b : balances) {
+         std::fprintf(out, "%s,%s,%s\n", name(std::get<0>(b.first)).to_string().c_str(),
+                      name(std::get<1>(b.first)).to_string().c_str(),
+                      format_amount(b.second, symbol(std::get<2>(b.first))).c_str());
+      }
+      if (out != stdout) std::fclose(out);
+   }
+
+   options parse_options(int argc, char** argv) {
+      options opts;
+      for (int i = 1; i < argc; i++) {
+         std::string arg = argv[i];
+         auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::runtime_error(arg + " needs a value");
+            return argv[++i];
+         };
+         if (arg == "--jobs") {
+            opts.jobs = std::max(1, std::stoi(value()));
+         } else if (arg == "--sample") {
+            opts.sample = std::max(1, std::stoi(value()));
+         } else if (arg == "--balances") {
+            opts.balances = value();
+         } else if (!arg.empty() && arg[0] != '-' && opts.log.empty()) {
+            opts.log = arg;
+         } else {
+            throw std::runtime_error("unknown argument " + arg);
+         }
+      }
+      if (opts.log.empty()) {
+         throw std::runtime_error("usage: host_replay [--jobs N] [--sample SECONDS] [--balances FILE] LOG");
+      }
+      return opts;
+   }
+
+} // namespace
+
+int main(int argc, char** argv) {
+   try {
+      auto opts = parse_options(argc, argv);
+      std::ifstream in(opts.log);
+      if (!in) throw std::runtime_error("cannot read " + opts.log);
+      auto entries = replay::read_log(in);
+      if (entries.empty()) throw std::runtime_error("empty log");
+
+      std::vector<uint32_t> grid;
+      for (uint64_t t = entries.front().time; t <= entries.back().time + uint64_t(opts.sample); t += opts.sample) {
+         grid.push_back(uint32_t(t));
+      }
+
+      auto parts = split(entries);
+      std::vector<partition_result> results(parts.size());
+      std::atomic<std::size_t> next{0};
+      auto worker = [&] {
+         for (std::size_t i; (i = next++) < parts.size();) {
+            try {
+               replayer(parts[i], grid, results[i]).run();
+            } catch (const std::exception& e) {
+               results[i].error = e.what();
+            }
+         }
+      };
+
+      auto start = std::chrono::steady_clock::now();
+      unsigned threads = unsigned(std::min<std::size_t>(opts.jobs, parts.size()));
+      std::vector<std::thread> pool;
+      for (unsigned t = 0; t < threads; t++) pool.emplace_back(worker);
+      for (auto& t : pool) t.join();
+      auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      report(opts, results, grid, entries.size(), parts.size(), threads, seconds);
+   } catch (const std::exception& e) {
+      std::fprintf(stderr, "host_replay: %s\n", e.what());
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,732 @@
+#include <host/chain.hpp>
+
+#include <eosio/check.hpp>
+#include <eosio/db.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <set>
+
+namespace host {
+
+   namespace {
+      // Billable overheads nodeos charges per row on top of the payload
+      // (config::billable_size_v of key_value_object and the index objects).
+      constexpr int64_t primary_row_overhead = 112;
+      constexpr int64_t secondary_row_overhead = 128;
+
+      constexpr uint32_t max_inline_action_depth = 10;
+
+      struct row {
+         uint64_t payer;
+         std::vector<char> data;
+      };
+
+      struct secondary_row {
+         uint128_t key;
+         uint64_t payer;
+      };
+   } // namespace
+
+   struct chain::impl {
+      struct table_state {
+         table_key key;
+         int32_t id;
+         std::map<uint64_t, row> rows;
+      };
+
+      struct index_state {
+         table_key key;
+         int32_t id;
+         std::set<std::pair<uint128_t, uint64_t>> entries;
+         std::map<uint64_t, secondary_row> by_primary;
+      };
+
+      struct undo_entry {
+         table_state* table = nullptr;
+         index_state* index = nullptr;
+         uint64_t primary = 0;
+         std::optional<row> prev_row;
+         std::optional<secondary_row> prev_secondary;
+      };
+
+      struct apply_context {
+         name receiver;
+         const eosio::action* act = nullptr;
+         std::vector<name>* receivers = nullptr;
+         std::vector<eosio::action>* inlines = nullptr;
+         counters cost;
+         std::vector<char> return_value;
+
+         std::vector<std::pair<table_state*, uint64_t>> primary_iterators;
+         std::map<std::pair<table_state*, uint64_t>, int32_t> primary_lookup;
+         std::vector<std::tuple<index_state*, uint128_t, uint64_t>> secondary_iterators;
+         std::map<std::pair<index_state*, uint64_t>, int32_t> secondary_lookup;
+      };
+
+      std::map<table_key, std::unique_ptr<table_state>> tables;
+      std::vector<table_state*> tables_by_id;
+      std::map<table_key, std::unique_ptr<index_state>> indices;
+      std::vector<index_state*> indices_by_id;
+
+      std::set<uint64_t> accounts;
+      std::map<uint64_t, apply_handler> code;
+      std::map<uint64_t, int64_t> ram;
+
+      uint64_t now_us = 0;
+      counters totals;
+
+      bool in_transaction = false;
+      std::vector<undo_entry> undo;
+
+      apply_context* ctx = nullptr;
+      chain* previous = nullptr;
+
+      apply_context& context() {
+         eosio::check(ctx != nullptr, "database intrinsics called outside of an action");
+         return *ctx;
+      }
+
+      // Tables
+
+      table_state* find_table(uint64_t c, uint64_t scope, uint64_t table) {
+         auto itr = tables.find({c, scope, table});
+         return itr == tables.end() ? nullptr : itr->second.get();
+      }
+
+      table_state& get_or_create_table(uint64_t c, uint64_t scope, uint64_t table) {
+         auto& t = tables[{c, scope, table}];
+         if (!t) {
+            t = std::make_unique<table_state>();
+            t->key = {c, scope, table};
+            t->id = (int32_t)tables_by_id.size();
+            tables_by_id.push_back(t.get());
+         }
+         return *t;
+      }
+
+      index_state* find_index(uint64_t c, uint64_t scope, uint64_t table) {
+         auto itr = indices.find({c, scope, table});
+         return itr == indices.end() ? nullptr : itr->second.get();
+      }
+
+      index_state& get_or_create_index(uint64_t c, uint64_t scope, uint64_t table) {
+         auto& i = indices[{c, scope, table}];
+         if (!i) {
+            i = std::make_unique<index_state>();
+            i->key = {c, scope, table};
+            i->id = (int32_t)indices_by_id.size();
+            indices_by_id.push_back(i.get());
+         }
+         return *i;
+      }
+
+      // Mutations; all of them go through here so RAM and undo stay in sync.
+
+      void set_row(table_state& t, uint64_t primary, std::optional<row> value, bool record) {
+         auto itr = t.rows.find(primary);
+         if (record) {
+            undo_entry u;
+            u.table = &t;
+            u.primary = primary;
+            if (itr != t.rows.end()) u.prev_row = itr->second;
+            undo.push_back(std::move(u));
+         }
+         if (itr != t.rows.end()) {
+            ram[itr->second.payer] -= int64_t(itr->second.data.size()) + primary_row_overhead;
+         }
+         if (value) {
+            ram[value->payer] += int64_t(value->data.size()) + primary_row_overhead;
+            t.rows[primary] = std::move(*value);
+         } else if (itr != t.rows.end()) {
+            t.rows.erase(itr);
+         }
+      }
+
+      void set_secondary(index_state& i, uint64_t primary, std::optional<secondary_row> value, bool record) {
+         auto itr = i.by_primary.find(primary);
+         if (record) {
+            undo_entry u;
+            u.index = &i;
+            u.primary = primary;
+            if (itr != i.by_primary.end()) u.prev_secondary = itr->second;
+            undo.push_back(std::move(u));
+         }
+         if (itr != i.by_primary.end()) {
+            ram[itr->second.payer] -= secondary_row_overhead;
+            i.entries.erase({itr->second.key, primary});
+            i.by_primary.erase(itr);
+         }
+         if (value) {
+            ram[value->payer] += secondary_row_overhead;
+            i.entries.insert({value->key, primary});
+            i.by_primary[primary] = *value;
+         }
+      }
+
+      void rollback() {
+         for (auto itr = undo.rbegin(); itr != undo.rend(); ++itr) {
+            if (itr->table) {
+               set_row(*itr->table, itr->primary, itr->prev_row, false);
+            } else {
+               set_secondary(*itr->index, itr->primary, itr->prev_secondary, false);
+            }
+         }
+         undo.clear();
+      }
+
+      // Iterator handles, scoped to one apply like the nodeos iterator cache.
+
+      int32_t primary_iterator(table_state& t, uint64_t primary) {
+         auto& c = context();
+         auto [itr, inserted] = c.primary_lookup.try_emplace({&t, primary}, (int32_t)c.primary_iterators.size());
+         if (inserted) c.primary_iterators.emplace_back(&t, primary);
+         return itr->second;
+      }
+
+      static int32_t end_iterator(int32_t id) { return -(id + 2); }
+
+      std::pair<table_state*, uint64_t> primary_at(int32_t iterator) {
+         auto& its = context().primary_iterators;
+         eosio::check(iterator >= 0 && iterator < (int32_t)its.size(), "invalid db iterator");
+         return its[iterator];
+      }
+
+      int32_t secondary_iterator(index_state& i, uint128_t key, uint64_t primary) {
+         auto& c = context();
+         auto [itr, inserted] = c.secondary_lookup.try_emplace({&i, primary}, (int32_t)c.secondary_iterators.size());
+         if (inserted) {
+            c.secondary_iterators.emplace_back(&i, key, primary);
+         } else {
+            std::get<1>(c.secondary_iterators[itr->second]) = key;
+         }
+         return itr->second;
+      }
+
+      std::tuple<index_state*, uint128_t, uint64_t> secondary_at(int32_t iterator) {
+         auto& its = context().secondary_iterators;
+         eosio::check(iterator >= 0 && iterator < (int32_t)its.size(), "invalid secondary db iterator");
+         return its[iterator];
+      }
+
+      // Execution
+
+      void require_write_access(const table_key& k) {
+         eosio::check(k.code == context().receiver.value, "db access violation");
+      }
+
+      void apply_one(name receiver, const eosio::action& act, std::vector<name>& receivers,
+                     std::vector<eosio::action>& inlines, transaction_trace& trace) {
+         apply_context c;
+         c.receiver = receiver;
+         c.act = &act;
+         c.receivers = &receivers;
+         c.inlines = &inlines;
+
+         auto saved = ctx;
+         ctx = &c;
+         try {
+            auto handler = code.find(receiver.value);
+            if (handler != code.end()) {
+               handler->second(receiver.value, act.account.value, act.name.value);
+            }
+         } catch (...) {
+            ctx = saved;
+            throw;
+         }
+         ctx = saved;
+
+         totals += c.cost;
+         trace.total += c.cost;
+         trace.actions.push_back({receiver, act.account, act.name, c.cost, std::move(c.return_value), act.data});
+      }
+
+      void execute(const eosio::action& act, transaction_trace& trace, uint32_t depth) {
+         eosio::check(depth < max_inline_action_depth, "max inline action depth per transaction reached");
+         eosio::check(accounts.count(act.account.value) > 0,
+                      "action's code account '" + act.account.to_string() + "' does not exist");
+
+         std::vector<name> receivers{act.account};
+         std::vector<eosio::action> inlines;
+         for (std::size_t i = 0; i < receivers.size(); ++i) {
+            apply_one(receivers[i], act, receivers, inlines, trace);
+         }
+         for (const auto& a : inlines) {
+            execute(a, trace, depth + 1);
+         }
+      }
+   };
+
+   namespace {
+      thread_local chain* current_chain = nullptr;
+
+      chain::impl& state() {
+         eosio::check(current_chain != nullptr, "no host chain is active on this thread");
+         return current_chain->internals();
+      }
+   } // namespace
+
+   counters transaction_trace::cost_of(name receiver, name action) const {
+      counters c;
+      for (const auto& a : actions) {
+         if (a.receiver == receiver && a.action == action) c += a.cost;
+      }
+      return c;
+   }
+
+   chain::chain() : my(std::make_unique<impl>()) {
+      my->previous = current_chain;
+      current_chain = this;
+   }
+
+   chain::~chain() {
+      if (current_chain == this) current_chain = my->previous;
+   }
+
+   chain& chain::current() {
+      eosio::check(current_chain != nullptr, "no host chain is active on this thread");
+      return *current_chain;
+   }
+
+   void chain::create_account(name account) { my->accounts.insert(account.value); }
+
+   void chain::set_code(name account, apply_handler handler) {
+      create_account(account);
+      my->code[account.value] = handler;
+   }
+
+   void chain::set_time(uint32_t sec_since_epoch) { my->now_us = uint64_t(sec_since_epoch) * 1000000; }
+
+   void chain::produce_blocks(uint32_t seconds) { my->now_us += uint64_t(seconds) * 1000000; }
+
+   uint32_t chain::time() const { return uint32_t(my->now_us / 1000000); }
+
+   transaction_trace chain::push_action(name account, name action, std::vector<eosio::permission_level> auth,
+                                        std::vector<char> data) {
+      eosio::check(!my->in_transaction, "transactions cannot be nested");
+      for (const auto& p : auth) {
+         eosio::check(my->accounts.count(p.actor.value) > 0,
+                      "authorizing actor '" + p.actor.to_string() + "' does not exist");
+      }
+
+      eosio::action act;
+      act.account = account;
+      act.name = action;
+      act.authorization = std::move(auth);
+      act.data = std::move(data);
+
+      // Make sure the intrinsics of this thread talk to this chain.
+      auto saved = current_chain;
+      current_chain = this;
+
+      transaction_trace trace;
+      my->in_transaction = true;
+      my->undo.clear();
+      try {
+         my->execute(act, trace, 0);
+      } catch (...) {
+         my->rollback();
+         my->in_transaction = false;
+         current_chain = saved;
+         throw;
+      }
+      my->undo.clear();
+      my->in_transaction = false;
+      current_chain = saved;
+      return trace;
+   }
+
+   std::optional<std::vector<char>> chain::get_row_bytes(name code, uint64_t scope, name table, uint64_t primary) const {
+      auto t = my->find_table(code.value, scope, table.value);
+      if (!t) return std::nullopt;
+      auto itr = t->rows.find(primary);
+      if (itr == t->rows.end()) return std::nullopt;
+      return itr->second.data;
+   }
+
+   std::vector<uint64_t> chain::primary_keys(name code, uint64_t scope, name table) const {
+      std::vector<uint64_t> keys;
+      if (auto t = my->find_table(code.value, scope, table.value)) {
+         keys.reserve(t->rows.size());
+         for (const auto& r : t->rows) keys.push_back(r.first);
+      }
+      return keys;
+   }
+
+   std::size_t chain::row_count(name code, uint64_t scope, name table) const {
+      auto t = my->find_table(code.value, scope, table.value);
+      return t ? t->rows.size() : 0;
+   }
+
+   std::size_t chain::table_count() const {
+      std::size_t n = 0;
+      for (const auto& t : my->tables) n += !t.second->rows.empty();
+      return n;
+   }
+
+   int64_t chain::ram_usage(name payer) const {
+      auto itr = my->ram.find(payer.value);
+      return itr == my->ram.end() ? 0 : itr->second;
+   }
+
+   int64_t chain::total_ram_usage() const {
+      int64_t total = 0;
+      for (const auto& r : my->ram) total += r.second;
+      return total;
+   }
+
+   const counters& chain::totals() const { return my->totals; }
+
+} // namespace host
+
+// Intrinsics
+
+using host::state;
+
+namespace eosio {
+   namespace internal_use_do_not_use {
+      extern "C" {
+
+      // Action
+
+      uint32_t read_action_data(void* msg, uint32_t len) {
+         const auto& data = state().context().act->data;
+         auto n = std::min<std::size_t>(len, data.size());
+         if (n) std::memcpy(msg, data.data(), n);
+         return (uint32_t)n;
+      }
+
+      uint32_t action_data_size() { return (uint32_t)state().context().act->data.size(); }
+
+      void require_recipient(uint64_t n) {
+         auto& c = state().context();
+         auto& rs = *c.receivers;
+         if (std::find(rs.begin(), rs.end(), eosio::name(n)) == rs.end()) {
+            rs.push_back(eosio::name(n));
+            c.cost.notifications++;
+         }
+      }
+
+      bool has_auth(uint64_t n) {
+         for (const auto& p : state().context().act->authorization) {
+            if (p.actor.value == n) return true;
+         }
+         return false;
+      }
+
+      void require_auth(uint64_t n) {
+         check(has_auth(n), "missing authority of " + eosio::name(n).to_string());
+      }
+
+      bool is_account(uint64_t n) { return state().accounts.count(n) > 0; }
+
+      void send_inline(char* serialized_action, std::size_t size) {
+         auto& c = state().context();
+         auto act = unpack<eosio::action>(serialized_action, size);
+         for (const auto& p : act.authorization) {
+            check(p.actor == c.receiver, "inline action '" + act.name.to_string() + "' requires authority of " +
+                                             p.actor.to_string() + " which " + c.receiver.to_string() +
+                                             " cannot satisfy");
+         }
+         c.inlines->push_back(std::move(act));
+         c.cost.inline_actions++;
+      }
+
+      uint64_t current_receiver() { return state().context().receiver.value; }
+
+      void set_action_return_value(void* return_value, std::size_t size) {
+         auto& c = state().context();
+         c.return_value.assign((const char*)return_value, (const char*)return_value + size);
+      }
+
+      uint64_t current_time() { return state().now_us; }
+
+      // Primary index
+
+      int32_t db_store_i64(uint64_t scope, uint64_t table, uint64_t payer, uint64_t id, const void* data, uint32_t len) {
+         auto& s = state();
+         auto& c = s.context();
+         check(payer != 0, "must specify a valid account to pay for new record");
+         auto& t = s.get_or_create_table(c.receiver.value, scope, table);
+         check(t.rows.find(id) == t.rows.end(), "could not insert object, most likely a uniqueness constraint was violated");
+         s.set_row(t, id, host::row{payer, std::vector<char>((const char*)data, (const char*)data + len)}, true);
+         c.cost.db_writes++;
+         c.cost.bytes_written += len;
+         return s.primary_iterator(t, id);
+      }
+
+      void db_update_i64(int32_t iterator, uint64_t payer, const void* data, uint32_t len) {
+         auto& s = state();
+         auto& c = s.context();
+         auto [t, id] = s.primary_at(iterator);
+         s.require_write_access(t->key);
+         auto itr = t->rows.find(id);
+         check(itr != t->rows.end(), "dereference of deleted object");
+         auto new_payer = payer ? payer : itr->second.payer;
+         s.set_row(*t, id, host::row{new_payer, std::vector<char>((const char*)data, (const char*)data + len)}, true);
+         c.cost.db_writes++;
+         c.cost.bytes_written += len;
+      }
+
+      void db_remove_i64(int32_t iterator) {
+         auto& s = state();
+         auto& c = s.context();
+         auto [t, id] = s.primary_at(iterator);
+         s.require_write_access(t->key);
+         check(t->rows.count(id) > 0, "dereference of deleted object");
+         s.set_row(*t, id, std::nullopt, true);
+         c.cost.db_writes++;
+      }
+
+      int32_t db_get_i64(int32_t iterator, const void* data, uint32_t len) {
+         auto& s = state();
+         auto& c = s.context();
+         auto [t, id] = s.primary_at(iterator);
+         auto itr = t->rows.find(id);
+         check(itr != t->rows.end(), "dereference of deleted object");
+         const auto& bytes = itr->second.data;
+         if (len == 0) return (int32_t)bytes.size();
+         auto n = std::min<std::size_t>(len, bytes.size());
+         std::memcpy(const_cast<void*>(data), bytes.data(), n);
+         c.cost.bytes_read += n;
+         return (int32_t)n;
+      }
+
+      int32_t db_next_i64(int32_t iterator, uint64_t* primary) {
+         auto& s = state();
+         auto& c = s.context();
+         if (iterator < -1) return -1;
+         auto [t, id] = s.primary_at(iterator);
+         c.cost.db_reads++;
+         auto itr = t->rows.upper_bound(id);
+         if (itr == t->rows.end()) return host::chain::impl::end_iterator(t->id);
+         *primary = itr->first;
+         return s.primary_iterator(*t, itr->first);
+      }
+
+      int32_t db_previous_i64(int32_t iterator, uint64_t* primary) {
+         auto& s = state();
+         auto& c = s.context();
+         c.cost.db_reads++;
+         if (iterator < -1) {
+            auto t = s.tables_by_id.at(-iterator - 2);
+            if (t->rows.empty()) return -1;
+            auto last = std::prev(t->rows.end());
+            *primary = last->first;
+            return s.primary_iterator(*t, last->first);
+         }
+         auto [t, id] = s.primary_at(iterator);
+         auto itr = t->rows.lower_bound(id);
+         if (itr == t->rows.begin()) return -1;
+         --itr;
+         *primary = itr->first;
+         return s.primary_iterator(*t, itr->first);
+      }
+
+      int32_t db_find_i64(uint64_t code, uint64_t scope, uint64_t table, uint64_t id) {
+         auto& s = state();
+         s.context().cost.db_reads++;
+         auto t = s.find_table(code, scope, table);
+         if (!t) return -1;
+         if (t->rows.find(id) == t->rows.end()) return host::chain::impl::end_iterator(t->id);
+         return s.primary_iterator(*t, id);
+      }
+
+      int32_t db_lowerbound_i64(uint64_t code, uint64_t scope, uint64_t table, uint64_t id) {
+         auto& s = state();
+         s.context().cost.db_reads++;
+         auto t = s.find_table(code, scope, table);
+         if (!t) return -1;
+         auto itr = t->rows.lower_bound(id);
+         if (itr == t->rows.end()) return host::chain::impl::end_iterator(t->id);
+         return s.primary_iterator(*t, itr->first);
+      }
+
+      int32_t db_upperbound_i64(uint64_t code, uint64_t scope, uint64_t table, uint64_t id) {
+         auto& s = state();
+         s.context().cost.db_reads++;
+         auto t = s.find_table(code, scope, table);
+         if (!t) return -1;
+         auto itr = t->rows.upper_bound(id);
+         if (itr == t->rows.end()) return host::chain::impl::end_iterator(t->id);
+         return s.primary_iterator(*t, itr->first);
+      }
+
+      int32_t db_end_i64(uint64_t code, uint64_t scope, uint64_t table) {
+         auto& s = state();
+         auto t = s.find_table(code, scope, table);
+         if (!t) return -1;
+         return host::chain::impl::end_iterator(t->id);
+      }
+      }
+   } // namespace internal_use_do_not_use
+} // namespace eosio
+
+// Secondary indices. idx64 and idx128 share one implementation; the key is
+// widened to 128 bits, which preserves ordering within a single index table.
+
+namespace {
+   using host::chain;
+   using index_state = chain::impl::index_state;
+
+   int32_t idx_store(uint64_t scope, uint64_t table, uint64_t payer, uint64_t id, uint128_t key) {
+      auto& s = state();
+      auto& c = s.context();
+      auto& i = s.get_or_create_index(c.receiver.value, scope, table);
+      eosio::check(i.by_primary.find(id) == i.by_primary.end(), "secondary index already holds this primary key");
+      s.set_secondary(i, id, host::secondary_row{key, payer}, true);
+      c.cost.db_writes++;
+      c.cost.bytes_written += sizeof(key);
+      return s.secondary_iterator(i, key, id);
+   }
+
+   void idx_update(int32_t iterator, uint64_t payer, uint128_t key) {
+      auto& s = state();
+      auto& c = s.context();
+      auto [i, old_key, id] = s.secondary_at(iterator);
+      s.require_write_access(i->key);
+      auto itr = i->by_primary.find(id);
+      eosio::check(itr != i->by_primary.end(), "dereference of deleted secondary object");
+      auto new_payer = payer ? payer : itr->second.payer;
+      s.set_secondary(*i, id, host::secondary_row{key, new_payer}, true);
+      s.secondary_iterator(*i, key, id);
+      c.cost.db_writes++;
+      c.cost.bytes_written += sizeof(key);
+   }
+
+   void idx_remove(int32_t iterator) {
+      auto& s = state();
+      auto& c = s.context();
+      auto [i, key, id] = s.secondary_at(iterator);
+      s.require_write_access(i->key);
+      s.set_secondary(*i, id, std::nullopt, true);
+      c.cost.db_writes++;
+   }
+
+   int32_t idx_next(int32_t iterator, uint64_t* primary) {
+      auto& s = state();
+      s.context().cost.db_reads++;
+      if (iterator < -1) return -1;
+      auto [i, key, id] = s.secondary_at(iterator);
+      auto itr = i->entries.upper_bound({key, id});
+      if (itr == i->entries.end()) return chain::impl::end_iterator(i->id);
+      *primary = itr->second;
+      return s.secondary_iterator(*i, itr->first, itr->second);
+   }
+
+   int32_t idx_previous(int32_t iterator, uint64_t* primary) {
+      auto& s = state();
+      s.context().cost.db_reads++;
+      if (iterator < -1) {
+         auto i = s.indices_by_id.at(-iterator - 2);
+         if (i->entries.empty()) return -1;
+         auto last = std::prev(i->entries.end());
+         *primary = last->second;
+         return s.secondary_iterator(*i, last->first, last->second);
+      }
+      auto [i, key, id] = s.secondary_at(iterator);
+      auto itr = i->entries.lower_bound({key, id});
+      if (itr == i->entries.begin()) return -1;
+      --itr;
+      *primary = itr->second;
+      return s.secondary_iterator(*i, itr->first, itr->second);
+   }
+
+   int32_t idx_find_primary(uint64_t code, uint64_t scope, uint64_t table, uint128_t* key, uint64_t primary) {
+      auto& s = state();
+      s.context().cost.db_reads++;
+      auto i = s.find_index(code, scope, table);
+      if (!i) return -1;
+      auto itr = i->by_primary.find(primary);
+      if (itr == i->by_primary.end()) return chain::impl::end_iterator(i->id);
+      *key = itr->second.key;
+      return s.secondary_iterator(*i, itr->second.key, primary);
+   }
+
+   int32_t idx_find_secondary(uint64_t code, uint64_t scope, uint64_t table, uint128_t key, uint64_t* primary) {
+      auto& s = state();
+      s.context().cost.db_reads++;
+      auto i = s.find_index(code, scope, table);
+      if (!i) return -1;
+      auto itr = i->entries.lower_bound({key, 0});
+      if (itr == i->entries.end() || itr->first != key) return chain::impl::end_iterator(i->id);
+      *primary = itr->second;
+      return s.secondary_iterator(*i, itr->first, itr->second);
+   }
+
+   int32_t idx_lowerbound(uint64_t code, uint64_t scope, uint64_t table, uint128_t* key, uint64_t* primary) {
+      auto& s = state();
+      s.context().cost.db_reads++;
+      auto i = s.find_index(code, scope, table);
+      if (!i) return -1;
+      auto itr = i->entries.lower_bound({*key, 0});
+      if (itr == i->entries.end()) return chain::impl::end_iterator(i->id);
+      *key = itr->first;
+      *primary = itr->second;
+      return s.secondary_iterator(*i, itr->first, itr->second);
+   }
+
+   int32_t idx_upperbound(uint64_t code, uint64_t scope, uint64_t table, uint128_t* key, uint64_t* primary) {
+      auto& s = state();
+      s.context().cost.db_reads++;
+      auto i = s.find_index(code, scope, table);
+      if (!i) return -1;
+      auto itr = i->entries.upper_bound({*key, std::numeric_limits<uint64_t>::max()});
+      if (itr == i->entries.end()) return chain::impl::end_iterator(i->id);
+      *key = itr->first;
+      *primary = itr->second;
+      return s.secondary_iterator(*i, itr->first, itr->second);
+   }
+
+   int32_t idx_end(uint64_t code, uint64_t scope, uint64_t table) {
+      auto i = state().find_index(code, scope, table);
+      return i ? chain::impl::end_iterator(i->id) : -1;
+   }
+} // namespace
+
+#define HOST_SECONDARY_INTRINSICS(IDX, TYPE)                                                              \
+   int32_t db_##IDX##_store(uint64_t scope, uint64_t table, uint64_t payer, uint64_t id, const TYPE* secondary) { \
+      return idx_store(scope, table, payer, id, *secondary);                                                \
+   }                                                                                                        \
+   void db_##IDX##_update(int32_t iterator, uint64_t payer, const TYPE* secondary) {                        \
+      idx_update(iterator, payer, *secondary);                                                              \
+   }                                                                                                        \
+   void db_##IDX##_remove(int32_t iterator) { idx_remove(iterator); }                                       \
+   int32_t db_##IDX##_next(int32_t iterator, uint64_t* primary) { return idx_next(iterator, primary); }     \
+   int32_t db_##IDX##_previous(int32_t iterator, uint64_t* primary) { return idx_previous(iterator, primary); } \
+   int32_t db_##IDX##_find_primary(uint64_t code, uint64_t scope, uint64_t table, TYPE* secondary,          \
+                                   uint64_t primary) {                                                      \
+      uint128_t key = 0;                                                                                    \
+      auto r = idx_find_primary(code, scope, table, &key, primary);                                         \
+      if (r >= 0) *secondary = (TYPE)key;                                                                   \
+      return r;                                                                                             \
+   }                                                                                                        \
+   int32_t db_##IDX##_find_secondary(uint64_t code, uint64_t scope, uint64_t table, const TYPE* secondary,  \
+                                     uint64_t* primary) {                                                   \
+      return idx_find_secondary(code, scope, table, *secondary, primary);                                   \
+   }                                                                                                        \
+   int32_t db_##IDX##_lowerbound(uint64_t code, uint64_t scope, uint64_t table, TYPE* secondary,            \
+                                 uint64_t* primary) {                                                       \
+      uint128_t key = *secondary;                                                                           \
+      auto r = idx_lowerbound(code, scope, table, &key, primary);                                           \
+      if (r >= 0) *secondary = (TYPE)key;                                                                   \
+      return r;                                                                                             \
+   }                                                                                                        \
+   int32_t db_##IDX##_upperbound(uint64_t code, uint64_t scope, uint64_t table, TYPE* secondary,            \
+                                 uint64_t* primary) {                                                       \
+      uint128_t key = *secondary;                                                                           \
+      auto r = idx_upperbound(code, scope, table, &key, primary);                                           \
+      if (r >= 0) *secondary = (TYPE)key;                                                                   \
+      return r;                                                                                             \
+   }                                                                                                        \
+   int32_t db_##IDX##_end(uint64_t code, uint64_t scope, uint64_t table) { return idx_end(code, scope, table); }
+
+namespace eosio {
+   namespace internal_use_do_not_use {
+      extern "C" {
+      HOST_SECONDARY_INTRINSICS(idx64, uint64_t)
+      HOST_SECONDARY_INTRINSICS(idx128, uint128_t)
+      }
+   } // namespace internal_use_do_not_use
+} // namespace eosio
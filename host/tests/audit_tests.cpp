@@ -0,0 +1,234 @@
+// host_audit against dumps of pools that ran on the native chain.
+#include <audit.hpp>
+#include <host/coral.hpp>
+#include <host/rows.hpp>
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+using namespace host;
+using eosio::asset;
+using eosio::symbol;
+using eosio::symbol_code;
+
+namespace {
+
+   std::string str(uint128_t v) {
+      std::string s;
+      do {
+         s.insert(s.begin(), char('0' + int(v % 10)));
+         v /= 10;
+      } while (v > 0);
+      return s;
+   }
+
+   struct dump {
+      std::string pools;
+      std::string miners;
+   };
+
+   // What a table dump of the pools contract would hold, in host_audit's format.
+   dump dump_tables(const chain& c, coral::version v) {
+      std::ostringstream pools, miners;
+      const name code = coral::pools;
+      const auto contract = code.to_string();
+      for (auto id : c.primary_keys(code, code.value, name("pools"))) {
+         if (v == coral::version::v1) {
+            auto p = *c.get_row<pool_v1_row>(code, code.value, name("pools"), id);
+            pools << contract << ",1,halving," << id << "," << p.total_staked.amount << "," << p.total_reward.amount << ","
+                  << p.released_reward.amount << "," << p.epoch_time << "," << p.duration << ","
+                  << p.last_harvest_time << ",0\n";
+            for (auto owner : c.primary_keys(code, id, name("miners"))) {
+               auto m = *c.get_row<miner_v1_row>(code, id, name("miners"), owner);
+               miners << contract << "," << id << "," << m.owner.to_string() << "," << m.staked.amount << ","
+                      << m.claimed.amount << "," << m.unclaimed.amount << ",0\n";
+            }
+         } else {
+            auto p = *c.get_row<pool_v2_row>(code, code.value, name("pools"), id);
+            // pools carried over from v1 keep halving, source REWARD_HALVING
+            auto schedule = p.rewards[0].source == 3 ? "halving" : "linear";
+            pools << contract << ",2," << schedule << "," << id << "," << p.total_staked.amount << "," << p.total_reward.amount << ","
+                  << p.released_reward.amount << "," << p.epoch_time << "," << p.duration << ","
+                  << p.last_harvest_time << "," << str(p.rewards[0].per_share);
+            for (std::size_t k = 1; k < p.rewards.size(); k++) {
+               pools << "," << p.rewards[k].released << "," << str(p.rewards[k].per_share);
+            }
+            pools << "\n";
+            for (auto owner : c.primary_keys(code, id, name("stakers"))) {
+               auto m = *c.get_row<staker_row>(code, id, name("stakers"), owner);
+               // tokens the miner hasn't settled since they were added
+               m.balances.resize(p.rewards.size());
+               miners << contract << "," << id << "," << m.owner.to_string() << "," << m.staked;
+               for (auto& b : m.balances) {
+                  miners << "," << b.claimed << "," << b.unclaimed << "," << str(b.debt);
+               }
+               miners << "\n";
+            }
+         }
+      }
+      return {pools.str(), miners.str()};
+   }
+
+   // adds `delta` to the field at `index` of a dump line
+   std::string bump_field(const std::string& line, std::size_t index, uint64_t delta) {
+      std::size_t begin = 0;
+      for (std::size_t i = 0; i < index; i++) begin = line.find(',', begin) + 1;
+      auto end = line.find(',', begin);
+      auto value = std::stoull(line.substr(begin, end - begin)) + delta;
+      return line.substr(0, begin) + std::to_string(value) + line.substr(end);
+   }
+
+   audit::result run_audit(const dump& d, unsigned threads = 2) {
+      std::istringstream pools(d.pools), miners(d.miners);
+      audit::options opts;
+      opts.threads = threads;
+      opts.block_rows = 1; // many small chunks, so rows of a pool land on different workers
+      return audit::run(audit::read_pools(pools), miners, opts);
+   }
+
+   std::string findings(const audit::result& r) {
+      std::ostringstream out;
+      audit::print_report(out, r);
+      return out.str();
+   }
+
+   const symbol partner_symbol("PTR", 4);
+
+   // Two pools with uneven stakes, a few harvests, claims and a withdrawal.
+   // On v2 the second pool also streams a partner token.
+   dump run_scenario(coral::version v) {
+      const symbol second_symbol("LPB", 4);
+      chain c;
+      coral::deploy(c, v);
+      coral::create_stake_symbol(c, second_symbol);
+      const asset reward(100000000000000, coral::crl_symbol);
+      coral::create_pool(c, v, reward, c.time(), 86400 * 4);
+      coral::create_pool(c, v, reward, c.time(), 86400 * 4, second_symbol);
+      if (v == coral::version::v2) {
+         const asset funding(500000000, partner_symbol);
+         coral::create_stake_symbol(c, partner_symbol);
+         c.push(coral::pools, name("addreward"), coral::manager, uint64_t(2),
+                eosio::extended_symbol(partner_symbol, coral::stake_token));
+         coral::fund(c, coral::manager, funding);
+         coral::stake(c, coral::manager, funding, "reward:2");
+      }
+
+      auto harvest = [&] {
+         c.push(coral::pools, name("harvestall"), coral::manager, std::vector<uint64_t>{1, 2}, uint32_t(1000));
+      };
+      for (uint32_t i = 0; i < 30; i++) {
+         auto miner = coral::miner_name(i);
+         coral::fund(c, miner, asset(4000000, coral::stake_symbol));
+         coral::fund(c, miner, asset(4000000, second_symbol));
+         coral::stake(c, miner, asset(1000000 + 7919 * i, coral::stake_symbol));
+         coral::stake(c, miner, asset(333333 * (1 + i % 5), second_symbol), "pool:2");
+      }
+      for (uint32_t round = 0; round < 4; round++) {
+         c.produce_blocks(3600 + 17 * round);
+         harvest();
+         auto miner = coral::miner_name(round * 3);
+         coral::stake(c, miner, asset(123457, coral::stake_symbol));
+         c.push(coral::pools, name("claim"), miner, miner, uint64_t(1));
+         miner = coral::miner_name(round * 3 + 1);
+         c.push(coral::pools, name("withdraw"), miner, miner, uint64_t(2));
+      }
+      c.produce_blocks(600);
+      harvest();
+      return dump_tables(c, v);
+   }
+
+   void expect_clean_and_catches_tampering(coral::version v) {
+      auto d = run_scenario(v);
+      for (unsigned threads : {1u, 3u}) {
+         auto r = run_audit(d, threads);
+         EXPECT_EQ(r.miner_rows, 60u - 4);
+         EXPECT_TRUE(r.discrepancies.empty()) << findings(r);
+      }
+
+      // a miner credited more than the pool released
+      auto tampered = d;
+      auto first = tampered.miners.substr(0, tampered.miners.find('\n'));
+      tampered.miners.replace(0, first.size(), bump_field(first, 5, 1000000000));
+      auto r = run_audit(tampered);
+      ASSERT_EQ(r.discrepancies.size(), 1u) << findings(r);
+      EXPECT_NE(r.discrepancies[0].what.find("miners are owed"), std::string::npos) << findings(r);
+
+      // a row lost from the dump shows up as a stake mismatch
+      tampered = d;
+      tampered.miners.erase(0, tampered.miners.find('\n') + 1);
+      r = run_audit(tampered);
+      ASSERT_EQ(r.discrepancies.size(), 1u) << findings(r);
+      EXPECT_NE(r.discrepancies[0].what.find("total_staked"), std::string::npos) << findings(r);
+   }
+
+} // namespace
+
+TEST(audit, pool_v1) { expect_clean_and_catches_tampering(coral::version::v1); }
+
+TEST(audit, pool_v2) { expect_clean_and_catches_tampering(coral::version::v2); }
+
+TEST(audit, pool_v2_reward_tokens) {
+   auto d = run_scenario(coral::version::v2);
+   auto r = run_audit(d);
+   ASSERT_EQ(r.pools.size(), 2u);
+   ASSERT_EQ(r.pools[1].rewards.size(), 2u);
+   EXPECT_GT(r.pools[1].rewards[1].released, 0u);
+   EXPECT_GT(r.totals[1].rewards[1].claimable, 0u);
+
+   // a miner of the second pool credited more of the partner token than it streamed
+   auto tampered = d;
+   auto begin = tampered.miners.find("\ncrlpool,2,") + 1;
+   auto line = tampered.miners.substr(begin, tampered.miners.find('\n', begin) - begin);
+   tampered.miners.replace(begin, line.size(), bump_field(line, 8, 1000000000));
+   r = run_audit(tampered);
+   ASSERT_EQ(r.discrepancies.size(), 1u) << findings(r);
+   EXPECT_NE(r.discrepancies[0].what.find("reward 1"), std::string::npos) << findings(r);
+}
+
+TEST(audit, pool_carried_over_from_v1) {
+   chain c;
+   coral::deploy(c, coral::version::v1);
+   coral::create_pool(c, coral::version::v1, asset(100000000000000, coral::crl_symbol), c.time(), 86400 * 4);
+   for (uint32_t i = 0; i < 5; i++) {
+      auto miner = coral::miner_name(i);
+      coral::fund(c, miner, asset(4000000, coral::stake_symbol));
+      coral::stake(c, miner, asset(1000000 + 7919 * i, coral::stake_symbol));
+   }
+   auto harvest = [&] {
+      c.produce_blocks(3600);
+      c.push(coral::pools, name("harvestall"), coral::manager, std::vector<uint64_t>{1}, uint32_t(100));
+   };
+   harvest();
+   c.set_code(coral::pools, coral::pool_code(coral::version::v2));
+   c.push(coral::pools, name("migrateall"), coral::manager, uint32_t(100));
+   harvest();
+
+   auto d = dump_tables(c, coral::version::v2);
+   auto r = run_audit(d);
+   ASSERT_EQ(r.pools.size(), 1u);
+   EXPECT_EQ(r.pools[0].schedule, audit::schedule::halving);
+   EXPECT_TRUE(r.discrepancies.empty()) << findings(r);
+
+   // the halving schedule is ahead of a linear one early on
+   auto tampered = d;
+   tampered.pools.replace(tampered.pools.find(",halving,"), 9, ",linear,");
+   r = run_audit(tampered);
+   ASSERT_EQ(r.discrepancies.size(), 1u) << findings(r);
+   EXPECT_NE(r.discrepancies[0].what.find("ahead of the schedule"), std::string::npos) << findings(r);
+}
+
+TEST(audit, debt_above_accrued) {
+   std::istringstream pools("crlpool,2,linear,1,100,1000,100,0,1000,100,1000000000000\n");
+   std::istringstream miners("crlpool,1,alice,100,0,0,101\n");
+   auto r = audit::run(audit::read_pools(pools), miners, audit::options());
+   ASSERT_EQ(r.discrepancies.size(), 1u) << findings(r);
+   EXPECT_EQ(r.discrepancies[0].owner, name("alice").value);
+}
+
+TEST(audit, rejects_bad_rows) {
+   std::istringstream pools("crlpool,1,halving,1,100,1000,0,0,1000,0,0\n");
+   std::istringstream miners("crlpool,1,alice,100,0,x,0\n");
+   EXPECT_THROW(audit::run(audit::read_pools(pools), miners, audit::options()), std::runtime_error);
+}
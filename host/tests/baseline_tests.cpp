@@ -0,0 +1,330 @@
+// The pools contracts upgraded over the state the deployed ones left behind.
+#include <host/box_lp.hpp>
+#include <host/coral.hpp>
+#include <host/rows.hpp>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace host;
+using eosio::asset;
+using eosio::symbol;
+using eosio::symbol_code;
+
+namespace {
+
+   const uint32_t miners = 4;
+   const symbol second_symbol("LPB", 4);
+   const asset reward(100000000000000, coral::crl_symbol);
+
+   // The deployed poolv2 an hour into a box pool (1) and a plain one (2),
+   // `miners` miners on each and a harvest of both, the BOX the lp contract
+   // collected by then claimed for the box pool. The harvest of the box pool
+   // stops after `limit` miners.
+   struct deployed_v2 {
+      chain c;
+
+      explicit deployed_v2(uint64_t box, uint32_t limit = miners) {
+         coral::deploy(c, coral::version::v2);
+         c.set_code(coral::pools, coral::baseline_code(coral::version::v2));
+         box_lp::deploy(c);
+         coral::create_stake_symbol(c, second_symbol);
+         c.push(coral::pools, name("create"), coral::manager, coral::stake_token, coral::stake_symbol, reward, c.time(),
+                uint32_t(86400 * 4), asset(1, coral::stake_symbol), uint8_t(1), symbol_code("LPA"));
+         coral::create_pool(c, coral::version::v2, reward, c.time(), 86400 * 4, second_symbol);
+         for (uint32_t i = 0; i < miners; i++) {
+            auto miner = coral::miner_name(i);
+            coral::fund(c, miner, asset(1000000, coral::stake_symbol));
+            coral::fund(c, miner, asset(1000000, second_symbol));
+            coral::stake(c, miner, asset(100000 + 37813 * i, coral::stake_symbol));
+            coral::stake(c, miner, asset(200000 + 7919 * i, second_symbol));
+         }
+         c.produce_blocks(3600);
+         if (box > 0) {
+            box_lp::accrue(c, coral::pools, box);
+         }
+         c.push(coral::pools, name("harvest"), coral::manager, uint64_t(1), uint64_t(1), limit);
+         c.push(coral::pools, name("harvest"), coral::manager, uint64_t(2), uint64_t(1), miners);
+      }
+
+      pool_v2_baseline_row baseline_pool(uint64_t id) const {
+         return *c.get_row<pool_v2_baseline_row>(coral::pools, coral::pools.value, name("pools"), id);
+      }
+
+      pool_v2_row pool(uint64_t id) const {
+         return *c.get_row<pool_v2_row>(coral::pools, coral::pools.value, name("pools"), id);
+      }
+
+      void upgrade() { c.set_code(coral::pools, coral::pool_code(coral::version::v2)); }
+
+      // Runs both pools another hour on the current contract and claims
+      // everything. Returns the CRL and BOX every miner ends up with.
+      std::vector<int64_t> claim_all() {
+         c.produce_blocks(3600);
+         box_lp::accrue(c, coral::pools, 300000);
+         c.push(coral::pools, name("harvestall"), coral::manager, std::vector<uint64_t>{1, 2}, uint32_t(100));
+         c.push(coral::pools, name("syncbox"), coral::manager, std::vector<uint64_t>{1});
+         std::vector<int64_t> balances;
+         for (uint32_t i = 0; i < miners; i++) {
+            auto miner = coral::miner_name(i);
+            c.push(coral::pools, name("claimall"), miner, miner, std::vector<uint64_t>{1, 2});
+            balances.push_back(coral::balance(c, coral::crl_token, miner, coral::crl_symbol));
+            balances.push_back(coral::balance(c, box_lp::box_token, miner, box_lp::box_symbol));
+         }
+         return balances;
+      }
+   };
+
+} // namespace
+
+TEST(baseline, pool_v2_rows_keep_their_totals) {
+   for (uint64_t box : {0, 1000000}) {
+      deployed_v2 d(box);
+      auto before = d.baseline_pool(1);
+      EXPECT_EQ(before.box_reward.amount, int64_t(box - box / 10));
+      d.upgrade();
+
+      d.c.produce_blocks(3600);
+      d.c.push(coral::pools, name("harvestall"), coral::manager, std::vector<uint64_t>{1, 2}, uint32_t(100));
+      auto p = d.pool(1);
+      ASSERT_EQ(p.rewards.size(), 2u);
+      EXPECT_EQ(p.rewards[0].source, 0);
+      EXPECT_GT(p.released_reward, before.released_reward);
+      EXPECT_EQ(p.rewards[0].released, uint64_t(p.released_reward.amount));
+      EXPECT_EQ(p.rewards[1].token, eosio::extended_symbol(box_lp::box_symbol, box_lp::box_token));
+      EXPECT_EQ(p.rewards[1].released, uint64_t(before.box_reward.amount));
+      EXPECT_EQ(d.pool(2).rewards.size(), 1u);
+
+      // BOX keeps coming in on top of what the deployed contract received
+      box_lp::accrue(d.c, coral::pools, 500000);
+      d.c.push(coral::pools, name("syncbox"), coral::manager, std::vector<uint64_t>{1});
+      auto released = d.pool(1).rewards[1].released - before.box_reward.amount;
+      EXPECT_LE(released, 450000u);
+      EXPECT_GE(released, 450000u - miners);
+
+      // the plain pool reads as having released CRL already
+      try {
+         d.c.push(coral::pools, name("setmerkle"), coral::manager, uint64_t(2));
+         ADD_FAILURE() << "setmerkle accepted a pool that released CRL";
+      } catch (const eosio::eosio_assert_exception& e) {
+         EXPECT_STREQ(e.what(), "Pool already released CRL");
+      }
+   }
+}
+
+TEST(baseline, pool_v2_round_in_flight_is_finished) {
+   const uint64_t box = 1000000;
+   deployed_v2 full(box);
+   full.upgrade();
+   full.c.push(coral::pools, name("migrateall"), coral::manager, uint32_t(100));
+   auto expected = full.claim_all();
+
+   // the deployed harvest credited the first miner only
+   deployed_v2 d(box, 1);
+   d.upgrade();
+   EXPECT_EQ(d.c.row_count(coral::pools, coral::pools.value, name("rounds")), 2u);
+   auto miner = coral::miner_name(miners - 1);
+   EXPECT_EQ(error_of([&] { d.c.push(coral::pools, name("withdraw"), miner, miner, uint64_t(1)); }),
+             "Harvesting, please wait");
+   EXPECT_EQ(error_of([&] { coral::stake(d.c, miner, asset(1000, coral::stake_symbol), "pool:1"); }),
+             "Harvesting, please wait");
+   // claims go on, what is owed comes later
+   miner = coral::miner_name(0);
+   d.c.push(coral::pools, name("claim"), miner, miner, uint64_t(1));
+
+   // one miner a call, the round is dropped with its last one
+   for (uint32_t i = 1; i < miners; i++) {
+      d.c.push(coral::pools, name("migrate"), coral::manager, uint64_t(1), uint32_t(1));
+      EXPECT_EQ(d.c.row_count(coral::pools, coral::pools.value, name("rounds")), i + 1 < miners ? 2u : 1u);
+   }
+   // the miners it credited were converted on the way
+   EXPECT_EQ(d.c.row_count(coral::pools, 1, name("miners")), 0u);
+   EXPECT_THROW(d.c.push(coral::pools, name("migrate"), coral::manager, uint64_t(1), uint32_t(1)),
+                eosio::eosio_assert_exception);
+   d.c.push(coral::pools, name("migrateall"), coral::manager, uint32_t(100));
+   EXPECT_EQ(d.c.row_count(coral::pools, coral::pools.value, name("rounds")), 0u);
+
+   auto balances = d.claim_all();
+   ASSERT_EQ(balances.size(), expected.size());
+   for (std::size_t i = 0; i < balances.size(); i++) {
+      // the deployed contract split each round in floating point
+      EXPECT_NEAR(balances[i], expected[i], 2) << i;
+   }
+   coral::stake(d.c, coral::miner_name(miners - 1), asset(1000, coral::stake_symbol), "pool:1");
+}
+
+TEST(baseline, pool_v2_harvestall_finishes_the_round) {
+   const uint64_t box = 1000000;
+   deployed_v2 full(box);
+   full.upgrade();
+   auto expected = full.claim_all();
+
+   deployed_v2 d(box, 1);
+   d.upgrade();
+   // the round goes ahead of the harvest on the same budget, two miners
+   // are left of it after the first call
+   d.c.push(coral::pools, name("harvestall"), coral::manager, std::vector<uint64_t>{1, 2}, uint32_t(2));
+   EXPECT_EQ(d.c.row_count(coral::pools, coral::pools.value, name("rounds")), 2u);
+   auto miner = coral::miner_name(miners - 1);
+   EXPECT_EQ(error_of([&] { d.c.push(coral::pools, name("withdraw"), miner, miner, uint64_t(1)); }),
+             "Harvesting, please wait");
+   d.c.push(coral::pools, name("harvestall"), coral::manager, std::vector<uint64_t>{1, 2}, uint32_t(2));
+   EXPECT_EQ(d.c.row_count(coral::pools, coral::pools.value, name("rounds")), 1u);
+   coral::stake(d.c, miner, asset(1000, coral::stake_symbol), "pool:1");
+   d.c.push(coral::pools, name("withdraw"), miner, miner, uint64_t(1));
+
+   // the rest is picked up by the harvests of claim_all
+   deployed_v2 e(box, 1);
+   e.upgrade();
+   auto balances = e.claim_all();
+   EXPECT_EQ(e.c.row_count(coral::pools, coral::pools.value, name("rounds")), 0u);
+   ASSERT_EQ(balances.size(), expected.size());
+   for (std::size_t i = 0; i < balances.size(); i++) {
+      EXPECT_NEAR(balances[i], expected[i], 2) << i;
+   }
+}
+
+TEST(baseline, pool_v2_miners_migrate) {
+   deployed_v2 d(1000000);
+   std::vector<miner_v2_baseline_row> before;
+   for (uint64_t pool_id : {1, 2}) {
+      for (auto owner : d.c.primary_keys(coral::pools, pool_id, name("miners"))) {
+         before.push_back(*d.c.get_row<miner_v2_baseline_row>(coral::pools, pool_id, name("miners"), owner));
+      }
+   }
+   ASSERT_EQ(before.size(), miners * 2);
+   d.upgrade();
+
+   // a row a call on the box pool, its completed round first, then the rest
+   // of the contract at once
+   d.c.push(coral::pools, name("migrate"), coral::manager, uint64_t(1), uint32_t(1));
+   EXPECT_EQ(d.c.row_count(coral::pools, coral::pools.value, name("rounds")), 1u);
+   for (uint32_t i = 0; i < miners; i++) {
+      d.c.push(coral::pools, name("migrate"), coral::manager, uint64_t(1), uint32_t(1));
+      EXPECT_EQ(d.c.row_count(coral::pools, 1, name("stakers")), i + 1);
+   }
+   d.c.push(coral::pools, name("migrateall"), coral::manager, uint32_t(100));
+   for (uint64_t pool_id : {1, 2}) {
+      EXPECT_EQ(d.c.row_count(coral::pools, pool_id, name("miners")), 0u);
+   }
+   EXPECT_EQ(d.c.row_count(coral::pools, coral::pools.value, name("rounds")), 0u);
+
+   for (std::size_t i = 0; i < before.size(); i++) {
+      auto& m = before[i];
+      uint64_t pool_id = i < miners ? 1 : 2;
+      auto s = *d.c.get_row<staker_row>(coral::pools, pool_id, name("stakers"), m.owner.value);
+      EXPECT_EQ(s.staked, uint64_t(m.staked.amount));
+      ASSERT_EQ(s.balances.size(), pool_id == 1 ? 2u : 1u);
+      EXPECT_EQ(s.balances[0].unclaimed, uint64_t(m.unclaimed_crl.amount));
+      EXPECT_GT(s.balances[0].unclaimed, 0u);
+      EXPECT_EQ(s.balances[0].debt, 0u);
+      if (pool_id == 1) {
+         EXPECT_EQ(s.balances[1].unclaimed, uint64_t(m.unclaimed_box.amount));
+         EXPECT_GT(s.balances[1].unclaimed, 0u);
+      }
+   }
+}
+
+TEST(baseline, pools_of_the_deployed_v1_are_found_by_token) {
+   const symbol symbols[] = {coral::stake_symbol, second_symbol, symbol("LPC", 4)};
+   for (auto v : {coral::version::v1, coral::version::v2}) {
+      chain c;
+      coral::deploy(c, v);
+      c.set_code(coral::pools, coral::baseline_code(coral::version::v1));
+      for (auto& sym : symbols) {
+         if (sym != coral::stake_symbol) {
+            coral::create_stake_symbol(c, sym);
+         }
+         coral::create_pool(c, coral::version::v1, reward, c.time(), 86400 * 4, sym);
+      }
+      auto miner = coral::miner_name(0);
+      coral::fund(c, miner, asset(1000000, symbols[2]));
+      coral::stake(c, miner, asset(1000, symbols[2]));
+      c.set_code(coral::pools, coral::pool_code(v));
+
+      // none of them is in the tokenkey index until indexall lists them, a
+      // call a row at a time
+      EXPECT_EQ(error_of([&] { coral::stake(c, miner, asset(1000, symbols[2])); }), "Pool not found");
+      c.push(coral::pools, name("indexall"), coral::manager, uint32_t(1));
+      EXPECT_EQ(error_of([&] { coral::stake(c, miner, asset(1000, symbols[2])); }), "Pool not found");
+      while (c.get_row<posindex_row>(coral::pools, coral::pools.value, name("posindex"), name("posindex").value)->pool_id <= 3) {
+         c.push(coral::pools, name("indexall"), coral::manager, uint32_t(1));
+      }
+      coral::stake(c, miner, asset(1000, symbols[2]));
+      auto staked = c.get_row<pool_head_row>(coral::pools, coral::pools.value, name("pools"), 3)->total_staked;
+      EXPECT_EQ(staked, asset(2000, symbols[2]));
+
+      EXPECT_EQ(error_of([&] { coral::create_pool(c, v, reward, c.time(), 86400 * 4, symbols[2]); }), "Token exists");
+      EXPECT_EQ(error_of([&] { coral::create_pool(c, v, reward, c.time(), 86400 * 4, symbols[0]); }), "Token exists");
+   }
+}
+
+TEST(baseline, pool_v2_cleanup_drops_the_rounds) {
+   deployed_v2 d(1000000, 1);
+   d.upgrade();
+   d.c.produce_blocks(86400 * 4);
+
+   // the round in flight is paid out a few miners a call before the pool goes
+   while (d.c.get_row<pool_head_row>(coral::pools, coral::pools.value, name("pools"), 1)) {
+      d.c.push(coral::pools, name("cleanup"), coral::manager, uint64_t(1), uint32_t(2));
+   }
+   EXPECT_EQ(d.c.row_count(coral::pools, coral::pools.value, name("rounds")), 1u);
+   d.c.push(coral::pools, name("cleanup"), coral::manager, uint64_t(2), uint32_t(100));
+   EXPECT_EQ(d.c.row_count(coral::pools, coral::pools.value, name("rounds")), 0u);
+   EXPECT_EQ(d.c.row_count(coral::pools, coral::pools.value, name("pools")), 0u);
+   for (uint64_t pool_id : {1, 2}) {
+      EXPECT_EQ(d.c.row_count(coral::pools, pool_id, name("miners")), 0u);
+      EXPECT_EQ(d.c.row_count(coral::pools, pool_id, name("stakers")), 0u);
+   }
+   for (uint32_t i = 0; i < miners; i++) {
+      auto miner = coral::miner_name(i);
+      EXPECT_EQ(coral::balance(d.c, coral::stake_token, miner, coral::stake_symbol), 1000000);
+      EXPECT_GT(coral::balance(d.c, box_lp::box_token, miner, box_lp::box_symbol), 0);
+   }
+}
+
+TEST(baseline, registry_and_counts_pick_up_the_deployed_pools) {
+   for (auto v : {coral::version::v1, coral::version::v2}) {
+      chain c;
+      coral::deploy(c, v);
+      c.set_code(coral::pools, coral::baseline_code(v));
+      coral::create_stake_symbol(c, second_symbol);
+      coral::create_pool(c, v, reward, c.time(), 86400 * 4);
+      coral::create_pool(c, v, reward, c.time(), 86400 * 4, second_symbol);
+      for (uint32_t i = 0; i < miners; i++) {
+         auto miner = coral::miner_name(i);
+         auto sym = i < 3 ? coral::stake_symbol : second_symbol;
+         coral::fund(c, miner, asset(1000000, sym));
+         coral::stake(c, miner, asset(100000 + 37813 * i, sym), i < 3 ? "pool:1" : "pool:2");
+      }
+      c.set_code(coral::pools, coral::pool_code(v));
+      auto registry = [&] {
+         return *c.get_row<registry_row>(coral::pools, coral::pools.value, name("registry"), name("registry").value);
+      };
+      auto counts = [&] {
+         return *c.get_row<contract_row>(coral::pools, coral::pools.value, name("contracts"), coral::stake_token.value);
+      };
+
+      // the first harvest seeds the registry from the pools it is about to change
+      c.produce_blocks(3600);
+      c.push(coral::pools, name("harvestall"), coral::manager, std::vector<uint64_t>{1, 2}, uint32_t(100));
+      auto supply = *c.get_row<asset>(coral::crl_token, coral::crl_symbol.code().raw(), name("stat"),
+                                      coral::crl_symbol.code().raw());
+      EXPECT_GT(supply.amount, 0);
+      EXPECT_EQ(registry().released_reward, supply);
+      EXPECT_EQ(registry().committed_reward, reward + reward);
+      EXPECT_EQ(registry().active_pools, 2u);
+      EXPECT_EQ(counts().pools, 2u);
+
+      // older miners are counted as their positions are added, once
+      EXPECT_EQ(counts().miners, 0u);
+      coral::stake(c, coral::miner_name(0), asset(1000, coral::stake_symbol), "pool:1");
+      EXPECT_EQ(counts().miners, 1u);
+      c.push(coral::pools, name("indexall"), coral::manager, uint32_t(100));
+      EXPECT_EQ(counts().miners, miners);
+      c.push(coral::pools, name("withdraw"), coral::miner_name(1), coral::miner_name(1), uint64_t(1));
+      EXPECT_EQ(counts().miners, miners - 1);
+   }
+}
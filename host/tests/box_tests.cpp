@@ -0,0 +1,82 @@
+// BOX the lp contract collects for poolv2, claimed by syncbox.
+#include <host/box_lp.hpp>
+#include <host/coral.hpp>
+#include <host/rows.hpp>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace host;
+using eosio::asset;
+using eosio::symbol;
+using eosio::symbol_code;
+
+namespace {
+
+   const symbol second_symbol("LPB", 4);
+
+   // Two box pools, the second with three times the stake of the first.
+   struct box_pools {
+      chain c;
+
+      box_pools() {
+         coral::deploy(c, coral::version::v2);
+         box_lp::deploy(c);
+         coral::create_stake_symbol(c, second_symbol);
+         for (auto& sym : {coral::stake_symbol, second_symbol}) {
+            c.push(coral::pools, name("create"), coral::manager, coral::stake_token, sym,
+                   asset(100000000000000, coral::crl_symbol), c.time(), uint32_t(86400 * 4), asset(1, sym), uint8_t(1),
+                   symbol_code("LPA"));
+         }
+         auto miner = coral::miner_name(0);
+         coral::fund(c, miner, asset(1000000, coral::stake_symbol));
+         coral::fund(c, miner, asset(1000000, second_symbol));
+         coral::stake(c, miner, asset(100000, coral::stake_symbol));
+         coral::stake(c, miner, asset(300000, second_symbol));
+      }
+
+      uint64_t box_total(uint64_t pool_id) const {
+         return c.get_row<poolstat_row>(coral::pools, coral::pools.value, name("poolstats"), pool_id)->box_total;
+      }
+
+      void sync() { c.push(coral::pools, name("syncbox"), coral::manager, std::vector<uint64_t>{1, 2}); }
+   };
+
+} // namespace
+
+TEST(box, sync_credits_one_pool_a_claim) {
+   box_pools p;
+   // what the deployed harvest left goes to the first pool
+   box_lp::accrue(p.c, coral::pools, 1000001);
+   p.sync();
+   EXPECT_EQ(box_lp::unclaimed(p.c, coral::pools), 0u);
+   EXPECT_EQ(coral::balance(p.c, box_lp::box_token, box_lp::fees, box_lp::box_symbol), 100000);
+   EXPECT_EQ(p.box_total(1), 900001u);
+   EXPECT_EQ(p.box_total(2), 0u);
+
+   // then the pair of the second pool was updated, the next claim is its own
+   box_lp::accrue(p.c, coral::pools, 500000);
+   p.sync();
+   EXPECT_EQ(p.box_total(1), 900001u);
+   EXPECT_EQ(p.box_total(2), 450000u);
+   // and the list starts over
+   box_lp::accrue(p.c, coral::pools, 100);
+   p.sync();
+   EXPECT_EQ(p.box_total(1), 900091u);
+   EXPECT_EQ(p.box_total(2), 450000u);
+}
+
+TEST(box, sync_claims_above_the_minimum) {
+   box_pools p;
+   p.c.push(coral::pools, name("setboxsync"), coral::manager, uint64_t(10), uint32_t(0));
+   box_lp::accrue(p.c, coral::pools, 10);
+   p.sync();
+   EXPECT_EQ(box_lp::unclaimed(p.c, coral::pools), 10u);
+   box_lp::accrue(p.c, coral::pools, 1);
+   p.sync();
+   EXPECT_EQ(box_lp::unclaimed(p.c, coral::pools), 0u);
+   // the pool kept its pair updated until the claim
+   EXPECT_EQ(p.box_total(1), 10u);
+   EXPECT_EQ(p.box_total(2), 0u);
+}
@@ -0,0 +1,154 @@
+// Per-action database and inline-action budgets.
+//
+// Each scenario runs the contracts natively and compares what every action
+// cost against budgets.txt, so a change that makes an action read, write or
+// send more than it used to fails here instead of on chain. Run with
+// CORAL_PRINT_BUDGETS=1 to print the measured values in the file's format.
+#include <host/coral.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace host;
+using eosio::asset;
+using eosio::symbol;
+
+namespace {
+
+   struct budget {
+      uint64_t db_reads;
+      uint64_t db_writes;
+      uint64_t bytes_read;
+      uint64_t bytes_written;
+      uint64_t inline_actions;
+   };
+
+   std::map<std::string, budget> load_budgets() {
+      std::map<std::string, budget> result;
+      std::ifstream in(BUDGETS_FILE);
+      std::string line;
+      while (std::getline(in, line)) {
+         if (line.empty() || line[0] == '#') continue;
+         std::istringstream fields(line);
+         std::string key;
+         budget b;
+         if (fields >> key >> b.db_reads >> b.db_writes >> b.bytes_read >> b.bytes_written >> b.inline_actions) {
+            result[key] = b;
+         }
+      }
+      return result;
+   }
+
+   const std::map<std::string, budget>& budgets() {
+      static const auto b = load_budgets();
+      return b;
+   }
+
+   void check_budget(const std::string& key, const counters& cost) {
+      if (std::getenv("CORAL_PRINT_BUDGETS")) {
+         std::printf("%-20s %8llu %8llu %8llu %8llu %4llu\n", key.c_str(), (unsigned long long)cost.db_reads,
+                     (unsigned long long)cost.db_writes, (unsigned long long)cost.bytes_read,
+                     (unsigned long long)cost.bytes_written, (unsigned long long)cost.inline_actions);
+      }
+      auto itr = budgets().find(key);
+      ASSERT_NE(itr, budgets().end()) << "no budget for " << key;
+      const auto& b = itr->second;
+      EXPECT_LE(cost.db_reads, b.db_reads) << key << " reads more rows";
+      EXPECT_LE(cost.db_writes, b.db_writes) << key << " writes more rows";
+      EXPECT_LE(cost.bytes_read, b.bytes_read) << key << " reads more bytes";
+      EXPECT_LE(cost.bytes_written, b.bytes_written) << key << " writes more bytes";
+      EXPECT_LE(cost.inline_actions, b.inline_actions) << key << " sends more inline actions";
+   }
+
+   constexpr uint32_t miners = 10;
+   const symbol second_symbol("LPB", 4);
+
+   // Two pools with `miners` miners staked in both, an hour into mining.
+   void run_pool_scenario(coral::version v) {
+      const std::string prefix = v == coral::version::v1 ? "pool_v1." : "pool_v2.";
+      const name pools = coral::pools;
+      chain c;
+      coral::deploy(c, v);
+      coral::create_stake_symbol(c, second_symbol);
+
+      const asset reward(100000000000000, coral::crl_symbol);
+      coral::create_pool(c, v, reward, c.time(), 86400 * 4);
+      auto trace = coral::create_pool(c, v, reward, c.time(), 86400 * 4, second_symbol);
+      check_budget(prefix + "create", trace.cost_of(pools, name("create")));
+
+      for (uint32_t i = 0; i < miners; i++) {
+         auto miner = coral::miner_name(i);
+         coral::fund(c, miner, asset(2000000, coral::stake_symbol));
+         coral::fund(c, miner, asset(1000000, second_symbol));
+         trace = coral::stake(c, miner, asset(1000000, coral::stake_symbol));
+         coral::stake(c, miner, asset(1000000, second_symbol), "pool:2");
+      }
+      check_budget(prefix + "stake_new", trace.cost_of(pools, name("transfer")));
+
+      c.produce_blocks(3600);
+      if (v == coral::version::v1) {
+         trace = c.push(pools, name("harvest"), coral::manager, uint64_t(1), uint32_t(0));
+      } else {
+         trace = c.push(pools, name("harvest"), coral::manager, uint64_t(1));
+      }
+      check_budget(prefix + "harvest", trace.cost_of(pools, name("harvest")));
+
+      trace = coral::stake(c, coral::miner_name(0), asset(1000000, coral::stake_symbol));
+      check_budget(prefix + "stake_more", trace.cost_of(pools, name("transfer")));
+
+      c.produce_blocks(3600);
+      trace = c.push(pools, name("harvestall"), coral::manager, std::vector<uint64_t>{1, 2}, uint32_t(1000));
+      check_budget(prefix + "harvestall", trace.cost_of(pools, name("harvestall")));
+
+      auto miner = coral::miner_name(1);
+      trace = c.push(pools, name("claim"), miner, miner, uint64_t(1));
+      check_budget(prefix + "claim", trace.cost_of(pools, name("claim")));
+
+      miner = coral::miner_name(2);
+      trace = c.push(pools, name("claimall"), miner, miner, std::vector<uint64_t>{1, 2});
+      check_budget(prefix + "claimall", trace.cost_of(pools, name("claimall")));
+
+      miner = coral::miner_name(3);
+      trace = c.push(pools, name("withdraw"), miner, miner, uint64_t(1));
+      check_budget(prefix + "withdraw", trace.cost_of(pools, name("withdraw")));
+
+      miner = coral::miner_name(4);
+      trace = c.push(pools, name("getpending"), miner, miner, std::vector<uint64_t>{1, 2});
+      check_budget(prefix + "getpending", trace.cost_of(pools, name("getpending")));
+      trace = c.push(pools, name("getpools"), miner, uint64_t(0), uint32_t(10));
+      check_budget(prefix + "getpools", trace.cost_of(pools, name("getpools")));
+   }
+
+} // namespace
+
+TEST(budget, pool_v1) { run_pool_scenario(coral::version::v1); }
+
+TEST(budget, pool_v2) { run_pool_scenario(coral::version::v2); }
+
+TEST(budget, token) {
+   chain c;
+   coral::deploy(c, coral::version::v1);
+   const name token = coral::stake_token;
+   auto from = coral::miner_name(0);
+   coral::fund(c, from, asset(100000000, coral::stake_symbol));
+
+   std::vector<coral::transfer_entry> entries;
+   for (uint32_t i = 1; i <= miners; i++) {
+      c.create_account(coral::miner_name(i));
+      entries.push_back({coral::miner_name(i), asset(10000, coral::stake_symbol), "payout"});
+   }
+
+   auto trace = c.push(token, name("transfer"), from, from, coral::miner_name(1), asset(10000, coral::stake_symbol),
+                       std::string("payout"));
+   check_budget("token.transfer", trace.cost_of(token, name("transfer")));
+
+   trace = c.push(token, name("transfers"), from, from, entries);
+   check_budget("token.transfers", trace.cost_of(token, name("transfers")));
+}
@@ -0,0 +1,45 @@
+#include <host/coral.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace host;
+using eosio::asset;
+
+TEST(chain, failed_transaction_rolls_back) {
+   chain c;
+   coral::deploy(c, coral::version::v1);
+   auto alice = coral::miner_name(0);
+   coral::fund(c, alice, asset(1000000, coral::stake_symbol));
+   auto before = c.total_ram_usage();
+
+   // no pool exists for the transfer, the pools contract rejects the notification
+   EXPECT_THROW(coral::stake(c, alice, asset(10000, coral::stake_symbol)), eosio::eosio_assert_exception);
+   EXPECT_EQ(coral::balance(c, coral::stake_token, alice, coral::stake_symbol), 1000000);
+   EXPECT_EQ(coral::balance(c, coral::stake_token, coral::pools, coral::stake_symbol), 0);
+   EXPECT_EQ(c.total_ram_usage(), before);
+}
+
+TEST(chain, notifications_and_inline_actions_are_counted) {
+   chain c;
+   coral::deploy(c, coral::version::v1);
+   coral::create_pool(c, coral::version::v1, asset(100000000000000, coral::crl_symbol), c.time(), 86400 * 4);
+   auto alice = coral::miner_name(0);
+   coral::fund(c, alice, asset(1000000, coral::stake_symbol));
+
+   auto trace = coral::stake(c, alice, asset(10000, coral::stake_symbol));
+   auto transfer = trace.cost_of(coral::stake_token, name("transfer"));
+   EXPECT_EQ(transfer.notifications, 2u);
+   EXPECT_GT(trace.cost_of(coral::pools, name("transfer")).db_writes, 0u);
+
+   c.produce_blocks(3600);
+   auto harvest = c.push(coral::pools, name("harvest"), coral::manager, uint64_t(1), uint32_t(0));
+   // the CRL issue and the event log
+   EXPECT_EQ(harvest.cost_of(coral::pools, name("harvest")).inline_actions, 2u);
+   EXPECT_GT(coral::balance(c, coral::crl_token, coral::pools, coral::crl_symbol), 0);
+}
+
+TEST(chain, miner_names_are_distinct) {
+   EXPECT_NE(coral::miner_name(0), coral::miner_name(31));
+   EXPECT_NE(coral::miner_name(30), coral::miner_name(31 * 31));
+   EXPECT_EQ(coral::miner_name(123456), coral::miner_name(123456));
+}
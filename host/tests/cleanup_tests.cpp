@@ -0,0 +1,143 @@
+// Pools that are over, wound down by cleanup a few miners a call.
+#include <host/coral.hpp>
+#include <host/rows.hpp>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace host;
+using eosio::asset;
+using eosio::symbol;
+
+namespace {
+
+   const asset reward(100000000000000, coral::crl_symbol);
+   const uint32_t duration = 86400 * 4;
+   const int64_t funds = 1000000;
+
+   // A pool of `miners` miners with unequal stakes, harvested a day in and
+   // then left until well past its end.
+   struct ended_pool {
+      chain c;
+      uint32_t miners;
+
+      ended_pool(coral::version v, uint32_t miners) : miners(miners) {
+         coral::deploy(c, v);
+         coral::create_pool(c, v, reward, c.time(), duration);
+         for (uint32_t i = 0; i < miners; i++) {
+            auto miner = coral::miner_name(i);
+            coral::fund(c, miner, asset(funds, coral::stake_symbol));
+            coral::stake(c, miner, asset(stake_of(i), coral::stake_symbol));
+         }
+         c.produce_blocks(86400);
+         c.push(coral::pools, name("harvestall"), coral::manager, std::vector<uint64_t>{1}, uint32_t(100));
+         c.produce_blocks(duration);
+      }
+
+      static int64_t stake_of(uint32_t i) { return 100000 + 37813 * i; }
+
+      transaction_trace cleanup(uint32_t limit) {
+         return c.push(coral::pools, name("cleanup"), coral::manager, uint64_t(1), limit);
+      }
+
+      registry_row registry() const {
+         return *c.get_row<registry_row>(coral::pools, coral::pools.value, name("registry"), name("registry").value);
+      }
+   };
+
+} // namespace
+
+TEST(cleanup, pays_out_and_drops_the_pool) {
+   for (auto v : {coral::version::v1, coral::version::v2}) {
+      ended_pool p(v, 7);
+      auto committed = p.registry().committed_reward;
+
+      // two miners a call, the pool goes with the last of them
+      for (uint32_t left = p.miners; left > 0; left -= std::min(left, 2u)) {
+         EXPECT_EQ(p.c.row_count(coral::pools, coral::pools.value, name("pools")), 1u);
+         p.cleanup(2);
+         EXPECT_EQ(p.c.row_count(coral::pools, 1, name(v == coral::version::v1 ? "miners" : "stakers")),
+                   left - std::min(left, 2u));
+      }
+      EXPECT_EQ(p.c.row_count(coral::pools, coral::pools.value, name("pools")), 0u);
+      EXPECT_EQ(p.c.row_count(coral::pools, coral::pools.value, name("poolstats")), 0u);
+      EXPECT_THROW(p.cleanup(2), eosio::eosio_assert_exception);
+
+      // every miner has its stake back and its share of the whole schedule
+      int64_t total_stake = 0;
+      for (uint32_t i = 0; i < p.miners; i++) {
+         total_stake += ended_pool::stake_of(i);
+      }
+      auto supply = *p.c.get_row<asset>(coral::crl_token, coral::crl_symbol.code().raw(), name("stat"),
+                                        coral::crl_symbol.code().raw());
+      int64_t paid = 0;
+      for (uint32_t i = 0; i < p.miners; i++) {
+         auto miner = coral::miner_name(i);
+         EXPECT_EQ(coral::balance(p.c, coral::stake_token, miner, coral::stake_symbol), funds);
+         auto crl = coral::balance(p.c, coral::crl_token, miner, coral::crl_symbol);
+         EXPECT_NEAR(crl, (__int128)supply.amount * ended_pool::stake_of(i) / total_stake, p.miners) << i;
+         paid += crl;
+         EXPECT_EQ(p.c.row_count(coral::pools, miner.value, name("positions")), 0u);
+      }
+      // what per-share rounding leaves behind stays with the contract
+      auto dust = coral::balance(p.c, coral::crl_token, coral::pools, coral::crl_symbol);
+      EXPECT_LE(dust, int64_t(p.miners));
+      EXPECT_EQ(paid + dust, supply.amount);
+      // four days halving daily on v1
+      auto emitted = v == coral::version::v1 ? reward.amount / 16 * 15 : reward.amount;
+      EXPECT_GE(supply.amount, emitted - int64_t(p.miners));
+      EXPECT_LE(supply.amount, emitted);
+
+      // what was never released leaves the committed total with the pool
+      auto reg = p.registry();
+      EXPECT_EQ(reg.released_reward, supply);
+      EXPECT_EQ(reg.committed_reward, committed - reward + supply);
+      EXPECT_EQ(reg.active_pools, 0u);
+      auto counts = *p.c.get_row<contract_row>(coral::pools, coral::pools.value, name("contracts"),
+                                               coral::stake_token.value);
+      EXPECT_EQ(counts.pools, 0u);
+      EXPECT_EQ(counts.miners, 0u);
+   }
+}
+
+TEST(cleanup, calls_stay_bounded_by_the_limit) {
+   for (auto v : {coral::version::v1, coral::version::v2}) {
+      ended_pool few(v, 4);
+      ended_pool many(v, 16);
+      // the tail of the schedule goes out with the miners released, not ahead of them
+      EXPECT_EQ(few.cleanup(2).cost_of(coral::pools, name("cleanup")).db_reads,
+                many.cleanup(2).cost_of(coral::pools, name("cleanup")).db_reads);
+   }
+}
+
+TEST(cleanup, returns_partner_deposits_nobody_earned) {
+   const symbol partner_symbol("PTR", 4);
+   const asset funding(400000000, partner_symbol);
+   chain c;
+   coral::deploy(c, coral::version::v2);
+   coral::create_pool(c, coral::version::v2, reward, c.time(), duration);
+   coral::create_stake_symbol(c, partner_symbol);
+   c.push(coral::pools, name("addreward"), coral::manager, uint64_t(1),
+          eosio::extended_symbol(partner_symbol, coral::stake_token));
+   coral::fund(c, coral::manager, funding);
+   coral::stake(c, coral::manager, funding, "reward:1");
+
+   // the only miner leaves a day in, the pool runs out its schedule empty
+   auto miner = coral::miner_name(0);
+   coral::fund(c, miner, asset(funds, coral::stake_symbol));
+   coral::stake(c, miner, asset(funds, coral::stake_symbol));
+   c.produce_blocks(86400);
+   c.push(coral::pools, name("harvestall"), coral::manager, std::vector<uint64_t>{1}, uint32_t(100));
+   c.push(coral::pools, name("withdraw"), miner, miner, uint64_t(1));
+   auto earned = coral::balance(c, coral::stake_token, miner, partner_symbol);
+   EXPECT_NEAR(earned, funding.amount / 4, 1);
+   c.produce_blocks(duration);
+   EXPECT_EQ(coral::balance(c, coral::stake_token, coral::manager, partner_symbol), 0);
+
+   c.push(coral::pools, name("cleanup"), coral::manager, uint64_t(1), uint32_t(10));
+   EXPECT_EQ(c.row_count(coral::pools, coral::pools.value, name("pools")), 0u);
+   auto refunded = coral::balance(c, coral::stake_token, coral::manager, partner_symbol);
+   EXPECT_NEAR(refunded, funding.amount - earned, 1);
+   EXPECT_EQ(refunded + earned + coral::balance(c, coral::stake_token, coral::pools, partner_symbol), funding.amount);
+}
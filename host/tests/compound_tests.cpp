@@ -0,0 +1,98 @@
+// Unclaimed CRL staked in place in a pool that stakes CRL.
+#include <host/coral.hpp>
+#include <host/rows.hpp>
+
+#include <gtest/gtest.h>
+
+#include <utility>
+#include <vector>
+
+using namespace host;
+using eosio::asset;
+using eosio::symbol;
+
+namespace {
+
+   const asset reward(100000000000000, coral::crl_symbol);
+   // between what the two miners have after an hour, on either schedule
+   const asset min_staked(600000000000, coral::crl_symbol);
+
+   // An lp pool (1) two miners stake in, three to one, and a pool staking
+   // CRL (2) their rewards can be compounded into, an hour in.
+   struct compound_pools {
+      chain c;
+      coral::version v;
+      name big = coral::miner_name(0);
+      name small = coral::miner_name(1);
+
+      explicit compound_pools(coral::version v) : v(v) {
+         coral::deploy(c, v);
+         coral::create_pool(c, v, reward, c.time(), 86400 * 4);
+         if (v == coral::version::v1) {
+            c.push(coral::pools, name("create"), coral::manager, coral::crl_token, coral::crl_symbol, reward, c.time(),
+                   uint32_t(86400 * 4), min_staked);
+         } else {
+            c.push(coral::pools, name("create"), coral::manager, coral::crl_token, coral::crl_symbol, reward, c.time(),
+                   uint32_t(86400 * 4), min_staked, uint8_t(0), eosio::symbol_code("BOX"));
+         }
+         coral::fund(c, big, asset(4000000, coral::stake_symbol));
+         coral::fund(c, small, asset(4000000, coral::stake_symbol));
+         coral::stake(c, big, asset(3000000, coral::stake_symbol));
+         coral::stake(c, small, asset(1000000, coral::stake_symbol));
+         c.produce_blocks(3600);
+         c.push(coral::pools, name("harvestall"), coral::manager, std::vector<uint64_t>{1}, uint32_t(100));
+      }
+
+      asset total_staked(uint64_t pool_id) const {
+         return c.get_row<pool_head_row>(coral::pools, coral::pools.value, name("pools"), pool_id)->total_staked;
+      }
+
+      // CRL the owner claimed from the lp pool and its stake in the CRL pool
+      std::pair<int64_t, int64_t> rows(name owner) const {
+         if (v == coral::version::v1) {
+            auto m = c.get_row<miner_v1_row>(coral::pools, 1, name("miners"), owner.value);
+            auto s = c.get_row<miner_v1_row>(coral::pools, 2, name("miners"), owner.value);
+            return {m->claimed.amount, s ? s->staked.amount : 0};
+         }
+         auto m = c.get_row<staker_row>(coral::pools, 1, name("stakers"), owner.value);
+         auto s = c.get_row<staker_row>(coral::pools, 2, name("stakers"), owner.value);
+         return {int64_t(m->balances[0].claimed), s ? int64_t(s->staked) : 0};
+      }
+
+      int64_t crl(name owner) const { return coral::balance(c, coral::crl_token, owner, coral::crl_symbol); }
+   };
+
+} // namespace
+
+TEST(compound, stakes_unclaimed_crl_in_place) {
+   for (auto v : {coral::version::v1, coral::version::v2}) {
+      compound_pools p(v);
+      auto held = p.crl(coral::pools);
+      ASSERT_GT(held, 0);
+
+      // a new miner of the CRL pool still has to bring min_staked
+      try {
+         p.c.push(coral::pools, name("compoundall"), p.small, p.small, uint64_t(2), std::vector<uint64_t>{1});
+         ADD_FAILURE() << "compounded below min_staked";
+      } catch (const eosio::eosio_assert_exception& e) {
+         EXPECT_STREQ(e.what(), "The amount of staked is too small");
+      }
+      EXPECT_EQ(p.total_staked(2).amount, 0);
+      EXPECT_EQ(p.rows(p.small), std::make_pair(int64_t(0), int64_t(0)));
+
+      // the CRL changes hands in the books only
+      p.c.push(coral::pools, name("compoundall"), p.big, p.big, uint64_t(2), std::vector<uint64_t>{1});
+      auto [claimed, staked] = p.rows(p.big);
+      EXPECT_GE(claimed, min_staked.amount);
+      EXPECT_EQ(staked, claimed);
+      EXPECT_EQ(p.total_staked(2), asset(claimed, coral::crl_symbol));
+      EXPECT_EQ(p.crl(coral::pools), held);
+      EXPECT_EQ(p.crl(p.big), 0);
+
+      // and leaves the contract on withdraw like any other stake
+      p.c.push(coral::pools, name("withdraw"), p.big, p.big, uint64_t(2));
+      EXPECT_EQ(p.total_staked(2).amount, 0);
+      EXPECT_EQ(p.crl(p.big), claimed);
+      EXPECT_EQ(p.crl(coral::pools), held - claimed);
+   }
+}
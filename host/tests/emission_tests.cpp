@@ -0,0 +1,73 @@
+// The emission schedules of common/include/emission.hpp, pinned to exact amounts.
+#include <emission.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+using emission::halving_emitted;
+using emission::linear_emitted;
+
+namespace {
+
+   // four periods of 100 seconds, 8000 a second in the first
+   const uint64_t total = 1600000;
+   const uint32_t duration = 400;
+
+} // namespace
+
+TEST(emission, halving_at_and_across_period_boundaries) {
+   EXPECT_EQ(halving_emitted(total, duration, 0), 0u);
+   EXPECT_EQ(halving_emitted(total, duration, 1), 8000u);
+   EXPECT_EQ(halving_emitted(total, duration, 99), 792000u);
+   EXPECT_EQ(halving_emitted(total, duration, 100), 800000u);
+   EXPECT_EQ(halving_emitted(total, duration, 101), 804000u);
+   EXPECT_EQ(halving_emitted(total, duration, 199), 1196000u);
+   EXPECT_EQ(halving_emitted(total, duration, 200), 1200000u);
+   EXPECT_EQ(halving_emitted(total, duration, 201), 1202000u);
+   EXPECT_EQ(halving_emitted(total, duration, 300), 1400000u);
+   EXPECT_EQ(halving_emitted(total, duration, 301), 1401000u);
+   EXPECT_EQ(halving_emitted(total, duration, 399), 1499000u);
+}
+
+TEST(emission, halving_releases_fifteen_sixteenths) {
+   EXPECT_EQ(halving_emitted(total, duration, duration), total / 16 * 15);
+   EXPECT_EQ(halving_emitted(total, duration, duration + 1), total / 16 * 15);
+   EXPECT_EQ(halving_emitted(total, duration, UINT32_MAX), total / 16 * 15);
+   // rounded down, not off by the rounding of each period
+   EXPECT_EQ(halving_emitted(100000000000001, 86400 * 4, 86400 * 4), 93750000000000u);
+   EXPECT_EQ(halving_emitted(1000001, duration, 100), 500000u);
+}
+
+TEST(emission, halving_with_a_duration_not_divisible_by_four) {
+   // periods of 100 seconds, the last runs the 3 seconds over at its rate
+   const uint32_t uneven = 403;
+   EXPECT_EQ(halving_emitted(total, uneven, 100), 800000u);
+   EXPECT_EQ(halving_emitted(total, uneven, 400), 1500000u);
+   EXPECT_EQ(halving_emitted(total, uneven, uneven), 1503000u);
+   EXPECT_EQ(halving_emitted(total, uneven, uneven + 1), 1503000u);
+
+   // never decreasing and never above the first period's rate
+   uint64_t last = 0;
+   for (uint32_t elapsed = 0; elapsed <= uneven + 2; elapsed++) {
+      auto emitted = halving_emitted(total, uneven, elapsed);
+      EXPECT_GE(emitted, last) << elapsed;
+      EXPECT_LE(emitted - last, 8000u) << elapsed;
+      last = emitted;
+   }
+
+   EXPECT_THROW(halving_emitted(total, 3, 1), eosio::eosio_assert_exception);
+}
+
+TEST(emission, linear_is_proportional_to_time) {
+   EXPECT_EQ(linear_emitted(total, duration, 0), 0u);
+   EXPECT_EQ(linear_emitted(total, duration, 1), 4000u);
+   EXPECT_EQ(linear_emitted(total, duration, 100), 400000u);
+   EXPECT_EQ(linear_emitted(total, duration, duration), total);
+   EXPECT_EQ(linear_emitted(total, duration, duration + 1), total);
+   // rounded down from the epoch, the end releases all of it
+   EXPECT_EQ(linear_emitted(10, 7, 3), 4u);
+   EXPECT_EQ(linear_emitted(10, 7, 6), 8u);
+   EXPECT_EQ(linear_emitted(10, 7, 7), 10u);
+   EXPECT_THROW(linear_emitted(total, 0, 0), eosio::eosio_assert_exception);
+}
@@ -0,0 +1,115 @@
+// The pool_event log indexers follow, decoded from the `log` actions.
+#include <host/coral.hpp>
+#include <host/rows.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace host;
+using eosio::asset;
+
+namespace {
+
+   const asset reward(100000000000000, coral::crl_symbol);
+   const uint32_t duration = 86400 * 4;
+
+   // kinds of pool_event, see pool_engine.hpp
+   const uint8_t event_create = 0;
+   const uint8_t event_stake = 1;
+   const uint8_t event_withdraw = 2;
+   const uint8_t event_claim = 3;
+   const uint8_t event_harvest = 4;
+   const uint8_t event_close = 5;
+
+   asset lp(int64_t amount) { return asset(amount, coral::stake_symbol); }
+
+   int64_t crl(const chain& c, name owner) { return coral::balance(c, coral::crl_token, owner, coral::crl_symbol); }
+
+   asset released(const chain& c) {
+      return c.get_row<pool_v1_row>(coral::pools, coral::pools.value, name("pools"), 1)->released_reward;
+   }
+
+} // namespace
+
+TEST(events, log_follows_the_pool_from_create_to_close) {
+   for (auto v : {coral::version::v1, coral::version::v2}) {
+      chain c;
+      coral::deploy(c, v);
+      auto events = events_of(coral::create_pool(c, v, reward, c.time(), duration), coral::pools);
+      ASSERT_EQ(events.size(), 1u);
+      EXPECT_EQ(events[0].kind, event_create);
+      EXPECT_EQ(events[0].pool_id, 1u);
+      EXPECT_EQ(events[0].owner, coral::stake_token);
+      EXPECT_EQ(events[0].quantity, reward);
+      EXPECT_EQ(events[0].total_staked, lp(0));
+
+      auto a = coral::miner_name(0);
+      auto b = coral::miner_name(1);
+      coral::fund(c, a, lp(1000000));
+      coral::fund(c, b, lp(1000000));
+      events = events_of(coral::stake(c, a, lp(100000)), coral::pools);
+      ASSERT_EQ(events.size(), 1u);
+      EXPECT_EQ(events[0].kind, event_stake);
+      EXPECT_EQ(events[0].owner, a);
+      EXPECT_EQ(events[0].quantity, lp(100000));
+      EXPECT_EQ(events[0].total_staked, lp(100000));
+      EXPECT_TRUE(events[0].amounts.empty());
+      coral::stake(c, b, lp(300000));
+
+      // a harvest logs what the pool released so far and, on v2, its accumulators
+      c.produce_blocks(3600);
+      events = events_of(c.push(coral::pools, name("harvestall"), coral::manager, std::vector<uint64_t>{1}, uint32_t(100)),
+                         coral::pools);
+      ASSERT_EQ(events.size(), 1u);
+      EXPECT_EQ(events[0].kind, event_harvest);
+      EXPECT_EQ(events[0].pool_id, 1u);
+      EXPECT_EQ(events[0].owner, name());
+      EXPECT_EQ(events[0].quantity, released(c));
+      EXPECT_GT(events[0].quantity.amount, 0);
+      EXPECT_EQ(events[0].total_staked, lp(400000));
+      ASSERT_EQ(events[0].amounts.size(), 1u);
+      EXPECT_EQ(events[0].amounts[0].contract, coral::crl_token);
+      EXPECT_EQ(events[0].amounts[0].quantity, released(c));
+      EXPECT_EQ(events[0].per_share.size(), v == coral::version::v1 ? 0u : 1u);
+
+      events = events_of(c.push(coral::pools, name("claimall"), a, a, std::vector<uint64_t>{}), coral::pools);
+      ASSERT_EQ(events.size(), 1u);
+      EXPECT_EQ(events[0].kind, event_claim);
+      EXPECT_EQ(events[0].owner, a);
+      EXPECT_EQ(events[0].quantity, lp(0));
+      EXPECT_EQ(events[0].total_staked, lp(400000));
+      ASSERT_EQ(events[0].amounts.size(), 1u);
+      EXPECT_EQ(events[0].amounts[0].contract, coral::crl_token);
+      EXPECT_EQ(events[0].amounts[0].quantity, asset(crl(c, a), coral::crl_symbol));
+
+      events = events_of(c.push(coral::pools, name("withdraw"), b, b, uint64_t(1)), coral::pools);
+      ASSERT_EQ(events.size(), 1u);
+      EXPECT_EQ(events[0].kind, event_withdraw);
+      EXPECT_EQ(events[0].owner, b);
+      EXPECT_EQ(events[0].quantity, lp(300000));
+      EXPECT_EQ(events[0].total_staked, lp(100000));
+      ASSERT_EQ(events[0].amounts.size(), 1u);
+      EXPECT_EQ(events[0].amounts[0].contract, coral::crl_token);
+      EXPECT_EQ(events[0].amounts[0].quantity, asset(crl(c, b), coral::crl_symbol));
+
+      // cleanup pays out the last miner and closes the pool with what was never released
+      c.produce_blocks(duration);
+      events = events_of(c.push(coral::pools, name("cleanup"), coral::manager, uint64_t(1), uint32_t(10)), coral::pools);
+      ASSERT_FALSE(events.empty());
+      auto w = std::find_if(events.begin(), events.end(), [](auto& e) { return e.kind == event_withdraw; });
+      ASSERT_NE(w, events.end());
+      EXPECT_EQ(w->owner, a);
+      EXPECT_EQ(w->quantity, lp(100000));
+      EXPECT_EQ(w->total_staked, lp(0));
+      auto& close = events.back();
+      EXPECT_EQ(close.kind, event_close);
+      EXPECT_EQ(close.pool_id, 1u);
+      EXPECT_EQ(close.owner, coral::stake_token);
+      auto supply = *c.get_row<asset>(coral::crl_token, coral::crl_symbol.code().raw(), name("stat"),
+                                      coral::crl_symbol.code().raw());
+      EXPECT_EQ(close.quantity, reward - supply);
+      EXPECT_EQ(close.total_staked, lp(0));
+   }
+}
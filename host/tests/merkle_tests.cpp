@@ -0,0 +1,155 @@
+// Merkle rounds of poolv2, the tree built the way a keeper would.
+#include <eosio/crypto.hpp>
+#include <host/coral.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+using namespace host;
+using eosio::asset;
+using eosio::checksum256;
+
+namespace {
+
+   struct round_row {
+      uint64_t id;
+      checksum256 root;
+      uint32_t leaves;
+      uint64_t total;
+      uint64_t claimed;
+      uint32_t published;
+   };
+
+   struct entry {
+      name owner;
+      uint64_t amount;
+   };
+
+   checksum256 hash_pair(const checksum256& left, const checksum256& right) {
+      char pair[64];
+      std::memcpy(pair, left.data(), 32);
+      std::memcpy(pair + 32, right.data(), 32);
+      return eosio::sha256(pair, sizeof(pair));
+   }
+
+   // every level of the tree, the leaves first and the root last
+   struct tree {
+      std::vector<std::vector<checksum256>> levels;
+
+      explicit tree(const std::vector<entry>& entries) {
+         std::vector<checksum256> level;
+         for (uint32_t i = 0; i < entries.size(); i++) {
+            char leaf[20];
+            eosio::datastream<char*> ds(leaf, sizeof(leaf));
+            ds << i << entries[i].owner << entries[i].amount;
+            level.push_back(eosio::sha256(leaf, sizeof(leaf)));
+         }
+         levels.push_back(level);
+         while (levels.back().size() > 1) {
+            const auto& below = levels.back();
+            std::vector<checksum256> next;
+            for (std::size_t i = 0; i < below.size(); i += 2) {
+               next.push_back(hash_pair(below[i], i + 1 < below.size() ? below[i + 1] : below[i]));
+            }
+            levels.push_back(next);
+         }
+      }
+
+      const checksum256& root() const { return levels.back()[0]; }
+
+      std::vector<checksum256> proof(uint32_t index) const {
+         std::vector<checksum256> result;
+         for (std::size_t l = 0; l + 1 < levels.size(); l++, index >>= 1) {
+            auto sibling = index ^ 1;
+            result.push_back(sibling < levels[l].size() ? levels[l][sibling] : levels[l][index]);
+         }
+         return result;
+      }
+   };
+
+   const uint32_t miners = 37;
+
+   // A merkle pool with `miners` miners an hour in, and its first round split by stake.
+   struct merkle_pool {
+      chain c;
+      std::vector<entry> entries;
+      uint64_t total = 0;
+
+      merkle_pool() {
+         coral::deploy(c, coral::version::v2);
+         coral::create_pool(c, coral::version::v2, asset(100000000000000, coral::crl_symbol), c.time(), 86400 * 4);
+         c.push(coral::pools, name("setmerkle"), coral::manager, uint64_t(1));
+         std::vector<uint64_t> stakes;
+         uint64_t total_staked = 0;
+         for (uint32_t i = 0; i < miners; i++) {
+            stakes.push_back(100000 + 7919 * i);
+            total_staked += stakes.back();
+            coral::fund(c, coral::miner_name(i), asset(stakes.back(), coral::stake_symbol));
+            coral::stake(c, coral::miner_name(i), asset(stakes.back(), coral::stake_symbol));
+         }
+         c.produce_blocks(3600);
+         const uint64_t emitted = 100000000000000ull * 3600 / (86400 * 4);
+         for (uint32_t i = 0; i < miners; i++) {
+            entries.push_back({coral::miner_name(i), emitted * stakes[i] / total_staked});
+            total += entries.back().amount;
+         }
+      }
+
+      transaction_trace publish(const tree& t) {
+         return c.push(coral::pools, name("publish"), coral::manager, uint64_t(1), t.root(),
+                       asset(total, coral::crl_symbol), uint32_t(entries.size()));
+      }
+
+      transaction_trace claim(const tree& t, uint32_t index, uint64_t amount) {
+         auto owner = entries[index].owner;
+         return c.push(coral::pools, name("claimproof"), owner, owner, uint64_t(1), uint64_t(1), index,
+                       asset(amount, coral::crl_symbol), t.proof(index));
+      }
+   };
+
+} // namespace
+
+TEST(merkle, round_pays_every_entry_once) {
+   merkle_pool p;
+   tree t(p.entries);
+   auto published = p.publish(t).cost_of(coral::pools, name("publish"));
+   // nothing per miner, the round is one row
+   EXPECT_LE(published.db_writes, 4u);
+   EXPECT_EQ(coral::balance(p.c, coral::crl_token, coral::pools, coral::crl_symbol), int64_t(p.total));
+
+   // a harvest leaves the CRL to the rounds
+   p.c.produce_blocks(60);
+   p.c.push(coral::pools, name("harvest"), coral::manager, uint64_t(1));
+   EXPECT_EQ(coral::balance(p.c, coral::crl_token, coral::pools, coral::crl_symbol), int64_t(p.total));
+
+   EXPECT_THROW(p.claim(t, 3, p.entries[3].amount + 1), eosio::eosio_assert_exception);
+   auto proof = t.proof(3);
+   EXPECT_THROW(p.c.push(coral::pools, name("claimproof"), p.entries[4].owner, p.entries[4].owner, uint64_t(1),
+                         uint64_t(1), uint32_t(3), asset(p.entries[3].amount, coral::crl_symbol), proof),
+                eosio::eosio_assert_exception);
+
+   counters first;
+   for (uint32_t i = 0; i < miners; i++) {
+      auto cost = p.claim(t, i, p.entries[i].amount).cost_of(coral::pools, name("claimproof"));
+      if (i == 0) first = cost;
+      EXPECT_LE(cost.db_reads, first.db_reads + 1) << "entry " << i;
+      EXPECT_EQ(coral::balance(p.c, coral::crl_token, p.entries[i].owner, coral::crl_symbol),
+                int64_t(p.entries[i].amount));
+   }
+   EXPECT_THROW(p.claim(t, 5, p.entries[5].amount), eosio::eosio_assert_exception);
+   auto round = p.c.get_row<round_row>(coral::pools, 1, name("mrounds"), 1);
+   ASSERT_TRUE(round);
+   EXPECT_EQ(round->claimed, p.total);
+   EXPECT_EQ(coral::balance(p.c, coral::crl_token, coral::pools, coral::crl_symbol), 0);
+}
+
+TEST(merkle, round_is_capped_by_the_emission) {
+   merkle_pool p;
+   p.entries[0].amount += p.total;
+   p.total *= 2;
+   EXPECT_THROW(p.publish(tree(p.entries)), eosio::eosio_assert_exception);
+   // the pool keeps its mode once CRL went out
+   EXPECT_THROW(p.c.push(coral::pools, name("setmerkle"), coral::manager, uint64_t(1)), eosio::eosio_assert_exception);
+}
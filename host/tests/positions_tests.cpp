@@ -0,0 +1,151 @@
+// The owner-to-pools index behind claimall and compoundall with no pools.
+#include <host/coral.hpp>
+#include <host/rows.hpp>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace host;
+using eosio::asset;
+using eosio::symbol;
+
+namespace {
+
+   const asset reward(100000000000000, coral::crl_symbol);
+   const symbol symbols[] = {coral::stake_symbol, symbol("LPB", 4), symbol("LPC", 4)};
+
+   // A pool on each of `symbols`, created by `code` and run on the current
+   // contract of version `v`.
+   struct pools {
+      chain c;
+      coral::version v;
+
+      pools(coral::version v, apply_handler code) : v(v) {
+         coral::deploy(c, v);
+         c.set_code(coral::pools, code);
+         for (auto& sym : symbols) {
+            if (sym != coral::stake_symbol) {
+               coral::create_stake_symbol(c, sym);
+            }
+            coral::create_pool(c, v, reward, c.time(), 86400 * 4, sym);
+         }
+      }
+
+      void upgrade() { c.set_code(coral::pools, coral::pool_code(v)); }
+
+      void stake(name miner, uint64_t pool_id, int64_t amount) {
+         auto sym = symbols[pool_id - 1];
+         if (coral::balance(c, coral::stake_token, miner, sym) == 0) {
+            coral::fund(c, miner, asset(4000000, sym));
+         }
+         coral::stake(c, miner, asset(amount, sym), "pool:" + std::to_string(pool_id));
+      }
+
+      std::vector<uint64_t> positions(name owner) const {
+         return c.primary_keys(coral::pools, owner.value, name("positions"));
+      }
+
+      posindex_row posindex() const {
+         return *c.get_row<posindex_row>(coral::pools, coral::pools.value, name("posindex"), name("posindex").value);
+      }
+   };
+
+} // namespace
+
+TEST(positions, follow_stakes_withdrawals_and_cleanup) {
+   for (auto v : {coral::version::v1, coral::version::v2}) {
+      pools p(v, coral::pool_code(v));
+      auto a = coral::miner_name(0);
+      auto b = coral::miner_name(1);
+      p.stake(a, 1, 100000);
+      p.stake(a, 3, 100000);
+      p.stake(a, 1, 50000);
+      p.stake(b, 2, 100000);
+      EXPECT_EQ(p.positions(a), (std::vector<uint64_t>{1, 3}));
+      EXPECT_EQ(p.positions(b), (std::vector<uint64_t>{2}));
+
+      // no pools claims from every position
+      p.c.produce_blocks(3600);
+      p.c.push(coral::pools, name("harvestall"), coral::manager, std::vector<uint64_t>{1, 2, 3}, uint32_t(100));
+      p.c.push(coral::pools, name("claimall"), a, a, std::vector<uint64_t>{});
+      auto claimed = coral::balance(p.c, coral::crl_token, a, coral::crl_symbol);
+      EXPECT_GT(claimed, 0);
+      EXPECT_EQ(error_of([&] { p.c.push(coral::pools, name("claimall"), a, a, std::vector<uint64_t>{}); }),
+                "No unclaimed");
+      EXPECT_EQ(error_of([&] { p.c.push(coral::pools, name("claim"), a, a, uint64_t(3)); }), "No unclaimed");
+      auto c = coral::miner_name(2);
+      p.c.create_account(c);
+      EXPECT_EQ(error_of([&] { p.c.push(coral::pools, name("claimall"), c, c, std::vector<uint64_t>{}); }), "No pools");
+
+      p.c.push(coral::pools, name("withdraw"), a, a, uint64_t(1));
+      EXPECT_EQ(p.positions(a), (std::vector<uint64_t>{3}));
+
+      p.c.produce_blocks(86400 * 4);
+      p.c.push(coral::pools, name("cleanup"), coral::manager, uint64_t(3), uint32_t(10));
+      EXPECT_TRUE(p.positions(a).empty());
+      EXPECT_EQ(p.positions(b), (std::vector<uint64_t>{2}));
+   }
+}
+
+TEST(positions, indexall_resumes_across_calls_and_pools) {
+   for (auto v : {coral::version::v1, coral::version::v2}) {
+      // miners of the deployed contract, which kept no positions
+      pools p(v, coral::baseline_code(v));
+      const uint32_t first = 5, second = 3;
+      for (uint32_t i = 0; i < first; i++) {
+         p.stake(coral::miner_name(i), 1, 100000 + i);
+      }
+      for (uint32_t i = 0; i < second; i++) {
+         p.stake(coral::miner_name(i), 2, 100000 + i);
+      }
+      p.upgrade();
+      // the v2 miner rows stay in the legacy layout, a new miner stakes beside them
+      auto late = coral::miner_name(first);
+      p.stake(late, 2, 100000);
+      EXPECT_EQ(p.positions(late), (std::vector<uint64_t>{2}));
+      if (v == coral::version::v2) {
+         EXPECT_EQ(p.c.row_count(coral::pools, 1, name("miners")), first);
+         EXPECT_EQ(p.c.row_count(coral::pools, 2, name("miners")), second);
+      }
+      for (uint32_t i = 0; i < first; i++) {
+         EXPECT_TRUE(p.positions(coral::miner_name(i)).empty()) << i;
+      }
+
+      // three rows a call, listing the first pool by token takes one of them,
+      // stopping inside the first pool and then before the second
+      p.c.push(coral::pools, name("indexall"), coral::manager, uint32_t(3));
+      auto state = p.posindex();
+      EXPECT_EQ(state.pool_id, 1u);
+      EXPECT_NE(state.owner, name());
+      EXPECT_EQ(state.rows, 2u);
+      p.c.push(coral::pools, name("indexall"), coral::manager, uint32_t(3));
+      state = p.posindex();
+      EXPECT_EQ(state.pool_id, 2u);
+      EXPECT_EQ(state.rows, 5u);
+      while (p.posindex().pool_id <= 3) {
+         p.c.push(coral::pools, name("indexall"), coral::manager, uint32_t(3));
+      }
+      EXPECT_EQ(p.posindex().rows, first + second + 1);
+      EXPECT_EQ(error_of([&] { p.c.push(coral::pools, name("indexall"), coral::manager, uint32_t(3)); }),
+                "Nothing to index");
+
+      for (uint32_t i = 0; i <= first; i++) {
+         std::vector<uint64_t> expected;
+         if (i < first) {
+            expected.push_back(1);
+         }
+         if (i < second || i == first) {
+            expected.push_back(2);
+         }
+         EXPECT_EQ(p.positions(coral::miner_name(i)), expected) << i;
+      }
+      // and claimall finds the legacy rows through them
+      p.c.produce_blocks(3600);
+      p.c.push(coral::pools, name("harvestall"), coral::manager, std::vector<uint64_t>{1, 2}, uint32_t(100));
+      auto miner = coral::miner_name(0);
+      p.c.push(coral::pools, name("claimall"), miner, miner, std::vector<uint64_t>{});
+      EXPECT_GT(coral::balance(p.c, coral::crl_token, miner, coral::crl_symbol), 0);
+   }
+}
@@ -0,0 +1,57 @@
+// poolv2 stakers settled against the per-share accumulators.
+#include <host/coral.hpp>
+#include <host/rows.hpp>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace host;
+
+namespace {
+
+   const asset reward(100000000000000, coral::crl_symbol);
+   const uint32_t duration = 86400 * 4;
+   // a stake token with more precision than the lp tokens
+   const symbol fine_symbol("LPF", 8);
+
+   void harvest(chain& c) {
+      c.push(coral::pools, name("harvestall"), coral::manager, std::vector<uint64_t>{1}, uint32_t(100));
+   }
+
+   // CRL `amount` earns holding the whole stake for an hour, after a single
+   // unit held it alone for the first hour
+   int64_t after_a_tiny_stake(int64_t amount) {
+      chain c;
+      coral::deploy(c, coral::version::v2);
+      coral::create_stake_symbol(c, fine_symbol);
+      coral::create_pool(c, coral::version::v2, reward, c.time(), duration, fine_symbol);
+      auto tiny = coral::miner_name(0);
+      auto large = coral::miner_name(1);
+      coral::fund(c, tiny, asset(1, fine_symbol));
+      coral::fund(c, large, asset(amount, fine_symbol));
+
+      coral::stake(c, tiny, asset(1, fine_symbol));
+      c.produce_blocks(3600);
+      harvest(c);
+      c.push(coral::pools, name("withdraw"), tiny, tiny, uint64_t(1));
+      EXPECT_EQ(coral::balance(c, coral::crl_token, tiny, coral::crl_symbol), reward.amount / 96);
+
+      coral::stake(c, large, asset(amount, fine_symbol));
+      c.produce_blocks(3600);
+      harvest(c);
+      c.push(coral::pools, name("withdraw"), large, large, uint64_t(1));
+      EXPECT_EQ(coral::balance(c, coral::stake_token, large, fine_symbol), amount);
+      return coral::balance(c, coral::crl_token, large, coral::crl_symbol);
+   }
+
+} // namespace
+
+TEST(settle, large_stake_after_a_tiny_one) {
+   // the accumulator stands at 1041666666666e12 after the first hour, the
+   // larger stake times the accumulator crosses 2^128 during the second
+   for (int64_t amount : {int64_t(163335536122154), int64_t(326671072244309)}) {
+      // the accumulator rounds down a unit for every 1e12 staked
+      EXPECT_NEAR(after_a_tiny_stake(amount), reward.amount / 96, amount / 1000000000000 + 1) << amount;
+   }
+}
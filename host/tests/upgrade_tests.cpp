@@ -0,0 +1,99 @@
+// poolv2 deployed over the state of the v1 contract.
+#include <host/coral.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <vector>
+
+using namespace host;
+using eosio::asset;
+
+namespace {
+
+   const uint32_t miners = 6;
+
+   struct migration_row {
+      uint64_t pool_id;
+      uint64_t pools;
+      uint64_t rows;
+   };
+
+   bool migrated(const chain& c) {
+      auto row = c.get_row<migration_row>(coral::pools, coral::pools.value, name("migration"), name("migration").value);
+      return row && row->pools == 1;
+   }
+
+   void harvest(chain& c, coral::version v) {
+      if (v == coral::version::v1) {
+         c.push(coral::pools, name("harvest"), coral::manager, uint64_t(1), uint32_t(0));
+      } else {
+         c.push(coral::pools, name("harvest"), coral::manager, uint64_t(1));
+      }
+   }
+
+   // The same pool history on the v1 contract throughout, or upgraded to
+   // poolv2 after the first harvest and migrated `migrate_rows` rows at a
+   // time while it keeps running. Returns the CRL every miner ends up with.
+   std::vector<int64_t> run(bool upgrade, uint32_t migrate_rows) {
+      chain c;
+      coral::deploy(c, coral::version::v1);
+      coral::create_pool(c, coral::version::v1, asset(100000000000000, coral::crl_symbol), c.time(), 86400 * 4);
+      for (uint32_t i = 0; i < miners; i++) {
+         coral::fund(c, coral::miner_name(i), asset(2000000, coral::stake_symbol));
+         coral::stake(c, coral::miner_name(i), asset(100000 + 37813 * i, coral::stake_symbol));
+      }
+      c.produce_blocks(3600);
+      harvest(c, coral::version::v1);
+
+      auto v = coral::version::v1;
+      if (upgrade) {
+         c.set_code(coral::pools, coral::pool_code(coral::version::v2));
+         v = coral::version::v2;
+      }
+      for (uint32_t round = 0; round < 3; round++) {
+         c.produce_blocks(7200);
+         harvest(c, v);
+         if (upgrade && !migrated(c)) {
+            c.push(coral::pools, name("migrateall"), coral::manager, migrate_rows);
+         }
+         auto miner = coral::miner_name(round);
+         c.push(coral::pools, name("claim"), miner, miner, uint64_t(1));
+         coral::stake(c, coral::miner_name(miners - 1), asset(50000, coral::stake_symbol));
+      }
+      c.push(coral::pools, name("withdraw"), coral::miner_name(3), coral::miner_name(3), uint64_t(1));
+      c.produce_blocks(7200);
+      harvest(c, v);
+
+      std::vector<int64_t> crl;
+      for (uint32_t i = 0; i < miners; i++) {
+         auto miner = coral::miner_name(i);
+         if (i != 3) {
+            c.push(coral::pools, name("claim"), miner, miner, uint64_t(1));
+         }
+         crl.push_back(coral::balance(c, coral::crl_token, miner, coral::crl_symbol));
+      }
+      if (upgrade) {
+         while (!migrated(c)) {
+            c.push(coral::pools, name("migrateall"), coral::manager, migrate_rows);
+         }
+         EXPECT_EQ(c.row_count(coral::pools, 1, name("miners")), 0u);
+         EXPECT_EQ(c.row_count(coral::pools, 1, name("stakers")), miners - 1);
+         EXPECT_THROW(c.push(coral::pools, name("migrateall"), coral::manager, migrate_rows), eosio::eosio_assert_exception);
+      }
+      return crl;
+   }
+
+} // namespace
+
+TEST(upgrade, v1_state_runs_on_poolv2) {
+   auto v1 = run(false, 0);
+   for (uint32_t rows : {1u, 2u, 100u}) {
+      auto v2 = run(true, rows);
+      for (uint32_t i = 0; i < miners; i++) {
+         EXPECT_GT(v2[i], 0);
+         // the accumulator rounds per harvest where v1 rounded per miner
+         EXPECT_LE(std::llabs(v2[i] - v1[i]), 10) << "miner " << i << " migrating " << rows << " rows a call";
+      }
+   }
+}
@@ -0,0 +1,126 @@
+// getpending and getpools against what the claims and harvests after them pay.
+#include <host/coral.hpp>
+#include <host/rows.hpp>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace host;
+using eosio::asset;
+using eosio::symbol;
+
+namespace {
+
+   const asset reward(100000000000000, coral::crl_symbol);
+   const symbol second_symbol("LPB", 4);
+   const uint32_t miners = 5;
+
+   // Two pools, uneven stakes, harvested an hour in and left half an hour
+   // more so the views have something pending.
+   struct viewed_pools {
+      chain c;
+      coral::version v;
+
+      explicit viewed_pools(coral::version v) : v(v) {
+         coral::deploy(c, v);
+         coral::create_stake_symbol(c, second_symbol);
+         coral::create_pool(c, v, reward, c.time(), 86400 * 4);
+         coral::create_pool(c, v, reward, c.time(), 86400 * 4, second_symbol);
+         for (uint32_t i = 0; i < miners; i++) {
+            auto miner = coral::miner_name(i);
+            coral::fund(c, miner, asset(4000000, coral::stake_symbol));
+            coral::fund(c, miner, asset(4000000, second_symbol));
+            coral::stake(c, miner, asset(100000 + 37813 * i, coral::stake_symbol));
+            coral::stake(c, miner, asset(300007 + 7919 * i, second_symbol), "pool:2");
+         }
+         c.produce_blocks(3600);
+         harvest();
+         c.produce_blocks(1800);
+      }
+
+      void harvest() {
+         c.push(coral::pools, name("harvestall"), coral::manager, std::vector<uint64_t>{1, 2}, uint32_t(100));
+      }
+
+      // CRL getpending has for the owner across both pools
+      int64_t pending(name owner) {
+         auto trace = c.push(coral::pools, name("getpending"), owner, owner, std::vector<uint64_t>{});
+         int64_t crl = 0;
+         if (v == coral::version::v1) {
+            auto rows = return_of<std::vector<pending_v1_row>>(trace, coral::pools, name("getpending"));
+            EXPECT_EQ(rows.size(), 2u);
+            for (auto& r : rows) {
+               crl += r.crl.amount;
+            }
+         } else {
+            auto rows = return_of<std::vector<pending_v2_row>>(trace, coral::pools, name("getpending"));
+            EXPECT_EQ(rows.size(), 2u);
+            for (auto& r : rows) {
+               EXPECT_EQ(r.rewards[0].quantity.symbol, coral::crl_symbol);
+               crl += r.rewards[0].quantity.amount;
+            }
+         }
+         return crl;
+      }
+
+      // pending_reward of every pool
+      std::vector<asset> pools_pending() {
+         auto trace = c.push(coral::pools, name("getpools"), coral::manager, uint64_t(0), uint32_t(10));
+         std::vector<asset> result;
+         if (v == coral::version::v1) {
+            for (auto& p : return_of<std::vector<pool_state_v1_row>>(trace, coral::pools, name("getpools"))) {
+               result.push_back(p.pending_reward);
+            }
+         } else {
+            for (auto& p : return_of<std::vector<pool_state_v2_row>>(trace, coral::pools, name("getpools"))) {
+               result.push_back(p.pending_reward);
+            }
+         }
+         return result;
+      }
+
+      asset released(uint64_t pool_id) const {
+         return c.get_row<pool_v1_row>(coral::pools, coral::pools.value, name("pools"), pool_id)->released_reward;
+      }
+   };
+
+} // namespace
+
+TEST(views, pending_matches_the_next_harvest_and_claims) {
+   for (auto v : {coral::version::v1, coral::version::v2}) {
+      viewed_pools p(v);
+      auto pending = p.pools_pending();
+      ASSERT_EQ(pending.size(), 2u);
+      std::vector<int64_t> owed;
+      for (uint32_t i = 0; i < miners; i++) {
+         owed.push_back(p.pending(coral::miner_name(i)));
+         EXPECT_GT(owed.back(), 0) << i;
+      }
+
+      std::vector<asset> before{p.released(1), p.released(2)};
+      p.harvest();
+      for (uint64_t pool_id : {1, 2}) {
+         auto harvested = p.released(pool_id) - before[pool_id - 1];
+         // v1 releases what its split by miner adds up to, the rest stays pending
+         if (v == coral::version::v1) {
+            EXPECT_LE(harvested, pending[pool_id - 1]) << pool_id;
+            EXPECT_GE(harvested.amount, pending[pool_id - 1].amount - int64_t(miners)) << pool_id;
+         } else {
+            EXPECT_EQ(harvested.amount, pending[pool_id - 1].amount) << pool_id;
+         }
+      }
+
+      // claimed in one go and pool by pool
+      for (uint32_t i = 0; i < miners; i++) {
+         auto miner = coral::miner_name(i);
+         if (i % 2 == 0) {
+            p.c.push(coral::pools, name("claimall"), miner, miner, std::vector<uint64_t>{});
+         } else {
+            p.c.push(coral::pools, name("claim"), miner, miner, uint64_t(1));
+            p.c.push(coral::pools, name("claim"), miner, miner, uint64_t(2));
+         }
+         EXPECT_EQ(coral::balance(p.c, coral::crl_token, miner, coral::crl_symbol), owed[i]) << i;
+      }
+   }
+}
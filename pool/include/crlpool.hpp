@@ -1,19 +1,73 @@
-#include <utils.hpp>
-
 #define CRL_CONTRACT  name("coralfitoken")
 
-CONTRACT crlpool : public contract {
+#include <pool_engine.hpp>
+
+// miners earn CRL only
+struct crl_rewards {
+   typedef std::array<uint64_t, 1> amounts;
+   static engine::reward_token crl() { return {CRL_CONTRACT, symbol("CRL", 10)}; }
+   static bool empty(const amounts& a) { return a[0] == 0; }
+   static void add(amounts& a, name contract, asset quantity) { a[0] += quantity.amount; }
+   template<typename F>
+   static void for_each(const amounts& a, F&& f) {
+      if (a[0] > 0) {
+         f(CRL_CONTRACT, asset(a[0], symbol("CRL", 10)));
+      }
+   }
+   static bool is_reward_sender(name from) { return false; }
+};
+
+// halving emission, every harvest credits each miner's row
+CONTRACT crlpool : public engine::pool_engine<crlpool, emission::halving_schedule, crl_rewards> {
    public:
-      using contract::contract;
+      using pool_engine::pool_engine;
+
+      // harvest_pool updates every miner row
+      static constexpr bool harvest_walks_miners = true;
+
+      struct pending_reward {
+         uint64_t pool_id;
+         asset staked;
+         asset crl;
+      };
+
+      struct pool_state {
+         uint64_t pool_id;
+         name contract;
+         symbol sym;
+         asset total_staked;
+         asset total_reward;
+         asset released_reward;
+         asset pending_reward;   // what a harvest now would release
+         asset reward_per_day;   // at the current emission rate
+         uint32_t epoch_time;
+         uint32_t duration;
+      };
 
       ACTION create(name contract, symbol sym, asset reward, uint32_t epoch_time, uint32_t duration, asset min_staked);
       ACTION claim(name owner, uint64_t pool_id);
+      ACTION claimall(name owner, vector<uint64_t> pool_ids);
+      ACTION compound(name owner, uint64_t pool_id);
+      // stakes the unclaimed CRL of `pool_ids` in `pool_id`, which must stake CRL
+      ACTION compoundall(name owner, uint64_t pool_id, vector<uint64_t> pool_ids);
       ACTION withdraw(name owner, uint64_t pool_id);
       ACTION harvest(uint64_t pool_id, uint32_t nonce);
+      ACTION harvestall(vector<uint64_t> pool_ids, uint32_t max_rows);
+      // pays out and drops the miners of a finished pool, `limit` at a time, then the pool
+      ACTION cleanup(uint64_t pool_id, uint32_t limit);
+      // adds the positions of miners that staked before they were kept and lists older pools by token, `limit` rows a call
+      ACTION indexall(uint32_t limit);
+      // no-op, carries the events of an action to indexers, see pool_engine.hpp
+      ACTION log(vector<engine::pool_event> events);
 
-      void handle_transfer(name from, name to, asset quantity, string memo, name code);
+      // read-only queries, computed with the same math as harvest. No pools
+      // lists every pool the owner has a stake in
+      [[eosio::action, eosio::read_only]] vector<pending_reward> getpending(name owner, vector<uint64_t> pool_ids);
+      [[eosio::action, eosio::read_only]] vector<pool_state> getpools(uint64_t from, uint32_t limit);
 
    private:
+      friend pool_engine;
+
       TABLE pool {
          uint64_t id;
          name contract;
@@ -26,7 +80,7 @@ CONTRACT crlpool : public contract {
          asset min_staked;
          uint32_t last_harvest_time;
          uint64_t primary_key() const { return id; }
-         // uint128_t get_key() const { return utils::get_token_key(contract, sym); }
+         uint128_t get_key() const { return utils::get_token_key(contract, sym); }
       };
 
       TABLE miner {
@@ -37,8 +91,69 @@ CONTRACT crlpool : public contract {
          uint64_t primary_key() const { return owner.value; }
       };
 
-      typedef eosio::multi_index<"pools"_n, pool> pools_mi;
-      typedef eosio::multi_index<"miners"_n, miner> miners_mi;
+      TABLE registry {
+         asset committed_reward;
+         asset released_reward;
+         uint64_t active_pools;
+      };
 
+      TABLE stakedcontract {
+         name contract;
+         uint64_t pools;
+         uint64_t miners;        // with a position, older miners count once indexall or a deposit adds theirs
+         uint64_t primary_key() const { return contract.value; }
+      };
       
+      // a pool the owner has a stake in, scoped by owner
+      TABLE position {
+         uint64_t pool_id;
+         uint64_t primary_key() const { return pool_id; }
+      };
+
+      // how far indexall got
+      TABLE posindex {
+         uint64_t pool_id;       // the pool being indexed, the ones before it are done
+         name owner;             // the next miner of that pool to index
+         uint64_t rows;
+      };
+
+      // rolling figures of a pool for monitoring, kept up to date by the actions
+      TABLE poolstat {
+         uint64_t pool_id;
+         uint64_t harvests;
+         uint32_t harvest_interval;   // seconds between the last two harvests
+         uint64_t rows_last;          // miner rows the last harvest touched
+         uint64_t rows_total;
+         uint64_t deferred;           // times harvestall ran out of rows before reaching the pool
+         uint64_t crl_last;           // released by the last harvest
+         uint64_t crl_total;
+         uint64_t deposits;
+         uint64_t deposit_volume;
+         uint64_t withdrawals;
+         uint64_t withdraw_volume;
+         uint64_t box_total;          // always 0 here, poolv2 reads these rows after an upgrade
+         uint64_t primary_key() const { return pool_id; }
+      };
+      
+      typedef eosio::multi_index<"pools"_n, pool,
+         indexed_by<"tokenkey"_n, const_mem_fun<pool, uint128_t, &pool::get_key>>
+      > pools_mi;
+      typedef eosio::multi_index<"miners"_n, miner> miners_mi;
+      typedef rawdb::cursor<"miners"_n, miner> miners_cursor;
+      typedef rawdb::cursor<"pools"_n, pool> pools_cursor;
+      typedef eosio::singleton<"registry"_n, registry> registry_si;
+      typedef eosio::multi_index<"contracts"_n, stakedcontract> contracts_mi;
+      typedef eosio::multi_index<"poolstats"_n, poolstat> poolstats_mi;
+      typedef eosio::multi_index<"positions"_n, position> positions_mi;
+      typedef eosio::singleton<"posindex"_n, posindex> posindex_si;
+
+      // settlement, see pool_engine.hpp
+      uint64_t harvest_pool(pools_mi& pools_tbl, pools_mi::const_iterator itr, uint32_t now_time, uint64_t& rows);
+      bool take_unclaimed(const pool& p, name owner, rewards& amounts);
+      uint64_t remove_miner(const pool& p, name owner, rewards& amounts);
+      bool add_stake(const pool& p, name owner, asset quantity);
+      void reward_totals(const pool& p, vector<extended_asset>& released, vector<uint128_t>& per_share);
+      name next_miner(const pool& p, name from);
+      bool finish_round(const pool& p, uint32_t limit, uint32_t& rows);
+      void close_pool(const pool& p);
 };
\ No newline at end of file
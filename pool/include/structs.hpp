@@ -1,13 +1,7 @@
 #include <eosio/eosio.hpp>
 #include <eosio/system.hpp>
 #include <eosio/asset.hpp>
+#include <eosio/singleton.hpp>
 
 using namespace eosio;
-using namespace std;
-
-struct transfer_args {
-    name from;
-    name to;
-    asset quantity;
-    string memo;
-};
\ No newline at end of file
+using namespace std;
\ No newline at end of file
@@ -2,13 +2,24 @@
 
 namespace utils {
 
-    void inline_transfer(name contract, name from, name to, asset quantity, string memo) {
-        auto data = make_tuple(from, to, quantity, memo);
-        action(permission_level{from, "active"_n}, contract, "transfer"_n, data).send();
+    uint128_t get_token_key(name contract, symbol sym) {
+        return ((uint128_t)(contract.value) << 64) + sym.raw();
     }
 
-    // uint128_t get_token_key(name contract, symbol sym) {
-    //     return ((uint128_t)(contract.value) << 64) + sym.raw();
-    // }
+    // pool id addressed by a "pool:<id>" transfer memo, 0 if the memo has no such prefix
+    uint64_t parse_pool_memo(std::string_view memo) {
+        if (memo.compare(0, 5, "pool:") != 0) {
+            return 0;
+        }
+        check(memo.size() > 5 && memo.size() <= 25, "Invalid pool memo");
+        uint64_t pool_id = 0;
+        for (size_t i = 5; i < memo.size(); i++) {
+            check(memo[i] >= '0' && memo[i] <= '9', "Invalid pool memo");
+            auto next = pool_id * 10 + (memo[i] - '0');
+            check(next / 10 == pool_id, "Invalid pool memo");
+            pool_id = next;
+        }
+        return pool_id;
+    }
 
 }
\ No newline at end of file
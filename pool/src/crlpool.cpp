@@ -1,193 +1,189 @@
 #include <crlpool.hpp>
-#include <math.h>
 
 extern "C" {
     void apply(uint64_t receiver, uint64_t code, uint64_t action) {
         if (code == receiver) {
             switch (action) {
-                EOSIO_DISPATCH_HELPER(crlpool, (create)(claim)(withdraw)(harvest))
+                EOSIO_DISPATCH_HELPER(crlpool, (create)(claim)(claimall)(compound)(compoundall)(withdraw)(harvest)(harvestall)(cleanup)(indexall)(log)(getpending)(getpools))
             }
         } else {
             if (action == name("transfer").value) {
-                crlpool inst(name(receiver), name(code), datastream<const char *>(nullptr, 0));
-                const auto t = unpack_action_data<transfer_args>();
-                inst.handle_transfer(t.from, t.to, t.quantity, t.memo, name(code));
+                // most transfers a token notifies us of aren't ours, skip them before decoding the rest
+                rawaction::transfer_reader t;
+                if (t.read(name(receiver))) {
+                    crlpool inst(name(receiver), name(code), datastream<const char *>(nullptr, 0));
+                    inst.handle_transfer(t.from, t.to, t.quantity, t.memo, name(code));
+                }
             }
         }
     }
 }
 
 void crlpool::create(name contract, symbol sym, asset reward, uint32_t epoch_time, uint32_t duration, asset min_staked) {
-    require_auth("coralmanager"_n);
-
-    pools_mi pools_tbl(_self, _self.value);
-    auto itr = pools_tbl.begin();
-    
-    while (itr != pools_tbl.end()) {
-        auto exists = itr->contract == contract && itr->sym == sym;
-        check(!exists, "Token exists");
-        itr++;
-    }
-
-    check(reward.symbol == symbol("CRL", 10), "Reward symbol error");
-    check(min_staked.symbol == sym, "Min-staked symbol error");
-
-    auto total = reward;
-    itr = pools_tbl.begin();
-    while (itr != pools_tbl.end()) {
-        total += itr->total_reward;
-        itr++;
-    }
-    check(total.amount <= 300000000000000, "Reach the max circulation");
-
-    auto pool_id = pools_tbl.available_primary_key();
-    if (pool_id == 0) {
-        pool_id = 1;
-    }
-    pools_tbl.emplace(_self, [&]( auto& a ) {
-        a.id = pool_id;
-        a.contract = contract;
-        a.sym = sym;
-        a.total_staked = asset(0, sym);
-        a.total_reward = reward;
-        a.released_reward = asset(0, reward.symbol);
-        a.epoch_time = epoch_time;
-        a.duration = duration;
-        a.min_staked = min_staked;
-        a.last_harvest_time = epoch_time;
-    });
+    create_pool(contract, sym, reward, epoch_time, duration, min_staked, [](auto& a) {});
 }
 
 void crlpool::claim(name owner, uint64_t pool_id) {
-    require_auth(owner);
+    claim_pools(owner, {pool_id});
+}
 
-    pools_mi pools_tbl(_self, _self.value);
-    auto p_itr = pools_tbl.find(pool_id);  
-    check(p_itr != pools_tbl.end(), "Pool not exists");
+void crlpool::claimall(name owner, vector<uint64_t> pool_ids) {
+    claim_pools(owner, pool_ids);
+}
 
-    miners_mi miners_tbl(_self, pool_id);
-    auto m_itr = miners_tbl.find(owner.value);
-    check(m_itr != miners_tbl.end(), "No this miner");
-    check(m_itr->unclaimed.amount > 0, "No unclaimed");
+void crlpool::compound(name owner, uint64_t pool_id) {
+    compound_pools(owner, pool_id, {pool_id});
+}
 
-    auto quantity = m_itr->unclaimed;
-    miners_tbl.modify(m_itr, same_payer, [&]( auto& s) {
-        s.claimed += quantity;
-        s.unclaimed = asset(0, quantity.symbol);
-    });
-    
-    utils::inline_transfer(CRL_CONTRACT, _self, owner, quantity, string("Minner claimed"));
+void crlpool::compoundall(name owner, uint64_t pool_id, vector<uint64_t> pool_ids) {
+    compound_pools(owner, pool_id, pool_ids);
 }
 
 void crlpool::withdraw(name owner, uint64_t pool_id) {
-    require_auth(owner);
+    withdraw_pool(owner, pool_id);
+}
 
-    pools_mi pools_tbl(_self, _self.value);
-    auto p_itr = pools_tbl.find(pool_id);  
-    check(p_itr != pools_tbl.end(), "Pool not exists");
+void crlpool::harvest(uint64_t pool_id, uint32_t nonce) {
+    harvest_one(pool_id);
+}
 
-    miners_mi miners_tbl(_self, pool_id);
-    auto m_itr = miners_tbl.find(owner.value);
-    check(m_itr != miners_tbl.end(), "No this miner");
-    auto unclaimed = m_itr->unclaimed;
+void crlpool::harvestall(vector<uint64_t> pool_ids, uint32_t max_rows) {
+    harvest_pools(pool_ids, max_rows);
+}
 
-    auto quantity = m_itr->staked;
-    pools_tbl.modify(p_itr, same_payer, [&]( auto& s) {
-        s.total_staked -= quantity;
-    });
-    miners_tbl.erase(m_itr);
+void crlpool::cleanup(uint64_t pool_id, uint32_t limit) {
+    cleanup_pool(pool_id, limit);
+}
 
-    utils::inline_transfer(p_itr->contract, _self, owner, quantity, string("Minner withdraw"));
-    if (unclaimed.amount > 0) {
-        utils::inline_transfer(CRL_CONTRACT, _self, owner, unclaimed, string("Minner claimed"));
-    }
+void crlpool::indexall(uint32_t limit) {
+    index_positions(limit);
 }
 
-void crlpool::harvest(uint64_t pool_id, uint32_t nonce) {
-    require_auth("coralmanager"_n);
+void crlpool::log(vector<engine::pool_event> events) {
+    require_auth(_self);
+}
 
+vector<crlpool::pending_reward> crlpool::getpending(name owner, vector<uint64_t> pool_ids) {
     pools_mi pools_tbl(_self, _self.value);
-    auto itr = pools_tbl.find(pool_id);  
-    check(itr != pools_tbl.end(), "Pool not exists");
-
     auto now_time = current_time_point().sec_since_epoch();
-    check(now_time >= itr->epoch_time, "Mining hasn't started yet");
-    check(now_time <= itr->epoch_time + itr->duration, "Mining is over");
-    
-    auto period = itr->duration / 4;
-    auto supply_per_second_init = itr->total_reward.amount / 2 / period;
-    auto exp = (now_time - itr->epoch_time) / period;
-    if (exp > 3) {
-        exp = 3;
+    vector<pending_reward> result;
+    if (pool_ids.empty()) {
+        pool_ids = owner_pools(owner);
     }
-    auto supply_per_second_now = supply_per_second_init * (uint32_t)(pow(0.5, exp) * 1000) / 1000;
-    auto time_elapsed = now_time - itr->last_harvest_time;
-    if (time_elapsed == 0) {
-        return;
+    for (auto pool_id : pool_ids) {
+        auto p_itr = pools_tbl.find(pool_id);
+        check(p_itr != pools_tbl.end(), "Pool not exists");
+
+        miners_mi miners_tbl(_self, pool_id);
+        auto m_itr = miners_tbl.find(owner.value);
+        if (m_itr == miners_tbl.end()) {
+            continue;
+        }
+        auto crl = m_itr->unclaimed;
+        if (harvestable(*p_itr, now_time)) {
+            crl.amount += emission::pro_rata(pending_emission(*p_itr, now_time), m_itr->staked.amount, p_itr->total_staked.amount);
+        }
+        result.push_back(pending_reward{pool_id, m_itr->staked, crl});
     }
-    
-    auto token_issued = asset(time_elapsed * supply_per_second_now, itr->released_reward.symbol);
-    pools_tbl.modify(itr, same_payer, [&]( auto& s) {
-        s.released_reward += token_issued;
-        s.last_harvest_time = now_time;
+    return result;
+}
+
+vector<crlpool::pool_state> crlpool::getpools(uint64_t from, uint32_t limit) {
+    return list_pools<pool_state>(from, limit, [](const pool& p, asset pending, asset per_day) {
+        return pool_state{p.id, p.contract, p.sym, p.total_staked, p.total_reward, p.released_reward,
+            pending, per_day, p.epoch_time, p.duration};
     });
+}
 
-    // issue
-    auto data = make_tuple(_self, token_issued, string("Issue CRL"));
-    action(permission_level{_self, "active"_n}, CRL_CONTRACT, "issue"_n, data).send();
-
-    // update every miner
-    miners_mi miners_tbl(_self, itr->id);
-    auto m_itr = miners_tbl.begin();
-    check(m_itr != miners_tbl.end(), "No miners");
-    while (m_itr != miners_tbl.end()) {
-        double radio = (double)(m_itr->staked.amount) / itr->total_staked.amount;
-        uint64_t amount = (uint64_t)(token_issued.amount * radio);
-        miners_tbl.modify(m_itr, same_payer, [&]( auto& a) {
-            a.unclaimed.amount += amount;
-        });
-        m_itr++;
+uint64_t crlpool::harvest_pool(pools_mi& pools_tbl, pools_mi::const_iterator itr, uint32_t now_time, uint64_t& rows) {
+    auto distributable = pending_emission(*itr, now_time);
+
+    // update every miner, one row in memory at a time
+    uint64_t distributed = 0;
+    for (miners_cursor m_cur(_self, itr->id); m_cur.valid(); m_cur.next()) {
+        rows++;
+        auto& m = m_cur.row();
+        uint64_t amount = emission::pro_rata(distributable, m.staked.amount, itr->total_staked.amount);
+        if (amount == 0) {
+            continue;
+        }
+        m.unclaimed.amount += amount;
+        m_cur.update(same_payer);
+        distributed += amount;
     }
 
+    rows++;
+    pools_tbl.modify(itr, same_payer, [&]( auto& s) {
+        s.released_reward.amount += distributed;
+        s.last_harvest_time = now_time;
+    });
+    return distributed;
 }
 
-void crlpool::handle_transfer(name from, name to, asset quantity, string memo, name code) {
-    if (from == _self || to != _self) {
-        return;
+bool crlpool::take_unclaimed(const pool& p, name owner, rewards& amounts) {
+    miners_mi miners_tbl(_self, p.id);
+    auto m_itr = miners_tbl.find(owner.value);
+    if (m_itr == miners_tbl.end()) {
+        return false;
     }
-    require_auth(from);
-    auto sym = quantity.symbol;
-    pools_mi pools_tbl(_self, _self.value);
-    auto itr = pools_tbl.begin();
-    while (itr != pools_tbl.end()) {
-        if (itr->contract == code && itr->sym == sym) {
-            break;
-        }
-        itr++;
+    if (m_itr->unclaimed.amount == 0) {
+        return true;
     }
-    check(itr != pools_tbl.end(), "Pool not found");
-    check(itr->contract == code && itr->sym == sym, "Error token"); // recheck, actually don’t need to do this.
-    check(quantity >= itr->min_staked, "The amount of staked is too small");
-    auto now_time = current_time_point().sec_since_epoch();
-    check(now_time <= itr->epoch_time + itr->duration, "Mining is over");
 
-    pools_tbl.modify(itr, same_payer, [&]( auto& s) {
-        s.total_staked += quantity;
+    auto unclaimed = m_itr->unclaimed;
+    miners_tbl.modify(m_itr, same_payer, [&]( auto& s) {
+        s.claimed += unclaimed;
+        s.unclaimed = asset(0, unclaimed.symbol);
     });
+    amounts[0] += unclaimed.amount;
+    return true;
+}
 
-    miners_mi miners_tbl(_self, itr->id);
-    auto m_itr = miners_tbl.find(from.value);
+uint64_t crlpool::remove_miner(const pool& p, name owner, rewards& amounts) {
+    miners_mi miners_tbl(_self, p.id);
+    auto m_itr = miners_tbl.find(owner.value);
+    check(m_itr != miners_tbl.end(), "No this miner");
+
+    auto staked = m_itr->staked.amount;
+    amounts[0] += m_itr->unclaimed.amount;
+    miners_tbl.erase(m_itr);
+    return staked;
+}
+
+bool crlpool::add_stake(const pool& p, name owner, asset quantity) {
+    miners_mi miners_tbl(_self, p.id);
+    auto m_itr = miners_tbl.find(owner.value);
     if (m_itr == miners_tbl.end()) {
         auto zero_crl = asset(0, symbol("CRL", 10));
         miners_tbl.emplace(_self, [&]( auto& a) {
-            a.owner = from;
+            a.owner = owner;
             a.staked = quantity;
             a.claimed = zero_crl;
             a.unclaimed = zero_crl;
         });
-    } else {
-        miners_tbl.modify(m_itr, same_payer, [&]( auto& a) {
-            a.staked += quantity;
-        });
+        return true;
     }
-}
\ No newline at end of file
+    miners_tbl.modify(m_itr, same_payer, [&]( auto& a) {
+        a.staked += quantity;
+    });
+    return false;
+}
+
+void crlpool::reward_totals(const pool& p, vector<extended_asset>& released, vector<uint128_t>& per_share) {
+    released.push_back(extended_asset(p.released_reward, CRL_CONTRACT));
+}
+
+name crlpool::next_miner(const pool& p, name from) {
+    miners_mi miners_tbl(_self, p.id);
+    auto m_itr = miners_tbl.lower_bound(from.value);
+    return m_itr != miners_tbl.end() ? m_itr->owner : name();
+}
+
+// the deployed harvest finished in one action, it left no rounds
+bool crlpool::finish_round(const pool& p, uint32_t limit, uint32_t& rows) {
+    return true;
+}
+
+// CRL is issued as it is released, the pool holds nothing else
+void crlpool::close_pool(const pool& p) {
+}
@@ -1,22 +1,151 @@
-#include <utils.hpp>
-
 #define CRL_CONTRACT  name("coralfitoken")
 #define BOX_LP_CONTRACT  name("lptoken.defi")
 #define BOX_TOKEN_CONTRACT  name("token.defi")
 #define FEES_ACCOUNT  name("coralpoolfee")
 
-CONTRACT crlpool : public contract {
+// BOX the lp contract must hold above for us before a sync claims it, unless the interval passed
+#define BOX_MIN_CLAIM  10
+
+// reward tokens a pool can carry, CRL included
+#define MAX_REWARDS  8
+
+// where a reward token's harvests come from
+#define REWARD_EMISSION  0   // CRL, issued on the pool's schedule
+#define REWARD_BOX       1   // BOX the staked lp tokens collect, claimed from the lp contract
+#define REWARD_DEPOSIT   2   // deposited by partners, streamed out until the pool ends
+#define REWARD_HALVING   3   // CRL on the halving schedule of a pool carried over from the v1 contract
+#define REWARD_MERKLE    4   // CRL split off-chain each round, claimed with a proof of the published root
+
+#include <eosio/crypto.hpp>
+#include <pool_engine.hpp>
+
+// miners earn the reward tokens listed on their pool, CRL first
+struct pool_rewards {
+   typedef vector<extended_asset> amounts;
+   static engine::reward_token crl() { return {CRL_CONTRACT, symbol("CRL", 10)}; }
+   // payouts of the same token from several pools are merged
+   static void add(amounts& a, name contract, asset quantity) {
+      if (quantity.amount == 0) {
+         return;
+      }
+      for (auto& r : a) {
+         if (r.contract == contract && r.quantity.symbol == quantity.symbol) {
+            r.quantity += quantity;
+            return;
+         }
+      }
+      a.push_back(extended_asset(quantity, contract));
+   }
+   static bool empty(const amounts& a) {
+      for (auto& r : a) {
+         if (r.quantity.amount > 0) {
+            return false;
+         }
+      }
+      return true;
+   }
+   template<typename F>
+   static void for_each(const amounts& a, F&& f) {
+      for (auto& r : a) {
+         if (r.quantity.amount > 0) {
+            f(r.contract, r.quantity);
+         }
+      }
+   }
+   // box claims, fee refunds and crl coming back in are not stakes
+   static bool is_reward_sender(name from) {
+      return from == BOX_LP_CONTRACT || from == CRL_CONTRACT || from == FEES_ACCOUNT;
+   }
+};
+
+// linear emission, miners settle lazily against per-share accumulators
+CONTRACT crlpool : public engine::pool_engine<crlpool, emission::linear_schedule, pool_rewards> {
    public:
-      using contract::contract;
+      using pool_engine::pool_engine;
+
+      // harvests only move the per-share accumulators
+      static constexpr bool harvest_walks_miners = false;
+
+      struct pending_reward {
+         uint64_t pool_id;
+         asset staked;
+         vector<extended_asset> rewards;   // in the pool's reward token order
+      };
+
+      struct pool_state {
+         uint64_t pool_id;
+         name contract;
+         symbol sym;
+         asset total_staked;
+         asset total_reward;
+         asset released_reward;
+         asset pending_reward;   // what a harvest now would release
+         asset reward_per_day;   // at the current emission rate
+         vector<extended_asset> rewards;   // released so far per reward token
+         uint32_t epoch_time;
+         uint32_t duration;
+      };
 
       ACTION create(name contract, symbol sym, asset reward, uint32_t epoch_time, uint32_t duration, asset min_staked, uint8_t box_enable, symbol_code box_code);
       ACTION claim(name owner, uint64_t pool_id);
+      ACTION claimall(name owner, vector<uint64_t> pool_ids);
+      ACTION compound(name owner, uint64_t pool_id);
+      // stakes the unclaimed CRL of `pool_ids` in `pool_id`, which must stake CRL
+      ACTION compoundall(name owner, uint64_t pool_id, vector<uint64_t> pool_ids);
       ACTION withdraw(name owner, uint64_t pool_id);
-      ACTION harvest(uint64_t pool_id, uint64_t round_no, uint32_t limit);
+      ACTION harvest(uint64_t pool_id);
+      ACTION harvestall(vector<uint64_t> pool_ids, uint32_t max_rows);
+      ACTION migrate(uint64_t pool_id, uint32_t limit);
+      // rewrites the rows of every pool in the current layout, `limit` rows a call, resuming where the last call stopped
+      ACTION migrateall(uint32_t limit);
+      // lists a partner token on a pool, funded by transfers with a "reward:<pool_id>" memo
+      ACTION addreward(uint64_t pool_id, extended_symbol token);
+      // claims the BOX of the lp contract once it is above min_claim or interval seconds passed since the last claim
+      ACTION setboxsync(uint64_t min_claim, uint32_t interval);
+      // claims what the pair updated by the last sync accrued into its pool and updates
+      // the next pool of the list, a call per pool
+      ACTION syncbox(vector<uint64_t> pool_ids);
+      // CRL of the pool is no longer split by harvest but by rounds a keeper publishes,
+      // only before the pool released any
+      ACTION setmerkle(uint64_t pool_id);
+      // a round of a merkle pool, `total` CRL of what the schedule emitted so far split
+      // among `leaves` entries of the tree under `root`
+      ACTION publish(uint64_t pool_id, checksum256 root, asset total, uint32_t leaves);
+      // pays the owner's entry `index` of a round, `proof` holds the sibling hashes from the leaf up
+      ACTION claimproof(name owner, uint64_t pool_id, uint64_t round_id, uint32_t index, asset amount, vector<checksum256> proof);
+      // pays out and drops the miners of a finished pool, `limit` at a time, then the pool
+      ACTION cleanup(uint64_t pool_id, uint32_t limit);
+      // adds the positions of miners that staked before they were kept and lists older pools by token, `limit` rows a call
+      ACTION indexall(uint32_t limit);
+      // no-op, carries the events of an action to indexers, see pool_engine.hpp
+      ACTION log(vector<engine::pool_event> events);
+
+      // read-only queries, computed with the same math as harvest. No pools
+      // lists every pool the owner has a stake in
+      [[eosio::action, eosio::read_only]] vector<pending_reward> getpending(name owner, vector<uint64_t> pool_ids);
+      [[eosio::action, eosio::read_only]] vector<pool_state> getpools(uint64_t from, uint32_t limit);
 
-      void handle_transfer(name from, name to, asset quantity, string memo, name code);
+      void handle_transfer(name from, name to, asset quantity, std::string_view memo, name code);
 
    private:
+      friend pool_engine;
+
+      // one reward token of a pool and its accumulator
+      struct pool_reward {
+         extended_symbol token;
+         uint8_t source;         // REWARD_*
+         uint64_t funded;        // deposited so far, REWARD_DEPOSIT only
+         uint64_t released;      // paid into the accumulator so far
+         uint128_t per_share;
+      };
+
+      // a miner's balance of one reward token, in the pool's token order
+      struct reward_balance {
+         uint64_t claimed;
+         uint64_t unclaimed;
+         uint128_t debt;
+      };
+
       TABLE pool {
          uint64_t id;
          name contract;
@@ -30,8 +159,57 @@ CONTRACT crlpool : public contract {
          uint32_t last_harvest_time;
          uint8_t box_enable;
          symbol_code box_code;
-         asset box_reward;
+         vector<pool_reward> rewards;
          uint64_t primary_key() const { return id; }
+         uint128_t get_key() const { return utils::get_token_key(contract, sym); }
+
+         // rows the v1 contract wrote end after last_harvest_time, they read as
+         // a pool whose CRL keeps the halving schedule and has no accumulator yet.
+         // Rows the deployed poolv2 wrote hold the BOX received so far where the
+         // reward tokens are now, their accumulators start at zero as well
+         template<typename DataStream>
+         friend DataStream& operator>>(DataStream& ds, pool& p) {
+            ds >> p.id >> p.contract >> p.sym >> p.total_staked >> p.total_reward >> p.released_reward
+               >> p.epoch_time >> p.duration >> p.min_staked >> p.last_harvest_time;
+            if (ds.remaining() == 0) {
+               p.from_v1();
+               return ds;
+            }
+            ds >> p.box_enable >> p.box_code;
+            // a vector of 49 byte entries never leaves exactly an asset
+            if (ds.remaining() == sizeof(int64_t) + sizeof(symbol)) {
+               asset box_reward;
+               ds >> box_reward;
+               p.from_v2(box_reward);
+               return ds;
+            }
+            return ds >> p.rewards;
+         }
+         void from_v1() {
+            box_enable = 0;
+            box_code = symbol_code();
+            rewards = {pool_reward{extended_symbol(released_reward.symbol, CRL_CONTRACT), REWARD_HALVING,
+               0, (uint64_t)released_reward.amount, 0}};
+         }
+         void from_v2(asset box_reward) {
+            rewards = {pool_reward{extended_symbol(released_reward.symbol, CRL_CONTRACT), REWARD_EMISSION,
+               0, (uint64_t)released_reward.amount, 0}};
+            if (box_enable == 1) {
+               rewards.push_back(pool_reward{extended_symbol(box_reward.symbol, BOX_TOKEN_CONTRACT), REWARD_BOX,
+                  0, (uint64_t)box_reward.amount, 0});
+            }
+         }
+      };
+
+      // miners are stored in the stakers table, the symbols come from the pool.
+      // Balances follow the pool's reward tokens and are extended when the
+      // pool gained a token since the miner's last settle. Rows left in the
+      // legacy miners table are converted when touched or by migrate.
+      TABLE staker {
+         name owner;
+         uint64_t staked;
+         vector<reward_balance> balances;
+         uint64_t primary_key() const { return owner.value; }
       };
 
       TABLE miner {
@@ -41,9 +219,55 @@ CONTRACT crlpool : public contract {
          asset unclaimed_crl;
          asset claimed_box;
          asset unclaimed_box;
+         uint128_t crl_debt;
+         uint128_t box_debt;
          uint64_t primary_key() const { return owner.value; }
+
+         // rows the v1 contract wrote end after the CRL balance and rows the
+         // deployed poolv2 wrote after the BOX balance, their share of later
+         // harvests is all in the pool's accumulators
+         template<typename DataStream>
+         friend DataStream& operator>>(DataStream& ds, miner& m) {
+            ds >> m.owner >> m.staked >> m.claimed_crl >> m.unclaimed_crl;
+            if (ds.remaining() > 0) {
+               ds >> m.claimed_box >> m.unclaimed_box;
+            } else {
+               m.claimed_box = asset(0, symbol("BOX", 6));
+               m.unclaimed_box = m.claimed_box;
+            }
+            if (ds.remaining() > 0) {
+               return ds >> m.crl_debt >> m.box_debt;
+            }
+            m.crl_debt = 0;
+            m.box_debt = 0;
+            return ds;
+         }
+      };
+      
+      TABLE registry {
+         asset committed_reward;
+         asset released_reward;
+         uint64_t active_pools;
+      };
+
+      // when syncbox claims from the lp contract
+      TABLE boxsync {
+         uint64_t min_claim;
+         uint32_t interval;
+         uint32_t last_sync;
+         uint64_t pool_id;       // whose pair was updated last, the next claim is its
+      };
+
+      // how far migrateall got
+      TABLE migration {
+         uint64_t pool_id;       // the pool being migrated, the ones before it are done
+         uint64_t pools;
+         uint64_t rows;
       };
 
+      // harvest pagination of the deployed contract, scoped to _self. A round
+      // not completed owes the miners from `offset` on their share of its
+      // amounts, and stakes can't change until they got it
       TABLE round {
          uint64_t pool_id;
          uint64_t no;
@@ -53,9 +277,116 @@ CONTRACT crlpool : public contract {
          bool completed;
          uint64_t primary_key() const { return pool_id; }
       };
+
+      // a published round of a merkle pool, scoped by pool. A leaf is the sha256
+      // of (uint32 index, name owner, uint64 amount) packed, a node the sha256 of
+      // its two children, the left one first. Levels with an odd count repeat
+      // their last node. Kept apart from "rounds", the deployed contract's harvest pagination.
+      TABLE mround {
+         uint64_t id;
+         checksum256 root;
+         uint32_t leaves;
+         uint64_t total;
+         uint64_t claimed;
+         uint32_t published;
+         uint64_t primary_key() const { return id; }
+      };
+
+      // 64 claimed flags of a round, keyed by round_id << 32 | index / 64
+      TABLE claimword {
+         uint64_t key;
+         uint64_t bits;
+         uint64_t primary_key() const { return key; }
+      };
+
+      TABLE stakedcontract {
+         name contract;
+         uint64_t pools;
+         uint64_t miners;        // with a position, older miners count once indexall or a deposit adds theirs
+         uint64_t primary_key() const { return contract.value; }
+      };
       
-      typedef eosio::multi_index<"pools"_n, pool> pools_mi;
+      // a pool the owner has a stake in, scoped by owner
+      TABLE position {
+         uint64_t pool_id;
+         uint64_t primary_key() const { return pool_id; }
+      };
+
+      // how far indexall got
+      TABLE posindex {
+         uint64_t pool_id;       // the pool being indexed, the ones before it are done
+         name owner;             // the next miner of that pool to index
+         uint64_t rows;
+      };
+
+      // rolling figures of a pool for monitoring, kept up to date by the actions
+      TABLE poolstat {
+         uint64_t pool_id;
+         uint64_t harvests;
+         uint32_t harvest_interval;   // seconds between the last two harvests
+         uint64_t rows_last;          // miner rows the last harvest touched
+         uint64_t rows_total;
+         uint64_t deferred;           // times harvestall ran out of rows before reaching the pool
+         uint64_t crl_last;           // released by the last harvest
+         uint64_t crl_total;
+         uint64_t deposits;
+         uint64_t deposit_volume;
+         uint64_t withdrawals;
+         uint64_t withdraw_volume;
+         uint64_t box_total;          // credited by syncbox
+         uint64_t primary_key() const { return pool_id; }
+      };
+      
+      typedef eosio::multi_index<"pools"_n, pool,
+         indexed_by<"tokenkey"_n, const_mem_fun<pool, uint128_t, &pool::get_key>>
+      > pools_mi;
+      typedef eosio::multi_index<"stakers"_n, staker> stakers_mi;
       typedef eosio::multi_index<"miners"_n, miner> miners_mi;
+      typedef rawdb::cursor<"pools"_n, pool> pools_cursor;
+      typedef eosio::singleton<"registry"_n, registry> registry_si;
+      typedef eosio::singleton<"boxsync"_n, boxsync> boxsync_si;
+      typedef eosio::singleton<"migration"_n, migration> migration_si;
       typedef eosio::multi_index<"rounds"_n, round> rounds_mi;
-      
+      typedef eosio::multi_index<"mrounds"_n, mround> mrounds_mi;
+      typedef eosio::multi_index<"claimwords"_n, claimword> claimwords_mi;
+      typedef eosio::multi_index<"contracts"_n, stakedcontract> contracts_mi;
+      typedef eosio::multi_index<"poolstats"_n, poolstat> poolstats_mi;
+      typedef eosio::multi_index<"positions"_n, position> positions_mi;
+      typedef eosio::singleton<"posindex"_n, posindex> posindex_si;
+
+      // settlement, see pool_engine.hpp
+      uint64_t harvest_pool(pools_mi& pools_tbl, pools_mi::const_iterator itr, uint32_t now_time, uint64_t& rows);
+      bool take_unclaimed(const pool& p, name owner, rewards& amounts);
+      uint64_t remove_miner(const pool& p, name owner, rewards& amounts);
+      bool add_stake(const pool& p, name owner, asset quantity);
+      void reward_totals(const pool& p, vector<extended_asset>& released, vector<uint128_t>& per_share);
+      name next_miner(const pool& p, name from);
+      void close_pool(const pool& p);
+      // CRL emitted by the pool's schedule, see pool_engine.hpp
+      uint64_t emitted(const pool& p, uint32_t elapsed);
+
+      // move rewards accrued since the miner's last snapshot into unclaimed
+      void settle(const pool& p, staker& m);
+      // snapshot the per-share accumulators for the miner's current stake
+      void reset_debt(const pool& p, staker& m);
+      // the owner's row in the pool the table is scoped to, a legacy row is converted first
+      stakers_mi::const_iterator find_staker(stakers_mi& stakers_tbl, name owner);
+      // copies a legacy miner row into the stakers table and drops it
+      stakers_mi::const_iterator convert_miner(stakers_mi& stakers_tbl, miners_mi& miners_tbl, miners_mi::const_iterator m_itr);
+      staker to_staker(const miner& m);
+      // credits what the pool's round from the deployed contract still owes, `limit`
+      // rows at most, and drops the round once done. False if miners are left
+      bool finish_round(const pool& p, uint32_t limit, uint32_t& rows);
+      void check_round(uint64_t pool_id);
+      // the owner's row without converting a legacy one, false if the owner isn't mining the pool
+      bool read_staker(uint64_t pool_id, name owner, staker& m);
+
+      // what a harvest at now_time pays into the accumulator of an emission or deposit token
+      uint64_t releasable(const pool& p, const pool_reward& r, uint32_t now_time);
+      // a partner funding one of the pool's deposit tokens
+      void fund_reward(uint64_t pool_id, name code, asset quantity);
+      // the root of the tree the leaf is in, following the proof by the leaf's index
+      static checksum256 merkle_root(name owner, uint32_t index, uint64_t amount, const vector<checksum256>& proof);
+      // pays claimed BOX into the pool's accumulator
+      void credit_box(pools_mi& pools_tbl, pools_mi::const_iterator itr, uint64_t amount);
 };
\ No newline at end of file
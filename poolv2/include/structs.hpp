@@ -1,17 +1,11 @@
 #include <eosio/eosio.hpp>
 #include <eosio/system.hpp>
 #include <eosio/asset.hpp>
+#include <eosio/singleton.hpp>
 
 using namespace eosio;
 using namespace std;
 
-struct transfer_args {
-    name from;
-    name to;
-    asset quantity;
-    string memo;
-};
-
  struct [[eosio::table]] box_reward {
     name owner;
     uint64_t cumulative;
@@ -2,13 +2,34 @@
 
 namespace utils {
 
-    void inline_transfer(name contract, name from, name to, asset quantity, string memo) {
-        auto data = make_tuple(from, to, quantity, memo);
-        action(permission_level{from, "active"_n}, contract, "transfer"_n, data).send();
+    uint128_t get_token_key(name contract, symbol sym) {
+        return ((uint128_t)(contract.value) << 64) + sym.raw();
     }
 
-    // uint128_t get_token_key(name contract, symbol sym) {
-    //     return ((uint128_t)(contract.value) << 64) + sym.raw();
-    // }
+    // id addressed by a "<prefix><id>" transfer memo, 0 if the memo has no such prefix
+    uint64_t parse_memo_id(std::string_view memo, std::string_view prefix) {
+        if (memo.compare(0, prefix.size(), prefix) != 0) {
+            return 0;
+        }
+        check(memo.size() > prefix.size() && memo.size() <= prefix.size() + 20, "Invalid pool memo");
+        uint64_t id = 0;
+        for (size_t i = prefix.size(); i < memo.size(); i++) {
+            check(memo[i] >= '0' && memo[i] <= '9', "Invalid pool memo");
+            auto next = id * 10 + (memo[i] - '0');
+            check(next / 10 == id, "Invalid pool memo");
+            id = next;
+        }
+        return id;
+    }
+
+    // pool id addressed by a "pool:<id>" transfer memo, 0 if the memo has no such prefix
+    uint64_t parse_pool_memo(std::string_view memo) {
+        return parse_memo_id(memo, "pool:");
+    }
+
+    // pool funded by a "reward:<id>" transfer memo, 0 if the memo has no such prefix
+    uint64_t parse_reward_memo(std::string_view memo) {
+        return parse_memo_id(memo, "reward:");
+    }
 
 }
\ No newline at end of file
@@ -1,286 +1,688 @@
 #include <crlpool.hpp>
-#include <math.h>
 
 extern "C" {
     void apply(uint64_t receiver, uint64_t code, uint64_t action) {
         if (code == receiver) {
             switch (action) {
-                EOSIO_DISPATCH_HELPER(crlpool, (create)(claim)(withdraw)(harvest))
+                EOSIO_DISPATCH_HELPER(crlpool, (create)(claim)(claimall)(compound)(compoundall)(withdraw)(harvest)(harvestall)(addreward)(setboxsync)(syncbox)(setmerkle)(publish)(claimproof)(cleanup)(indexall)(log)(migrate)(migrateall)(getpending)(getpools))
             }
         } else {
             if (action == name("transfer").value) {
-                crlpool inst(name(receiver), name(code), datastream<const char *>(nullptr, 0));
-                const auto t = unpack_action_data<transfer_args>();
-                inst.handle_transfer(t.from, t.to, t.quantity, t.memo, name(code));
+                // most transfers a token notifies us of aren't ours, skip them before decoding the rest
+                rawaction::transfer_reader t;
+                if (t.read(name(receiver))) {
+                    crlpool inst(name(receiver), name(code), datastream<const char *>(nullptr, 0));
+                    inst.handle_transfer(t.from, t.to, t.quantity, t.memo, name(code));
+                }
             }
         }
     }
 }
 
 void crlpool::create(name contract, symbol sym, asset reward, uint32_t epoch_time, uint32_t duration, asset min_staked, uint8_t box_enable, symbol_code box_code) {
-    require_auth("coralmanager"_n);
-
-    pools_mi pools_tbl(_self, _self.value);
-    auto itr = pools_tbl.begin();
-    
-    while (itr != pools_tbl.end()) {
-        auto exists = itr->contract == contract && itr->sym == sym;
-        check(!exists, "Token exists");
-        itr++;
-    }
-
-    check(reward.symbol == symbol("CRL", 10), "Reward symbol error");
-    check(min_staked.symbol == sym, "Min-staked symbol error");
-
-    auto total = reward;
-    itr = pools_tbl.begin();
-    while (itr != pools_tbl.end()) {
-        total += itr->total_reward;
-        itr++;
-    }
-    check(total.amount <= 300000000000000, "Reach the max circulation");
-
-    auto pool_id = pools_tbl.available_primary_key();
-    if (pool_id == 0) {
-        pool_id = 1;
-    }
-    pools_tbl.emplace(_self, [&]( auto& a ) {
-        a.id = pool_id;
-        a.contract = contract;
-        a.sym = sym;
-        a.total_staked = asset(0, sym);
-        a.total_reward = reward;
-        a.released_reward = asset(0, reward.symbol);
-        a.epoch_time = epoch_time;
-        a.duration = duration;
-        a.min_staked = min_staked;
-        a.last_harvest_time = epoch_time;
+    create_pool(contract, sym, reward, epoch_time, duration, min_staked, [&](auto& a) {
         a.box_enable = box_enable;
         a.box_code = box_code;
-        a.box_reward = asset(0, symbol("BOX", 6));
+        a.rewards.push_back(pool_reward{extended_symbol(reward.symbol, CRL_CONTRACT), REWARD_EMISSION, 0, 0, 0});
+        if (box_enable == 1) {
+            a.rewards.push_back(pool_reward{extended_symbol(symbol("BOX", 6), BOX_TOKEN_CONTRACT), REWARD_BOX, 0, 0, 0});
+        }
     });
 }
 
 void crlpool::claim(name owner, uint64_t pool_id) {
-    require_auth(owner);
+    claim_pools(owner, {pool_id});
+}
 
-    pools_mi pools_tbl(_self, _self.value);
-    auto p_itr = pools_tbl.find(pool_id);  
-    check(p_itr != pools_tbl.end(), "Pool not exists");
+void crlpool::claimall(name owner, vector<uint64_t> pool_ids) {
+    claim_pools(owner, pool_ids);
+}
 
-    miners_mi miners_tbl(_self, pool_id);
-    auto m_itr = miners_tbl.find(owner.value);
-    check(m_itr != miners_tbl.end(), "No this miner");
-    check(m_itr->unclaimed_crl.amount > 0, "No unclaimed");
-
-    auto crl_quantity = m_itr->unclaimed_crl;
-    auto box_quantity = m_itr->unclaimed_box;
-    miners_tbl.modify(m_itr, same_payer, [&]( auto& s) {
-        s.claimed_crl += crl_quantity;
-        s.unclaimed_crl = asset(0, crl_quantity.symbol);
-        s.claimed_box += box_quantity;
-        s.unclaimed_box = asset(0, box_quantity.symbol);
-    });
-    
-    utils::inline_transfer(CRL_CONTRACT, _self, owner, crl_quantity, string("Minner claimed"));
-    if (box_quantity.amount > 0) {
-        utils::inline_transfer(BOX_TOKEN_CONTRACT, _self, owner, box_quantity, string("Minner claimed"));
-    }
+void crlpool::compound(name owner, uint64_t pool_id) {
+    compound_pools(owner, pool_id, {pool_id});
+}
+
+void crlpool::compoundall(name owner, uint64_t pool_id, vector<uint64_t> pool_ids) {
+    compound_pools(owner, pool_id, pool_ids);
 }
 
 void crlpool::withdraw(name owner, uint64_t pool_id) {
-    require_auth(owner);
+    withdraw_pool(owner, pool_id);
+}
 
-    pools_mi pools_tbl(_self, _self.value);
-    auto p_itr = pools_tbl.find(pool_id);  
-    check(p_itr != pools_tbl.end(), "Pool not exists");
+void crlpool::harvest(uint64_t pool_id) {
+    harvest_one(pool_id);
+}
 
-    rounds_mi rounds_tbl(_self, _self.value);
-    auto r_itr = rounds_tbl.find(pool_id);
-    if (r_itr != rounds_tbl.end()) {
-        check(r_itr->completed, "Harvesting, please wait");
-    }
+void crlpool::harvestall(vector<uint64_t> pool_ids, uint32_t max_rows) {
+    harvest_pools(pool_ids, max_rows);
+}
 
-    miners_mi miners_tbl(_self, pool_id);
-    auto m_itr = miners_tbl.find(owner.value);
-    check(m_itr != miners_tbl.end(), "No this miner");
+void crlpool::addreward(uint64_t pool_id, extended_symbol token) {
+    require_auth("coralmanager"_n);
+    check(token.get_symbol().is_valid(), "Invalid reward symbol");
+
+    pools_mi pools_tbl(_self, _self.value);
+    auto itr = pools_tbl.find(pool_id);
+    check(itr != pools_tbl.end(), "Pool not exists");
+    check(itr->rewards.size() < MAX_REWARDS, "Too many rewards");
+    for (auto& r : itr->rewards) {
+        check(r.token != token, "Reward exists");
+    }
+    auto now_time = current_time_point().sec_since_epoch();
+    check(now_time < itr->epoch_time + itr->duration, "Mining is over");
 
-    auto quantity = m_itr->staked;
-    pools_tbl.modify(p_itr, same_payer, [&]( auto& s) {
-        s.total_staked -= quantity;
+    // the accumulator starts at zero, so miners earn the token from now on
+    pools_tbl.modify(itr, same_payer, [&]( auto& s) {
+        s.rewards.push_back(pool_reward{token, REWARD_DEPOSIT, 0, 0, 0});
     });
-    
-    utils::inline_transfer(p_itr->contract, _self, owner, quantity, string("Minner withdraw"));
-    if (m_itr->unclaimed_crl.amount > 0) {
-        utils::inline_transfer(CRL_CONTRACT, _self, owner, m_itr->unclaimed_crl, string("Minner claimed"));
+}
+
+void crlpool::setboxsync(uint64_t min_claim, uint32_t interval) {
+    require_auth("coralmanager"_n);
+
+    boxsync_si boxsync_tbl(_self, _self.value);
+    auto sync = boxsync_tbl.get_or_default(boxsync{BOX_MIN_CLAIM, 0, 0, 0});
+    sync.min_claim = min_claim;
+    sync.interval = interval;
+    boxsync_tbl.set(sync, _self);
+}
+
+void crlpool::syncbox(vector<uint64_t> pool_ids) {
+    require_auth("coralmanager"_n);
+    check(!pool_ids.empty(), "No pools");
+
+    pools_mi pools_tbl(_self, _self.value);
+    for (auto pool_id : pool_ids) {
+        auto itr = pools_tbl.find(pool_id);
+        check(itr != pools_tbl.end(), "Pool not exists");
+        check(itr->box_enable == 1, "Box mining is not enabled");
     }
-    if (m_itr->unclaimed_box.amount > 0) {
-        utils::inline_transfer(BOX_TOKEN_CONTRACT, _self, owner, m_itr->unclaimed_box, string("Minner claimed"));
+
+    // the lp contract keeps one balance for the account whatever pair it
+    // came from, so only one pair is updated between two claims and what
+    // is claimed goes to that pair's pool alone
+    boxsync_si boxsync_tbl(_self, _self.value);
+    auto sync = boxsync_tbl.get_or_default(boxsync{BOX_MIN_CLAIM, 0, 0, 0});
+    // before the first sync the deployed harvest left it with the first pool
+    auto pool_id = sync.pool_id > 0 ? sync.pool_id : pool_ids.front();
+    auto next = pool_id;
+    auto p_itr = pools_tbl.find(pool_id);
+    boxrewards boxreward_tbl(BOX_LP_CONTRACT, BOX_LP_CONTRACT.value);
+    auto br_itr = boxreward_tbl.find(_self.value);
+    auto unclaimed = br_itr == boxreward_tbl.end() ? 0 : br_itr->unclaimed;
+    auto now_time = current_time_point().sec_since_epoch();
+    bool interval_passed = sync.interval > 0 && now_time >= sync.last_sync + sync.interval;
+    // a pool with no stake holds none of its pair and accrued nothing, the list moves on
+    bool staked = p_itr != pools_tbl.end() && p_itr->total_staked.amount > 0;
+    bool claim = staked && unclaimed > 0 && (unclaimed > sync.min_claim || interval_passed);
+    if (!staked || claim) {
+        auto pos = std::find(pool_ids.begin(), pool_ids.end(), pool_id);
+        next = pos == pool_ids.end() || pos + 1 == pool_ids.end() ? pool_ids.front() : *(pos + 1);
     }
+    if (claim) {
+        sync.last_sync = now_time;
 
-    miners_tbl.erase(m_itr);
+        auto box_reward_amount = unclaimed;
+        auto fees = box_reward_amount / 10;
+        box_reward_amount -= fees;
+
+        rawaction::send(BOX_LP_CONTRACT, "claim"_n, permission_level{_self, "active"_n}, _self);
+
+        // transfer to fees account
+        if (fees > 0) {
+            rawaction::transfer(BOX_TOKEN_CONTRACT, _self, FEES_ACCOUNT, asset(fees, symbol("BOX", 6)), "Fees");
+        }
+        credit_box(pools_tbl, p_itr, box_reward_amount);
+        update_stats(p_itr->id, [&](auto& s) {
+            s.box_total += box_reward_amount;
+        });
+        log_harvest(EVENT_HARVEST, *p_itr, name(), asset(0, symbol("CRL", 10)));
+    }
+    // the update is applied after the claim, its BOX is claimed by the next sync
+    sync.pool_id = next;
+    boxsync_tbl.set(sync, _self);
+    rawaction::send(BOX_LP_CONTRACT, "update"_n, permission_level{_self, "active"_n}, pools_tbl.get(next).box_code, _self);
+    flush_events();
 }
 
-void crlpool::harvest(uint64_t pool_id, uint64_t round_no, uint32_t limit) {
+void crlpool::setmerkle(uint64_t pool_id) {
     require_auth("coralmanager"_n);
 
     pools_mi pools_tbl(_self, _self.value);
-    auto itr = pools_tbl.find(pool_id);  
+    auto itr = pools_tbl.find(pool_id);
     check(itr != pools_tbl.end(), "Pool not exists");
+    check(itr->rewards[0].source == REWARD_EMISSION, "Not an emission pool");
+    check(itr->released_reward.amount == 0, "Pool already released CRL");
+
+    pools_tbl.modify(itr, same_payer, [&]( auto& s) {
+        s.rewards[0].source = REWARD_MERKLE;
+    });
+}
+
+void crlpool::publish(uint64_t pool_id, checksum256 root, asset total, uint32_t leaves) {
+    require_auth("coralmanager"_n);
+    check(leaves > 0, "Empty round");
+    seed_registry();
+    check(total.symbol == symbol("CRL", 10) && total.amount > 0, "Invalid total");
 
+    pools_mi pools_tbl(_self, _self.value);
+    auto itr = pools_tbl.find(pool_id);
+    check(itr != pools_tbl.end(), "Pool not exists");
+    check(itr->rewards[0].source == REWARD_MERKLE, "Not a merkle pool");
     auto now_time = current_time_point().sec_since_epoch();
     check(now_time >= itr->epoch_time, "Mining hasn't started yet");
-    check(now_time <= itr->epoch_time + itr->duration, "Mining is over");
-    
-    auto supply_per_second = itr->total_reward.amount / itr->duration;
-    auto time_elapsed = now_time - itr->last_harvest_time;
-    if (time_elapsed == 0) {
-        return;
-    }
+    // the schedule still caps what goes out, the keeper only decides who gets it.
+    // A round after the end publishes what is left before cleanup
+    check((uint64_t)total.amount <= pending_emission(*itr, now_time), "Round exceeds the emission");
 
-    rounds_mi rounds_tbl(_self, _self.value);
-    auto r_itr = rounds_tbl.find(pool_id);
-    if (r_itr == rounds_tbl.end()) {
-        r_itr = rounds_tbl.emplace(_self, [&]( auto& a) {
-            a.pool_id = pool_id;
-            a.no = 0;
-            a.offset = name("");
-            a.crl_amount = 0;
-            a.box_amount = 0;
-            a.completed = true;
-        });
-    }
-    
-    auto offset = r_itr->offset;
-    uint64_t crl_reward_amount = r_itr->crl_amount;
-    uint64_t box_reward_amount = r_itr->box_amount;
-
-    if (round_no != r_itr->no) {
-        // new round
-        check(r_itr->completed, "Last round not completed.");
-        offset = name("");
-        crl_reward_amount = time_elapsed * supply_per_second;
-        box_reward_amount = 0;
-
-        // box
-        if (itr->box_enable == 1) {
-            boxrewards boxreward_tbl(BOX_LP_CONTRACT, BOX_LP_CONTRACT.value);
-            auto br_itr = boxreward_tbl.find(_self.value);
-            if (br_itr != boxreward_tbl.end() && br_itr->unclaimed > 10) {
-                box_reward_amount = br_itr->unclaimed;
-                auto fees = box_reward_amount / 10;
-                box_reward_amount -= fees;
-
-                auto data1 = make_tuple(_self);
-                action(permission_level{_self, "active"_n}, BOX_LP_CONTRACT, "claim"_n, data1).send();
-
-                // transfer to fees account
-                utils::inline_transfer(BOX_TOKEN_CONTRACT, _self, FEES_ACCOUNT, asset(fees, symbol("BOX", 6)), string("Fees"));
-            }
-            auto data2 = make_tuple(itr->box_code, _self);
-            action(permission_level{_self, "active"_n}, BOX_LP_CONTRACT, "update"_n, data2).send();
+    pools_tbl.modify(itr, same_payer, [&]( auto& s) {
+        s.released_reward += total;
+        s.rewards[0].released += total.amount;
+    });
+    mrounds_mi rounds_tbl(_self, pool_id);
+    auto round_id = std::max<uint64_t>(rounds_tbl.available_primary_key(), 1);
+    rounds_tbl.emplace(_self, [&]( auto& a) {
+        a.id = round_id;
+        a.root = root;
+        a.leaves = leaves;
+        a.total = total.amount;
+        a.claimed = 0;
+        a.published = now_time;
+    });
+    update_stats(pool_id, [&](auto& s) {
+        s.harvests++;
+        s.crl_last = total.amount;
+        s.crl_total += total.amount;
+    });
+    log_harvest(EVENT_HARVEST, *itr, name(), total);
+    issue_released(total.amount);
+    flush_events();
+}
 
-        }
+void crlpool::claimproof(name owner, uint64_t pool_id, uint64_t round_id, uint32_t index, asset amount, vector<checksum256> proof) {
+    require_auth(owner);
+    check(amount.symbol == symbol("CRL", 10) && amount.amount > 0, "Invalid amount");
 
-        pools_tbl.modify(itr, same_payer, [&]( auto& s) {
-            s.released_reward.amount += crl_reward_amount;
-            s.box_reward.amount += box_reward_amount;
-            s.last_harvest_time = now_time;
+    // rounds stay claimable after cleanup dropped the pool
+    mrounds_mi rounds_tbl(_self, pool_id);
+    auto r_itr = rounds_tbl.find(round_id);
+    check(r_itr != rounds_tbl.end(), "Round not exists");
+    check(index < r_itr->leaves, "Invalid index");
+    // one sibling per level of the tree
+    size_t depth = 0;
+    while ((uint64_t(1) << depth) < r_itr->leaves) {
+        depth++;
+    }
+    check(proof.size() == depth, "Invalid proof");
+    check(merkle_root(owner, index, amount.amount, proof) == r_itr->root, "Invalid proof");
+
+    claimwords_mi claimwords_tbl(_self, pool_id);
+    auto key = round_id << 32 | index / 64;
+    auto bit = uint64_t(1) << (index % 64);
+    auto w_itr = claimwords_tbl.find(key);
+    if (w_itr == claimwords_tbl.end()) {
+        claimwords_tbl.emplace(_self, [&]( auto& a) {
+            a.key = key;
+            a.bits = bit;
         });
-        
-        auto data = make_tuple(_self, asset(crl_reward_amount, itr->released_reward.symbol), string("Issue CRL"));
-        action(permission_level{_self, "active"_n}, CRL_CONTRACT, "issue"_n, data).send();
     } else {
-        check(!r_itr->completed, "This round is completed.");
-    }
-    // update every miner
-    miners_mi miners_tbl(_self, itr->id);
-    auto m_itr = miners_tbl.begin();
-    check(m_itr != miners_tbl.end(), "No miners");
-    
-    if (offset != name("")) {
-        m_itr = miners_tbl.find(offset.value);
-    }
-    int index = 0;
-    while (m_itr != miners_tbl.end()) {
-        double radio = (double)(m_itr->staked.amount) / itr->total_staked.amount;
-        uint64_t crl_amount = (uint64_t)(crl_reward_amount * radio);
-        uint64_t box_amount = (uint64_t)(box_reward_amount * radio);
-        miners_tbl.modify(m_itr, same_payer, [&]( auto& a) {
-            a.unclaimed_crl.amount += crl_amount;
-            a.unclaimed_box.amount += box_amount;
+        check((w_itr->bits & bit) == 0, "Already claimed");
+        claimwords_tbl.modify(w_itr, same_payer, [&]( auto& s) {
+            s.bits |= bit;
         });
-        m_itr++;
-        if (++index == limit) {
-            break;
-        }
     }
-    auto completed = m_itr == miners_tbl.end();
-    auto next_offset = completed ? name("") : m_itr->owner;
+    check(r_itr->claimed + amount.amount <= r_itr->total, "Round overdrawn");
     rounds_tbl.modify(r_itr, same_payer, [&]( auto& s) {
-        s.no = round_no;
-        s.offset = next_offset;
-        s.crl_amount = crl_reward_amount;
-        s.box_amount = box_reward_amount;
-        s.completed = completed;
+        s.claimed += amount.amount;
     });
+
+    rewards amounts{extended_asset(amount, CRL_CONTRACT)};
+    engine::pool_event e{EVENT_CLAIM, pool_id, owner, asset(), asset(), amounts, {}};
+    pools_mi pools_tbl(_self, _self.value);
+    auto p_itr = pools_tbl.find(pool_id);
+    if (p_itr != pools_tbl.end()) {
+        e.quantity = asset(0, p_itr->sym);
+        e.total_staked = p_itr->total_staked;
+    }
+    pay_out(owner, amounts);
+    log_event(e);
+    flush_events();
 }
 
-void crlpool::handle_transfer(name from, name to, asset quantity, string memo, name code) {
-    if (from == _self || to != _self) {
-        return;
+checksum256 crlpool::merkle_root(name owner, uint32_t index, uint64_t amount, const vector<checksum256>& proof) {
+    char leaf[sizeof(uint32_t) + sizeof(uint64_t) * 2];
+    datastream<char*> ds(leaf, sizeof(leaf));
+    ds << index << owner << amount;
+    auto node = sha256(leaf, sizeof(leaf));
+
+    char pair[64];
+    for (size_t level = 0; level < proof.size(); level++) {
+        bool right = (index >> level) & 1;
+        memcpy(pair + (right ? 32 : 0), node.extract_as_byte_array().data(), 32);
+        memcpy(pair + (right ? 0 : 32), proof[level].extract_as_byte_array().data(), 32);
+        node = sha256(pair, sizeof(pair));
     }
-    if (from == BOX_LP_CONTRACT) {
+    return node;
+}
+
+void crlpool::cleanup(uint64_t pool_id, uint32_t limit) {
+    require_auth("coralmanager"_n);
+    check(limit > 0, "Invalid limit");
+
+    // a round the deployed harvest left behind is paid out and dropped first
+    pools_mi pools_tbl(_self, _self.value);
+    auto p_itr = pools_tbl.find(pool_id);
+    check(p_itr != pools_tbl.end(), "Pool not exists");
+    uint32_t rows = 0;
+    if (!finish_round(*p_itr, limit, rows) || rows >= limit) {
         return;
     }
-    if (from == CRL_CONTRACT) {
-        return;
+    cleanup_pool(pool_id, limit - rows);
+}
+
+void crlpool::indexall(uint32_t limit) {
+    index_positions(limit);
+}
+
+void crlpool::migrateall(uint32_t limit) {
+    require_auth("coralmanager"_n);
+    check(limit > 0, "Invalid limit");
+
+    migration_si migration_tbl(_self, _self.value);
+    auto state = migration_tbl.get_or_default(migration{0, 0, 0});
+    pools_mi pools_tbl(_self, _self.value);
+    auto p_itr = pools_tbl.lower_bound(state.pool_id);
+    check(p_itr != pools_tbl.end(), "Nothing to migrate");
+
+    // rows not reached yet keep working as they are, see pool and miner
+    uint32_t rows = 0;
+    while (p_itr != pools_tbl.end() && rows < limit) {
+        state.pool_id = p_itr->id;
+        if (!finish_round(*p_itr, limit, rows)) {
+            break;
+        }
+        miners_mi miners_tbl(_self, p_itr->id);
+        stakers_mi stakers_tbl(_self, p_itr->id);
+        auto m_itr = miners_tbl.begin();
+        for (; m_itr != miners_tbl.end() && rows < limit; m_itr = miners_tbl.begin()) {
+            convert_miner(stakers_tbl, miners_tbl, m_itr);
+            rows++;
+            state.rows++;
+        }
+        if (m_itr != miners_tbl.end()) {
+            break;
+        }
+        // written back in the current layout
+        if (token_listed(pools_tbl, p_itr)) {
+            pools_tbl.modify(p_itr, same_payer, [](auto& s) {});
+        } else {
+            p_itr = list_token(pools_tbl, p_itr);
+        }
+        rows++;
+        state.pools++;
+        state.pool_id = p_itr->id + 1;
+        p_itr++;
     }
-    if (from == FEES_ACCOUNT) {
-        return;
+    migration_tbl.set(state, _self);
+}
+
+void crlpool::log(vector<engine::pool_event> events) {
+    require_auth(_self);
+}
+
+void crlpool::migrate(uint64_t pool_id, uint32_t limit) {
+    require_auth("coralmanager"_n);
+    check(limit > 0, "Invalid limit");
+
+    pools_mi pools_tbl(_self, _self.value);
+    auto p_itr = pools_tbl.find(pool_id);
+    check(p_itr != pools_tbl.end(), "Pool not exists");
+
+    // converted rows leave the legacy table, so repeating the call resumes where the last one stopped
+    uint32_t rows = 0;
+    bool finished = finish_round(*p_itr, limit, rows);
+    miners_mi miners_tbl(_self, pool_id);
+    auto m_itr = miners_tbl.begin();
+    check(rows > 0 || m_itr != miners_tbl.end(), "Nothing to migrate");
+    stakers_mi stakers_tbl(_self, pool_id);
+    for (; finished && rows < limit && m_itr != miners_tbl.end(); rows++) {
+        convert_miner(stakers_tbl, miners_tbl, m_itr);
+        m_itr = miners_tbl.begin();
     }
-    require_auth(from);
-    auto sym = quantity.symbol;
+}
+
+vector<crlpool::pending_reward> crlpool::getpending(name owner, vector<uint64_t> pool_ids) {
     pools_mi pools_tbl(_self, _self.value);
-    auto itr = pools_tbl.begin();
-    while (itr != pools_tbl.end()) {
-        if (itr->contract == code && itr->sym == sym) {
-            break;
+    auto now_time = current_time_point().sec_since_epoch();
+    vector<pending_reward> result;
+    if (pool_ids.empty()) {
+        pool_ids = owner_pools(owner);
+    }
+    for (auto pool_id : pool_ids) {
+        auto p_itr = pools_tbl.find(pool_id);
+        check(p_itr != pools_tbl.end(), "Pool not exists");
+
+        staker m;
+        if (!read_staker(pool_id, owner, m)) {
+            continue;
+        }
+        // settle against the accumulators as a harvest now would leave them
+        auto p = *p_itr;
+        if (harvestable(p, now_time)) {
+            for (auto& r : p.rewards) {
+                r.per_share += emission::per_share(releasable(p, r, now_time), p.total_staked.amount);
+            }
+        }
+        settle(p, m);
+        vector<extended_asset> rewards;
+        for (size_t i = 0; i < p.rewards.size(); i++) {
+            auto& token = p.rewards[i].token;
+            rewards.push_back(extended_asset(asset(m.balances[i].unclaimed, token.get_symbol()), token.get_contract()));
         }
-        itr++;
+        result.push_back(pending_reward{pool_id, asset(m.staked, p.sym), rewards});
     }
+    return result;
+}
+
+vector<crlpool::pool_state> crlpool::getpools(uint64_t from, uint32_t limit) {
+    return list_pools<pool_state>(from, limit, [](const pool& p, asset pending, asset per_day) {
+        // a harvest releases what the accumulator can pay out, see harvest_pool
+        if (pending.amount > 0) {
+            uint64_t total_staked = p.total_staked.amount;
+            pending.amount = (uint64_t)emission::accrued(total_staked, emission::per_share(pending.amount, total_staked));
+        }
+        vector<extended_asset> rewards;
+        for (auto& r : p.rewards) {
+            rewards.push_back(extended_asset(asset(r.released, r.token.get_symbol()), r.token.get_contract()));
+        }
+        return pool_state{p.id, p.contract, p.sym, p.total_staked, p.total_reward, p.released_reward,
+            pending, per_day, rewards, p.epoch_time, p.duration};
+    });
+}
+
+uint64_t crlpool::harvest_pool(pools_mi& pools_tbl, pools_mi::const_iterator itr, uint32_t now_time, uint64_t& rows) {
+    // one pass over the reward tokens, every miner's share is settled lazily
+    // against the accumulators and only what an accumulator can actually pay
+    // out counts as released
+    rows++;
+    uint64_t total_staked = itr->total_staked.amount;
+    uint64_t crl_released = 0;
+    pools_tbl.modify(itr, same_payer, [&]( auto& s) {
+        for (auto& r : s.rewards) {
+            auto amount = releasable(s, r, now_time);
+            auto inc = emission::per_share(amount, total_staked);
+            amount = (uint64_t)emission::accrued(total_staked, inc);
+            r.per_share += inc;
+            r.released += amount;
+            if (r.source == REWARD_EMISSION || r.source == REWARD_HALVING) {
+                crl_released = amount;
+            }
+        }
+        s.released_reward.amount += crl_released;
+        s.last_harvest_time = now_time;
+    });
+    return crl_released;
+}
+
+uint64_t crlpool::emitted(const pool& p, uint32_t elapsed) {
+    if (p.rewards[0].source == REWARD_HALVING) {
+        return emission::halving_schedule::emitted(p.total_reward.amount, p.duration, elapsed);
+    }
+    return emission::linear_schedule::emitted(p.total_reward.amount, p.duration, elapsed);
+}
+
+uint64_t crlpool::releasable(const pool& p, const pool_reward& r, uint32_t now_time) {
+    if (r.source == REWARD_EMISSION || r.source == REWARD_HALVING) {
+        return pending_emission(p, now_time);
+    }
+    // BOX comes in through syncbox, merkle CRL through publish
+    if (r.source != REWARD_DEPOSIT) {
+        return 0;
+    }
+    // what is left streams out evenly over the time left
+    auto end_time = p.epoch_time + p.duration;
+    auto unreleased = r.funded - r.released;
+    if (now_time >= end_time || p.last_harvest_time >= end_time) {
+        return unreleased;
+    }
+    auto since = now_time > p.last_harvest_time ? now_time - p.last_harvest_time : 0;
+    return emission::mul_div(unreleased, since, end_time - p.last_harvest_time);
+}
+
+void crlpool::credit_box(pools_mi& pools_tbl, pools_mi::const_iterator itr, uint64_t amount) {
+    uint64_t total_staked = itr->total_staked.amount;
+    pools_tbl.modify(itr, same_payer, [&]( auto& s) {
+        for (auto& r : s.rewards) {
+            if (r.source == REWARD_BOX) {
+                auto inc = emission::per_share(amount, total_staked);
+                r.per_share += inc;
+                r.released += (uint64_t)emission::accrued(total_staked, inc);
+            }
+        }
+    });
+}
+
+void crlpool::handle_transfer(name from, name to, asset quantity, std::string_view memo, name code) {
+    auto pool_id = utils::parse_reward_memo(memo);
+    if (pool_id > 0 && from != _self && to == _self) {
+        require_auth(from);
+        fund_reward(pool_id, code, quantity);
+        return;
+    }
+    pool_engine::handle_transfer(from, to, quantity, memo, code);
+}
+
+void crlpool::fund_reward(uint64_t pool_id, name code, asset quantity) {
+    pools_mi pools_tbl(_self, _self.value);
+    auto itr = pools_tbl.find(pool_id);
     check(itr != pools_tbl.end(), "Pool not found");
-    check(itr->contract == code && itr->sym == sym, "Error token"); // recheck, actually don’t need to do this.
-    check(quantity >= itr->min_staked, "The amount of staked is too small");
     auto now_time = current_time_point().sec_since_epoch();
-    check(now_time <= itr->epoch_time + itr->duration, "Mining is over");
+    check(now_time < itr->epoch_time + itr->duration, "Mining is over");
 
+    auto token = extended_symbol(quantity.symbol, code);
+    auto r_itr = std::find_if(itr->rewards.begin(), itr->rewards.end(), [&](const pool_reward& r) {
+        return r.token == token;
+    });
+    check(r_itr != itr->rewards.end() && r_itr->source == REWARD_DEPOSIT, "Not a reward of this pool");
+    auto index = r_itr - itr->rewards.begin();
     pools_tbl.modify(itr, same_payer, [&]( auto& s) {
-        s.total_staked += quantity;
+        s.rewards[index].funded += quantity.amount;
     });
+}
 
-    rounds_mi rounds_tbl(_self, _self.value);
-    auto r_itr = rounds_tbl.find(itr->id);
-    if (r_itr != rounds_tbl.end()) {
-        check(r_itr->completed, "Harvesting, please wait");
+bool crlpool::take_unclaimed(const pool& p, name owner, rewards& amounts) {
+    stakers_mi stakers_tbl(_self, p.id);
+    auto m_itr = find_staker(stakers_tbl, owner);
+    if (m_itr == stakers_tbl.end()) {
+        return false;
+    }
+
+    stakers_tbl.modify(m_itr, same_payer, [&]( auto& s) {
+        settle(p, s);
+        for (size_t i = 0; i < p.rewards.size(); i++) {
+            auto& b = s.balances[i];
+            auto& token = p.rewards[i].token;
+            pool_rewards::add(amounts, token.get_contract(), asset(b.unclaimed, token.get_symbol()));
+            b.claimed += b.unclaimed;
+            b.unclaimed = 0;
+        }
+    });
+    return true;
+}
+
+uint64_t crlpool::remove_miner(const pool& p, name owner, rewards& amounts) {
+    check_round(p.id);
+    stakers_mi stakers_tbl(_self, p.id);
+    auto m_itr = find_staker(stakers_tbl, owner);
+    check(m_itr != stakers_tbl.end(), "No this miner");
+
+    auto settled = *m_itr;
+    settle(p, settled);
+    for (size_t i = 0; i < p.rewards.size(); i++) {
+        auto& token = p.rewards[i].token;
+        pool_rewards::add(amounts, token.get_contract(), asset(settled.balances[i].unclaimed, token.get_symbol()));
+    }
+    stakers_tbl.erase(m_itr);
+    return settled.staked;
+}
+
+bool crlpool::add_stake(const pool& p, name owner, asset quantity) {
+    check_round(p.id);
+    stakers_mi stakers_tbl(_self, p.id);
+    auto m_itr = find_staker(stakers_tbl, owner);
+    if (m_itr == stakers_tbl.end()) {
+        stakers_tbl.emplace(_self, [&]( auto& a) {
+            a.owner = owner;
+            a.staked = quantity.amount;
+            reset_debt(p, a);
+        });
+        return true;
+    }
+    stakers_tbl.modify(m_itr, same_payer, [&]( auto& a) {
+        settle(p, a);
+        a.staked += quantity.amount;
+        reset_debt(p, a);
+    });
+    return false;
+}
+
+void crlpool::reward_totals(const pool& p, vector<extended_asset>& released, vector<uint128_t>& per_share) {
+    for (auto& r : p.rewards) {
+        released.push_back(extended_asset(asset(r.released, r.token.get_symbol()), r.token.get_contract()));
+        per_share.push_back(r.per_share);
+    }
+}
+
+name crlpool::next_miner(const pool& p, name from) {
+    // legacy rows not converted yet count as well, whichever table comes first
+    stakers_mi stakers_tbl(_self, p.id);
+    miners_mi miners_tbl(_self, p.id);
+    auto s_itr = stakers_tbl.lower_bound(from.value);
+    auto m_itr = miners_tbl.lower_bound(from.value);
+    if (m_itr == miners_tbl.end() || (s_itr != stakers_tbl.end() && s_itr->owner < m_itr->owner)) {
+        return s_itr != stakers_tbl.end() ? s_itr->owner : name();
     }
+    return m_itr->owner;
+}
+
+// partner deposits a pool ended without stake for never went out, they go back to the manager
+void crlpool::close_pool(const pool& p) {
+    for (auto& r : p.rewards) {
+        if (r.source == REWARD_DEPOSIT && r.funded > r.released) {
+            rawaction::transfer(r.token.get_contract(), _self, "coralmanager"_n,
+                asset(r.funded - r.released, r.token.get_symbol()), "Reward refund");
+        }
+    }
+}
+
+void crlpool::settle(const pool& p, staker& m) {
+    // tokens added after the miner staked start with a zero debt
+    if (m.balances.size() < p.rewards.size()) {
+        m.balances.resize(p.rewards.size());
+    }
+    for (size_t i = 0; i < p.rewards.size(); i++) {
+        auto& b = m.balances[i];
+        auto accrued = emission::accrued(m.staked, p.rewards[i].per_share);
+        b.unclaimed += emission::owed(accrued, b.debt);
+        b.debt = accrued;
+    }
+}
 
-    miners_mi miners_tbl(_self, itr->id);
-    auto m_itr = miners_tbl.find(from.value);
+void crlpool::reset_debt(const pool& p, staker& m) {
+    if (m.balances.size() < p.rewards.size()) {
+        m.balances.resize(p.rewards.size());
+    }
+    for (size_t i = 0; i < p.rewards.size(); i++) {
+        m.balances[i].debt = emission::accrued(m.staked, p.rewards[i].per_share);
+    }
+}
+
+crlpool::stakers_mi::const_iterator crlpool::find_staker(stakers_mi& stakers_tbl, name owner) {
+    auto s_itr = stakers_tbl.find(owner.value);
+    if (s_itr != stakers_tbl.end()) {
+        return s_itr;
+    }
+    miners_mi miners_tbl(_self, stakers_tbl.get_scope());
+    auto m_itr = miners_tbl.find(owner.value);
     if (m_itr == miners_tbl.end()) {
-        auto zero_crl = asset(0, symbol("CRL", 10));
-        auto zero_box = asset(0, symbol("BOX", 6));
-        miners_tbl.emplace(_self, [&]( auto& a) {
-            a.owner = from;
-            a.staked = quantity;
-            a.claimed_crl = zero_crl;
-            a.unclaimed_crl = zero_crl;
-            a.claimed_box = zero_box;
-            a.unclaimed_box = zero_box;
+        return s_itr;
+    }
+    return convert_miner(stakers_tbl, miners_tbl, m_itr);
+}
+
+crlpool::stakers_mi::const_iterator crlpool::convert_miner(stakers_mi& stakers_tbl, miners_mi& miners_tbl, miners_mi::const_iterator m_itr) {
+    check(stakers_tbl.find(m_itr->owner.value) == stakers_tbl.end(), "Miner already converted");
+    auto s_itr = stakers_tbl.emplace(_self, [&]( auto& a) {
+        a = to_staker(*m_itr);
+    });
+    miners_tbl.erase(m_itr);
+    return s_itr;
+}
+
+crlpool::staker crlpool::to_staker(const miner& m) {
+    staker s{m.owner, (uint64_t)m.staked.amount, {
+        reward_balance{(uint64_t)m.claimed_crl.amount, (uint64_t)m.unclaimed_crl.amount, m.crl_debt}}};
+    // the legacy box columns line up with the pool's second reward, an empty
+    // balance is left for settle to add back
+    if (m.claimed_box.amount > 0 || m.unclaimed_box.amount > 0 || m.box_debt > 0) {
+        s.balances.push_back(reward_balance{(uint64_t)m.claimed_box.amount, (uint64_t)m.unclaimed_box.amount, m.box_debt});
+    }
+    return s;
+}
+
+bool crlpool::finish_round(const pool& p, uint32_t limit, uint32_t& rows) {
+    rounds_mi rounds_tbl(_self, _self.value);
+    auto r_itr = rounds_tbl.find(p.id);
+    if (r_itr == rounds_tbl.end()) {
+        return true;
+    }
+    // split by stake as the deployed harvest did, the stakes are still the ones it split by
+    size_t box = std::find_if(p.rewards.begin(), p.rewards.end(), [](const pool_reward& r) {
+        return r.source == REWARD_BOX;
+    }) - p.rewards.begin();
+    stakers_mi stakers_tbl(_self, p.id);
+    auto owner = r_itr->completed ? name() : next_miner(p, r_itr->offset);
+    for (; owner != name() && rows < limit; owner = next_miner(p, name(owner.value + 1))) {
+        auto s_itr = find_staker(stakers_tbl, owner);
+        stakers_tbl.modify(s_itr, same_payer, [&]( auto& s) {
+            settle(p, s);
+            s.balances[0].unclaimed += emission::pro_rata(r_itr->crl_amount, s.staked, p.total_staked.amount);
+            if (box < p.rewards.size()) {
+                s.balances[box].unclaimed += emission::pro_rata(r_itr->box_amount, s.staked, p.total_staked.amount);
+            }
         });
-    } else {
-        miners_tbl.modify(m_itr, same_payer, [&]( auto& a) {
-            a.staked += quantity;
+        rows++;
+    }
+    if (owner != name()) {
+        rounds_tbl.modify(r_itr, same_payer, [&]( auto& s) {
+            s.offset = owner;
         });
+        return false;
+    }
+    rounds_tbl.erase(r_itr);
+    rows++;
+    return true;
+}
+
+void crlpool::check_round(uint64_t pool_id) {
+    rounds_mi rounds_tbl(_self, _self.value);
+    auto r_itr = rounds_tbl.find(pool_id);
+    check(r_itr == rounds_tbl.end() || r_itr->completed, "Harvesting, please wait");
+}
+
+bool crlpool::read_staker(uint64_t pool_id, name owner, staker& m) {
+    stakers_mi stakers_tbl(_self, pool_id);
+    auto s_itr = stakers_tbl.find(owner.value);
+    if (s_itr != stakers_tbl.end()) {
+        m = *s_itr;
+        return true;
+    }
+    miners_mi miners_tbl(_self, pool_id);
+    auto m_itr = miners_tbl.find(owner.value);
+    if (m_itr != miners_tbl.end()) {
+        m = to_staker(*m_itr);
+        return true;
     }
+    return false;
 }
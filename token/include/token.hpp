@@ -62,6 +62,29 @@ public:
     */
    [[eosio::action]] 
    void transfer(const name &from, const name &to, const asset &quantity, const string &memo);
+
+   struct transfer_entry {
+      name to;
+      asset quantity;
+      string memo;
+
+      EOSLIB_SERIALIZE(transfer_entry, (to)(quantity)(memo))
+   };
+
+   /**
+    * Transfers action.
+    *
+    * @details Allows `from` account to transfer to several accounts in one action.
+    * `from` is debited once with the total and every recipient is credited and notified.
+    *
+    * @param from - the account to transfer from,
+    * @param entries - the recipients with the quantity and memo of each transfer.
+    *
+    * @pre All quantities must have the same symbol,
+    * @pre Every entry has to pass the same checks as a single transfer.
+    */
+   [[eosio::action]] 
+   void transfers(const name &from, const std::vector<transfer_entry> &entries);
    /**
     * Open action.
     *
@@ -1,4 +1,5 @@
 #include <token.hpp>
+#include <rawaction.hpp>
 
 void token::create(const name &issuer, const asset &maximum_supply) {
    require_auth(get_self());
@@ -43,7 +44,7 @@ void token::issue(const name &to, const asset &quantity, const string &memo) {
    add_balance(st.issuer, quantity, st.issuer);
 
    if (to != st.issuer) {
-      SEND_INLINE_ACTION(*this, transfer, {{st.issuer, "active"_n}}, {st.issuer, to, quantity, memo});
+      rawaction::transfer(get_self(), st.issuer, to, quantity, memo);
    }
 }
 
@@ -92,6 +93,34 @@ void token::transfer(const name &from, const name &to, const asset &quantity, co
    add_balance(to, quantity, payer);
 }
 
+void token::transfers(const name &from, const std::vector<transfer_entry> &entries) {
+   require_auth(from);
+   check(!entries.empty(), "no transfers");
+   auto sym = entries.front().quantity.symbol;
+   stats statstable(get_self(), sym.code().raw());
+   const auto &st = statstable.get(sym.code().raw());
+   check(sym == st.supply.symbol, "symbol precision mismatch");
+
+   require_recipient(from);
+
+   asset total(0, sym);
+   for (const auto &e : entries) {
+      check(from != e.to, "cannot transfer to self");
+      check(is_account(e.to), "to account does not exist");
+      check(e.quantity.is_valid(), "invalid quantity");
+      check(e.quantity.amount > 0, "must transfer positive quantity");
+      check(e.quantity.symbol == sym, "all transfers must have the same symbol");
+      check(e.memo.size() <= 256, "memo has more than 256 bytes");
+      require_recipient(e.to);
+      total += e.quantity;
+   }
+
+   sub_balance(from, total);
+   for (const auto &e : entries) {
+      add_balance(e.to, e.quantity, has_auth(e.to) ? e.to : from);
+   }
+}
+
 void token::sub_balance(const name &owner, const asset &value) {
    accounts from_acnts(get_self(), owner.value);
 